@@ -0,0 +1,121 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  arena.c
+ *
+ *  Arena allocator of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <stdint.h>
+
+#define ARENA_ALIGN 64					//!< Alignment of every allocation
+#define ARENA_CHUNKSIZE (1 << 20)	//!< Default chunk size
+
+/**
+ *  A chunk of an arena. The memory handed out follows the header, from
+ *  <code>base</code> to <code>end</code>.
+ */
+
+struct BEL_ArenaChunk {
+	BEL_ArenaChunk *next;	//!< The chunk allocated before this one
+	char *top;						//!< First free byte
+	char *end;						//!< End of the chunk
+	char base[];					//!< The memory of the chunk
+};
+
+/** Initializes a BEL_Arena structure
+ *
+ *  No memory is allocated until the first call to BEL_ArenaAlloc.
+ *
+ *  @param arena  The arena to be initialized
+ *  @param chunksize  The size of the chunks, 0 for the default of 1MB
+ */
+
+void BEL_InitArena(BEL_Arena *arena, size_t chunksize)
+{
+	arena->chunks = (BEL_ArenaChunk *) NULL;
+	arena->chunksize = (chunksize ? chunksize : ARENA_CHUNKSIZE);
+}
+
+/** Allocates memory from a BEL_Arena
+ *
+ *  Bumps the top of the current chunk, or starts a new one when it is full.
+ *  A request larger than the chunk size gets a chunk of its own. The memory
+ *  is 64 byte aligned and is not initialized; there is no way to release
+ *  it other than BEL_FreeArena.
+ *
+ *  @param arena  The arena to allocate from
+ *  @param size The number of bytes
+ *  @return A pointer to the memory, NULL if it could not be allocated
+ */
+
+void *BEL_ArenaAlloc(BEL_Arena *arena, size_t size)
+{
+	BEL_ArenaChunk *chunk = arena->chunks;
+	char *p;
+	size_t len;
+
+	size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+	if (chunk)
+	{
+		p = (char *) (((uintptr_t) chunk->top + ARENA_ALIGN - 1) & ~((uintptr_t) ARENA_ALIGN - 1));
+		if (p <= chunk->end && size <= (size_t) (chunk->end - p))
+		{
+			chunk->top = p + size;
+			return p;
+		}
+	}
+
+	len = (size > arena->chunksize ? size : arena->chunksize) + ARENA_ALIGN;
+	chunk = (BEL_ArenaChunk *) malloc(sizeof(BEL_ArenaChunk) + len);
+	if (!chunk)
+	{
+		fprintf(stderr, "Out of memory allocating %lu bytes from an arena\n", (unsigned long) size);
+		return NULL;
+	}
+	chunk->end = chunk->base + len;
+	p = (char *) (((uintptr_t) chunk->base + ARENA_ALIGN - 1) & ~((uintptr_t) ARENA_ALIGN - 1));
+	chunk->top = p + size;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	return p;
+}
+
+/** Releases all the memory of a BEL_Arena
+ *
+ *  Every pointer returned by BEL_ArenaAlloc becomes invalid. The arena can
+ *  be used again afterwards.
+ *
+ *  @param arena  The arena to be released
+ */
+
+void BEL_FreeArena(BEL_Arena *arena)
+{
+	BEL_ArenaChunk *chunk, *next;
+
+	for (chunk = arena->chunks; chunk; chunk = next)
+	{
+		next = chunk->next;
+		free(chunk);
+	}
+	arena->chunks = (BEL_ArenaChunk *) NULL;
+}
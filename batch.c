@@ -0,0 +1,478 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  batch.c
+ *
+ *  Batch mode of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+#include <string.h>
+#include <dirent.h>
+#include <glob.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define BATCH_LINELEN 4096	//!< Longest line of a manifest
+
+static const char *batch_status[] = { "solved", "read_error", "infeasible", "solve_error", "not_run" };
+
+/**
+ *  Tells whether a file name looks like an instance: a TSPLIB .vrp file or
+ *  a binary .vrpb file.
+ */
+
+static int is_instance(const char *fname)
+{
+	size_t len = strlen(fname);
+
+	return ((len > 4 && !strcmp(fname + len - 4, ".vrp")) ||
+		(len > 5 && !strcmp(fname + len - 5, ".vrpb")));
+}
+
+/**
+ *  Appends a copy of a file name to a growing list.
+ *
+ *  @return 1 on failure, 0 otherwise
+ */
+
+static int add_file(char ***files, int *nfiles, int *maxfiles, const char *fname)
+{
+	if (strlen(fname) >= BEL_BATCH_NAMELEN)
+	{
+		fprintf(stderr, "Instance name too long: %s\n", fname);
+		return 1;
+	}
+	if (*nfiles == *maxfiles)
+	{
+		char **grown = (char **) realloc(*files, (*maxfiles = 2 * *maxfiles + 64) * sizeof(char *));
+		if (!grown)
+			return 1;
+		*files = grown;
+	}
+	if (!((*files)[*nfiles] = strdup(fname)))
+		return 1;
+	(*nfiles)++;
+	return 0;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/**
+ *  Lists the instances of a batch. A directory yields all its .vrp and
+ *  .vrpb files in name order, a pattern with wildcards is expanded with
+ *  glob, and any other file is a manifest holding one instance per line.
+ *  Blank lines and lines starting with '#' in a manifest are skipped.
+ *
+ *  @return 1 on failure, 0 otherwise
+ */
+
+static int list_instances(char *source, char ***files, int *nfiles)
+{
+	struct stat st;
+	int maxfiles = 0;
+	size_t i;
+
+	*files = (char **) NULL;
+	*nfiles = 0;
+
+	if (strpbrk(source, "*?["))
+	{
+		glob_t g;
+		int rval = glob(source, 0, NULL, &g);
+
+		if (rval == GLOB_NOMATCH)
+			return 0;
+		if (rval)
+		{
+			fprintf(stderr, "Cannot expand %s\n", source);
+			return 1;
+		}
+		for (i = 0; i < g.gl_pathc; i++)
+		{
+			if (add_file(files, nfiles, &maxfiles, g.gl_pathv[i]))
+			{
+				globfree(&g);
+				return 1;
+			}
+		}
+		globfree(&g);
+		return 0;
+	}
+
+	if (stat(source, &st))
+	{
+		fprintf(stderr, "Cannot open %s\n", source);
+		return 1;
+	}
+
+	if (S_ISDIR(st.st_mode))
+	{
+		DIR *dir;
+		struct dirent *entry;
+		char path[BEL_BATCH_NAMELEN];
+
+		if (!(dir = opendir(source)))
+		{
+			fprintf(stderr, "Cannot open directory %s\n", source);
+			return 1;
+		}
+		while ((entry = readdir(dir)) != NULL)
+		{
+			if (!is_instance(entry->d_name))
+				continue;
+			if (snprintf(path, sizeof(path), "%s/%s", source, entry->d_name) >= (int) sizeof(path) ||
+				add_file(files, nfiles, &maxfiles, path))
+			{
+				closedir(dir);
+				return 1;
+			}
+		}
+		closedir(dir);
+		qsort(*files, *nfiles, sizeof(char *), compare_names);
+		return 0;
+	}
+	else
+	{
+		FILE *in;
+		char line[BATCH_LINELEN], *p, *end;
+
+		if (!(in = fopen(source, "r")))
+		{
+			fprintf(stderr, "Cannot open manifest %s\n", source);
+			return 1;
+		}
+		while (fgets(line, sizeof(line), in))
+		{
+			for (p = line; *p == ' ' || *p == '\t'; p++)
+				;
+			for (end = p + strlen(p); end > p && (end[-1] == '\n' || end[-1] == '\r' ||
+				end[-1] == ' ' || end[-1] == '\t'); end--)
+				;
+			*end = '\0';
+			if (*p == '\0' || *p == '#')
+				continue;
+			if (add_file(files, nfiles, &maxfiles, p))
+			{
+				fclose(in);
+				return 1;
+			}
+		}
+		fclose(in);
+		return 0;
+	}
+}
+
+/**
+ *  Writes a string as a JSON string literal.
+ */
+
+static void json_string(FILE *out, const char *s)
+{
+	fputc('"', out);
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fprintf(out, "\\%c", *s);
+		else if ((unsigned char) *s < 0x20)
+			fprintf(out, "\\u%04x", (unsigned char) *s);
+		else
+			fputc(*s, out);
+	}
+	fputc('"', out);
+}
+
+/**
+ *  Writes the batch summary, one record per instance in the order they were
+ *  listed. The gap is the percent above the known best cost, 0 when there is
+ *  no .opt file next to the instance. A file name ending in .csv gets a CSV table with a header line,
+ *  anything else gets JSON Lines; with no file name, JSON Lines go to the
+ *  standard output.
+ *
+ *  @return 1 on failure, 0 otherwise
+ */
+
+static int write_summary(char *summary, BEL_BatchRecord *records, int nrecords)
+{
+	FILE *out = stdout;
+	size_t len = (summary ? strlen(summary) : 0);
+	int csv = (len > 4 && !strcasecmp(summary + len - 4, ".csv"));
+	int i;
+
+	if (summary && !(out = fopen(summary, "w")))
+	{
+		fprintf(stderr, "Cannot open file %s for writing\n", summary);
+		return 1;
+	}
+
+	if (csv)
+		fprintf(out, "instance,status,dimension,vehicles,cost,best,gap,maxrss,read,feasibility,solve,write,total\n");
+	for (i = 0; i < nrecords; i++)
+	{
+		BEL_BatchRecord *r = &records[i];
+		// Percent above the known best, only for solved instances that have one
+		double gap = (r->status == BEL_BATCH_SOLVED && r->bestcost > 0 ?
+			100.0 * (r->cost - r->bestcost) / r->bestcost : 0.0);
+
+		if (csv)
+		{
+			if (strpbrk(r->fname, ",\""))
+			{
+				char *p;
+				fputc('"', out);
+				for (p = r->fname; *p; p++)
+				{
+					if (*p == '"')
+						fputc('"', out);
+					fputc(*p, out);
+				}
+				fputc('"', out);
+			}
+			else
+				fputs(r->fname, out);
+			fprintf(out, ",%s,%d,%d,%d,%d,%.4f,%ld,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+				batch_status[r->status], r->dimension, r->nvehicles, r->cost, r->bestcost, gap,
+				r->maxrss, r->readtime, r->feasibletime, r->solvetime, r->writetime, r->totaltime);
+		}
+		else
+		{
+			fprintf(out, "{\"instance\":");
+			json_string(out, r->fname);
+			fprintf(out, ",\"status\":\"%s\",\"dimension\":%d,\"vehicles\":%d,\"cost\":%d,"
+				"\"best\":%d,\"gap\":%.4f,\"maxrss\":%ld,"
+				"\"times\":{\"read\":%.6f,\"feasibility\":%.6f,\"solve\":%.6f,\"write\":%.6f,\"total\":%.6f}}\n",
+				batch_status[r->status], r->dimension, r->nvehicles, r->cost, r->bestcost, gap,
+				r->maxrss, r->readtime, r->feasibletime, r->solvetime, r->writetime, r->totaltime);
+		}
+	}
+
+	if (out != stdout)
+		return (fclose(out) != 0);
+	return (fflush(out) != 0);
+}
+
+/**
+ *  Reads the cost of the known best solution of an instance, kept next to
+ *  it with the same name and a .opt extension, as in the bundled sets.
+ *
+ *  @return The cost, 0 if there is no such file
+ */
+
+static int known_best(char *fname)
+{
+	BEL_VRPSolution sol;
+	char optfname[BEL_BATCH_NAMELEN + 8];
+	char *base = strrchr(fname, '/');
+	char *ext = strrchr(base ? base : fname, '.');
+	int len = (ext ? ext - fname : (int) strlen(fname));
+	int cost = 0;
+
+	snprintf(optfname, sizeof(optfname), "%.*s.opt", len, fname);
+	if (access(optfname, R_OK))
+		return 0;
+	BEL_InitVRPSolution(&sol);
+	if (!BEL_VRPReadSolution(optfname, &sol, 0, 0))
+		cost = sol.cost;
+	BEL_FreeVRPSolution(&sol);
+	return cost;
+}
+
+/**
+ *  Resets the peak resident set size of the process, so that it can be
+ *  measured for each instance. Needs Linux 4.0 or later; elsewhere the peak
+ *  is the one of the whole process.
+ */
+
+static void reset_peak_rss(void)
+{
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+
+	if (f)
+	{
+		fputs("5", f);
+		fclose(f);
+	}
+}
+
+/**
+ *  Returns the peak resident set size of the process in KB, from
+ *  /proc/self/status if there is one and from getrusage otherwise.
+ */
+
+static long peak_rss(void)
+{
+	struct rusage ru;
+	char line[256];
+	long kb = 0;
+	FILE *f = fopen("/proc/self/status", "r");
+
+	if (f)
+	{
+		while (fgets(line, sizeof(line), f))
+		{
+			if (!strncmp(line, "VmHWM:", 6))
+			{
+				kb = atol(line + 6);
+				break;
+			}
+		}
+		fclose(f);
+	}
+	if (kb == 0 && !getrusage(RUSAGE_SELF, &ru))
+		kb = ru.ru_maxrss;
+	return kb;
+}
+
+/**
+ *  Solves instances of the batch until there are none left. The next
+ *  instance to solve is taken from a counter shared by all the workers, so
+ *  the long instances don't hold back the others.
+ */
+
+static void batch_worker(char **files, int nfiles, BEL_BatchRecord *records, int *next,
+	BEL_BatchSolver solve)
+{
+	int i;
+	double szeit;
+
+	while ((i = __sync_fetch_and_add(next, 1)) < nfiles)
+	{
+		reset_peak_rss();
+		szeit = CCutil_zeit();
+		if (solve(files[i], &records[i]) && records[i].status == BEL_BATCH_SOLVED)
+			records[i].status = BEL_BATCH_SOLVE_ERROR;
+		records[i].totaltime = CCutil_zeit() - szeit;
+		records[i].maxrss = peak_rss();
+		records[i].bestcost = known_best(files[i]);
+	}
+}
+
+/** Solves a batch of VRP instances
+ *
+ *  Lists the instances of <code>source</code>, which is a directory, a glob
+ *  pattern or a manifest file, and solves each of them with
+ *  <code>solve</code>. With more than one process, the workers are forked
+ *  once the caller has set up the TSP context and the route cache, so every
+ *  worker starts warm and keeps its contexts across all the instances it
+ *  solves. GLPK keeps global state, so the pool is made of processes rather
+ *  than threads; the records are kept in shared memory and the summary is
+ *  written by the calling process once every worker is done. Instances
+ *  whose worker died are reported as <code>not_run</code>.
+ *
+ *  @param source The directory, glob pattern or manifest listing the instances
+ *  @param summary  The summary file, .csv for CSV and JSON Lines otherwise, NULL for stdout
+ *  @param nprocs Number of worker processes
+ *  @param solve  The function solving one instance
+ *  @param failed Set to the number of instances that were not solved
+ *  @param verbose  Turns on lots of messages.
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_SolveBatch(char *source, char *summary, int nprocs, BEL_BatchSolver solve,
+	int *failed, int verbose)
+{
+	BEL_BatchRecord *records;
+	char **files;
+	size_t size;
+	int nfiles, i, rval = 1;
+	int *next;
+
+	*failed = 0;
+	if (list_instances(source, &files, &nfiles))
+		goto CLEANUP;
+	if (verbose)
+		printf("Batch of %d instances from %s\n", nfiles, source);
+
+	// The records and the counter are shared with the workers
+	size = sizeof(int) * 16 + (nfiles + 1) * sizeof(BEL_BatchRecord);
+	next = (int *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (next == (int *) MAP_FAILED)
+	{
+		fprintf(stderr, "Cannot allocate the batch records\n");
+		goto CLEANUP;
+	}
+	records = (BEL_BatchRecord *) (next + 16);
+	*next = 0;
+	for (i = 0; i < nfiles; i++)
+	{
+		memset(&records[i], 0, sizeof(BEL_BatchRecord));
+		strcpy(records[i].fname, files[i]);
+		records[i].status = BEL_BATCH_NOT_RUN;
+	}
+
+	if (nprocs > nfiles)
+		nprocs = nfiles;
+	if (nprocs <= 1)
+		batch_worker(files, nfiles, records, next, solve);
+	else
+	{
+		pid_t pid;
+		int nforked = 0;
+
+		fflush(stdout);
+		fflush(stderr);
+		for (i = 0; i < nprocs; i++)
+		{
+			if ((pid = fork()) == 0)
+			{
+				batch_worker(files, nfiles, records, next, solve);
+				fflush(stdout);
+				_exit(0);
+			}
+			if (pid < 0)
+			{
+				fprintf(stderr, "Cannot fork worker %d, going on with %d\n", i, nforked);
+				break;
+			}
+			nforked++;
+		}
+		// With no worker at all, the instances are solved here
+		if (nforked == 0)
+			batch_worker(files, nfiles, records, next, solve);
+		while (wait(NULL) > 0)
+			;
+	}
+
+	for (i = 0; i < nfiles; i++)
+	{
+		if (records[i].status != BEL_BATCH_SOLVED)
+			(*failed)++;
+		if (verbose)
+			printf("%s: %s, cost %d, %d vehicles, %.2f seconds\n", records[i].fname,
+				batch_status[records[i].status], records[i].cost, records[i].nvehicles,
+				records[i].totaltime);
+	}
+	rval = write_summary(summary, records, nfiles);
+	munmap(next, size);
+
+CLEANUP:
+	for (i = 0; i < nfiles; i++)
+		free(files[i]);
+	free(files);
+	return rval;
+}
@@ -27,11 +27,7 @@
 
 
 #include "beluga.h"
-
-#define CC_JUST_SUBTOUR (1) //!< See Concorde.
-#define CC_JUST_BLOSSOM (2) //!< See Concorde.
-#define CC_JUST_SUBTOUR_AND_BLOSSOM (3) //!< See Concorde.
-#define CC_JUST_FAST_CUTS (4) //!< See Concorde.
+#include <pthread.h>
 
 /**
  *	Global static variables
@@ -39,590 +35,56 @@
 
 static char *optfname			= "tour.opt"; //!< Name of the optimal tour output file
 static char *tsplibfname	= "instance.vrp"; //!< Name of the TSPLIB input file
+static char *vrpbfname		= (char *) NULL; //!< Name of the .vrpb file to write the instance to
 static int silent					= 0; //!< Verbose feedback
 static int curr_depot			= 0; //!< The depot we are considering.
+static int nworkers				= 1; //!< Number of threads solving route TSPs.
+static int cclp_candidates	= BEL_CCLP_CANDIDATES; //!< Candidate seeds of each customer, 0 for all
+static int cluster_method	= BEL_CLUSTER_MIP; //!< How phase 1 clusters the customers
+static int ls_neighbors		= BEL_LS_NEIGHBORS; //!< Neighbor list length of the local search, 0 to skip it
 
 static int norm						= CC_EUCLIDEAN; //!< Norm for node distances
 static char *datfname			= (char *) NULL;
-static char *edgegenfname = (char *) NULL;
-static char *problname		= (char *) NULL;
-static char *probfname		= (char *) NULL;
-static char *edgefname		= (char *) NULL;
-static char *fullfname		= (char *) NULL;
-static char *tourfname		= (char *) NULL;
-static char *poolfname		= (char *) NULL;
-static char *restartfname	= (char *) NULL;
-static char *xfname				= (char *) NULL;
 static char *outfname			= (char *) NULL;
-static char *filecutname	= (char *) NULL;
 static int seed						= 0;
 static int nnodes_want		= 0;
 static int binary_in			= 0;
 static int tsplib_in			= 1; //!< Input data should be read from a TSPLIB file
-static int just_cuts			= 0;
-static int dontcutroot		= 0;
-static int usetighten			= 0;
-static int usedominos			= 0;
-static int maxchunksize		= 16;
-static int multiple_chunker	= 0;
-static int valid_edges		= 0;
-static int dfs_branching	= 0;
-static int bfs_branching	= 1;
-static int simple_branching	= 0;
-static int usebranchcliques	= 1;
-static int tentative_branch_num = 0;
-static int complete_price	= 0;
-static int want_rcnearest	= 0;
-static int output_tour_as_edges = 0;
 static int run_silently		= 1;
-static int be_nethost			= 0;
-static int unlink_files		= 0;
-static double initial_ub	= CCtsp_LP_MAXDOUBLE;
-static unsigned short hostport = CCtsp_HOST_PORT;
-static int eliminate_edges = -1; //!< Set to 1 to force elim, 0 to not elim
-static int eliminate_sparse = 0;   //!<  Set to 1 to elim from full edge list.
-
-static int longedge_branching = 1; //!<  Set to 0 to turn off.
-static int save_proof			= 0; //!<  Set to 1 to save the proof.
-static int standalone_branch = 0;  //!<  Set to 1 to do a manual branch .
+static int in_memory			= 0; //!< Solve the route TSPs without writing files
+static int tsp_method			= BEL_TSP_EXACT; //!< How the route TSPs are solved
+
+static int cachesize			= BEL_ROUTECACHE_SIZE; //!< Number of routes kept in the route cache
+static char *cachefname		= (char *) NULL; //!< Route cache file, kept across runs
+static BEL_TSPContext tspctx; //!< TSP solver context, shared by all the routes
+static BEL_RouteCache routecache; //!< Optimal tours of the routes already solved
+
+static char *batchsource	= (char *) NULL; //!< Directory, glob or manifest of the instances of a batch
+static char *batchsummary	= (char *) NULL; //!< Summary of a batch, JSON Lines or CSV
+static char *batchtourdir	= (char *) NULL; //!< Directory the tours of a batch are written to
+static int batchprocs			= 1; //!< Number of processes solving a batch
+static char *profilefname	= (char *) NULL; //!< JSON file the profile is written to
+static char *tracefname		= (char *) NULL; //!< JSON file the trace events are written to
+static int perfcounters		= 0; //!< Read the hardware counters at every phase
 
 /**
  *  Function prototypes
  */
 
 static int
-    handle_just_cuts (CCtsp_lp *lp, int the_cuts, CCrandstate *rstate,
-       int silent),
-    run_hk (int ncount, CCdatagroup *dat, int *hk_tour),
-    build_edges (int *p_ecount, int **p_elist, int **p_elen,
-        int ncount, int *ptour, CCdatagroup *dat, char *in_edgefname,
-        char *in_edgegenfname, int in_just_cuts, int silent,
-        CCrandstate *rstate),
-    build_fulledges (int *p_excount, int **p_exlist, int **p_exlen,
-        int ncount, int *ptour, char *in_fullfname),
-    parseargs (int ac, char **av),
-    find_tour (int ncount, CCdatagroup *dat, int *perm, double *ub,
-            int trials, int silent, CCrandstate *rstate),
-    getedges (CCdatagroup *dat, CCedgegengroup *plan, int ncount, int *ecount,
-            int **elist, int **elen, int silent, CCrandstate *rstate),
-    dump_rc (CCtsp_lp *lp, int count, char *pname, int usesparse);
+    parseargs (int ac, char **av);
 static void
-    adjust_upbound (double *bound, int ncount, CCdatagroup *dat),
     usage(char *);
+static int
+    batch_solve(char *fname, BEL_BatchRecord *rec);
+static int
+    route_datagroup(BEL_VRPData *data, int n, int *set, CCdatagroup *dat);
+static int
+    solve_giant_tour(BEL_VRPData *data, int depot, int items, int customer2node[],
+    BEL_VRPSolution *sol);
+static void
+    improve_routes(BEL_VRPData *data, BEL_VRPSolution *sol, int depot);
     
-/** Solves a TSP instance calling Concorde TSP solver.
- *
- *	This function accepts a CCdatagroup as input, the number of nodes in the tour 
- *	and the name to identify the TSP instance. Returns the optimal tour to the caller
- *	as a sequence of node indexes stored in an integer array.
- *
- *  @param ncount Number of nodes in the tour
- *  @param dat  TSP instance data
- *  @param probname A name describing this TSP instance
- *  @return	The optimal tour as a list of nodes
- */
-
-int *BEL_TSPSolve(int ncount, CCdatagroup *dat, char *probname)
-{
-    int i, rval;
-    int ecount = 0;
-    int excount = 0;
-    int bbcount = 0;
-    int *elist = (int *) NULL;
-    int *elen = (int *) NULL;
-    int *ptour = (int *) NULL;
-    int *exlist = (int *) NULL;
-    int *exlen = (int *) NULL;
-    int *besttour = (int *) NULL;
-
-    int is_infeasible = 0;
-    double szeit;
-    double upbound = 0.0;
-    double branchzeit = 0.0;
-    char buf[1024];
-    CCtsp_cutselect sel, tentativesel;
-    CCrandstate rstate;
-    CCtsp_lp *lp = (CCtsp_lp *) NULL;
-    CCtsp_lpcuts *pool = (CCtsp_lpcuts *) NULL;
-    CCtsp_lpcuts *dominopool = (CCtsp_lpcuts *) NULL;
-
-    szeit = CCutil_zeit ();
-
-    CCutil_printlabel ();
-    CCutil_signal_init ();
-    CCutil_sprand (seed, &rstate);
-    
-    if (!be_nethost) {
-        hostport = 0;
-    }
-
-    CCtsp_init_cutselect (&sel);
-    CCtsp_init_tentative_cutselect (&tentativesel);
-    CCtsp_cutselect_tighten (&sel, usetighten);
-    CCtsp_cutselect_tighten (&tentativesel, usetighten);
-    CCtsp_cutselect_chunksize (&sel, maxchunksize);
-    CCtsp_cutselect_dominos (&sel, usedominos);
-    if (filecutname) CCtsp_cutselect_filecuts (&sel, filecutname);
-
-    if (problname == (char *) NULL) {
-        problname = probname;
-    }
-        /* Handle small instances */
-
-        if (ncount < 3) {
-            besttour = CC_SAFE_MALLOC (ncount, int);
-            CCcheck_NULL (besttour, "out of memory for besttour");
-            ptour = CC_SAFE_MALLOC (ncount, int);
-            CCcheck_NULL (ptour, "out of memory for ptour");
-            printf("I wish everything was that easy!!\n");
-            for (i = 0; i < ncount; i++)
-            {
-              besttour[i] = i;
-              ptour[i] = i;
-            }
-            goto CLEANUP;
-        } else if (ncount < 10) {
-            besttour = CC_SAFE_MALLOC (ncount, int);
-            CCcheck_NULL (besttour, "out of memory for besttour");
-            if (ncount == 3) {
-                printf("This one is easy, baby!\n");
-                for (i = 0; i < ncount; i++) besttour[i] = i;
-            } else {
-                rval = run_hk (ncount, dat, besttour);
-                CCcheck_rval (rval, "run_hk failed");
-            }
-            ptour = CC_SAFE_MALLOC (ncount, int);
-            CCcheck_NULL (ptour, "out of memory for ptour");
-            for (i = 0; i < ncount; i++) ptour[i] = i;
-            rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
-                                   outfname, output_tour_as_edges, silent);
-            CCcheck_rval (rval, "CCtsp_dumptour failed");
-            printf ("Total Running Time: %.2f (seconds)\n",
-                     CCutil_zeit () - szeit);
-            fflush (stdout);
-#ifdef DEBUG
-    print_array(ncount, besttour, "besttour");
-    print_array(ncount, ptour, "ptour");
-#endif
-
-            goto CLEANUP;
-        }
-        /***** Get the permutation tour and permute the data  *****/
-
-        ptour = CC_SAFE_MALLOC (ncount, int);
-        CCcheck_NULL (ptour, "out of memory for ptour");
-
-        if (tourfname) {
-            rval = CCutil_getcycle (ncount, tourfname, ptour, 0);
-            CCcheck_rval (rval, "CCutil_getcycle failed");
-        } else {
-            double bnd;
-            if (just_cuts > 0) {
-                rval = find_tour (ncount, dat, ptour, &bnd, -1, silent,
-                                  &rstate);
-            } else if (initial_ub == CCtsp_LP_MAXDOUBLE) {
-                rval = find_tour (ncount, dat, ptour, &bnd, 1, silent,
-                                  &rstate);
-            } else {
-                if (!silent) {
-                    printf ("Initial bnd %f - use short LK\n", initial_ub);
-                    fflush (stdout);
-                }
-                rval = find_tour (ncount, dat, ptour, &bnd, 0, silent,
-                                 &rstate);
-            }
-            CCcheck_rval (rval, "find_tour failed");
-        }
-        rval = CCutil_datagroup_perm (ncount, dat, ptour);
-        CCcheck_rval (rval, "CCutil_datagroup_perm failed");
-
-        sprintf (buf, "%s.mas", probname);
-        rval = CCutil_putmaster (buf, ncount, dat, ptour);
-        CCcheck_rval (rval, "CCutil_putmaster failed");
-    adjust_upbound (&initial_ub, ncount, dat);
-    if (!probfname && !restartfname) {
-        rval = build_edges (&ecount, &elist, &elen, ncount, ptour,
-                            dat, edgefname, edgegenfname, just_cuts,
-                            silent, &rstate);
-        CCcheck_rval (rval, "build_edges failed");
-    }
-
-    rval = build_fulledges (&excount, &exlist, &exlen, ncount, ptour,
-                            fullfname);
-    CCcheck_rval (rval, "build_fulledges failed");
-    rval = CCtsp_init_cutpool (&ncount, poolfname, &pool);
-    CCcheck_rval (rval, "CCtsp_init_cutpool failed");
-#ifdef CCtsp_USE_DOMINO_CUTS
-    rval = CCtsp_init_cutpool (&ncount, dominopoolfname, &dominopool);
-    CCcheck_rval (rval, "CCtsp_init_cutpool failed for dominos");
-#endif
-
-    /***** Initialize besttour to be the permutation tour  ****/
-
-    besttour = CC_SAFE_MALLOC (ncount, int);
-#ifdef DEBUG
-    print_array(ncount, besttour, "besttour");
-    print_array(ncount, ptour, "ptour");
-#endif
-    CCcheck_NULL (besttour, "out of memory for besttour");
-    for (i = 0; i < ncount; i++) {
-        besttour[i] = i;
-    }
-    if (restartfname) {
-        upbound  = initial_ub;
-        bbcount = 0;
-
-        rval = CCtsp_bfs_restart (problname, restartfname, &sel,
-                &tentativesel, &upbound, &bbcount, usebranchcliques, dat,
-                ptour, pool, ncount, besttour, hostport, &branchzeit,
-                save_proof, tentative_branch_num, longedge_branching,
-                (double *) NULL, (int *) NULL, silent, &rstate);
-        CCcheck_rval (rval, "CCtsp_bfs_restart failed");
-        goto DONE;
-    }
-    rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
-                           (char *) NULL, 0, silent);
-    CCcheck_rval (rval, "CCtsp_dumptour failed");
-    rval = CCtsp_init_lp (&lp, problname, -1, probfname, ncount, dat,
-                    ecount, elist, elen, excount, exlist, exlen, valid_edges,
-                    ptour, initial_ub, pool, dominopool, silent, &rstate);
-    if (rval == 2) {
-        printf ("CCtsp_init_lp reports an infeasible LP\n");
-        rval = CCtsp_verify_infeasible_lp (lp, &is_infeasible, silent);
-        CCcheck_rval (rval, "CCtsp_verify_infeasible_lp failed");
-        if (!is_infeasible) {
-            printf ("Couldn't verify infeasible LP\n"); fflush (stdout);
-            rval = 1; goto CLEANUP;
-        }
-        upbound = CCtsp_LP_MAXDOUBLE;
-        bbcount = 1;
-        goto DONE;
-    } else if (rval) {
-        fprintf (stderr, "CCtsp_init_lp failed\n"); goto CLEANUP;
-    }
-    CCutil_start_timer (&lp->stats.total);
-
-    ecount = 0;
-    CC_IFFREE (elist, int);
-    CC_IFFREE (elen, int);
-    excount = 0;
-    CC_IFFREE (exlist, int);
-    CC_IFFREE (exlen, int);
-    if (0 && lp->full_edges_valid) {
-        if (CCtsp_inspect_full_edges (lp)) {
-            fprintf (stderr, "full edge set does not contain all LP edges\n");
-            rval = 1; goto CLEANUP;
-        }
-    }
-    if (standalone_branch) {
-        rval = CCtsp_do_interactive_branch (lp, silent, &rstate);
-        CCcheck_rval (rval, "CCtsp_do_interactive_branch failed");
-        printf ("Total Running Time: %.2f (seconds)\n", CCutil_zeit () - szeit);
-        goto CLEANUP;
-    }
-
-    if (just_cuts > 0) {
-        rval = handle_just_cuts (lp, just_cuts, &rstate, silent);
-        CCcheck_rval (rval, "handle_just_cuts failed");
-        if (want_rcnearest) {
-            rval = dump_rc (lp, want_rcnearest, probname, 0);
-            CCcheck_rval (rval, "dump_rc failed");
-        }
-        if (xfname) {
-            rval = CCtsp_dump_x (lp, xfname);
-            CCcheck_rval (rval, "CCtsp_dump_x failed");
-        }
-        goto DONE;
-    }
-
-    rval = CCtsp_cutselect_set_tols (&sel, lp, 1, silent);
-    CCcheck_rval (rval, "CCtsp_cutselect_set_tols failed");
-
-    if (dontcutroot == 0) {
-        if (multiple_chunker) {
-            rval = CCtsp_cutting_multiple_loop (lp, &sel, 1, maxchunksize,
-                                    1, silent, &rstate);
-        } else {
-            rval = CCtsp_cutting_loop (lp, &sel, 1, silent, &rstate);
-        }
-        if (rval == 2) {
-            printf ("CCtsp_cutting_loop reports an infeasible LP\n");
-            rval = CCtsp_verify_infeasible_lp (lp, &is_infeasible, silent);
-            CCcheck_rval (rval, "CCtsp_verify_infeasible_lp failed");
-            if (!is_infeasible) {
-                printf ("Couldn't verify infeasibile LP\n");
-                fflush (stdout);
-                rval = 1; goto CLEANUP;
-            }
-            upbound = CCtsp_LP_MAXDOUBLE;
-            bbcount = 1;
-            CCutil_stop_timer (&lp->stats.total, 1);
-            printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
-                    CClp_nrows (lp->lp), CClp_ncols (lp->lp),
-                    CClp_nnonzeros (lp->lp));
-
-            goto DONE;
-        } else if (rval) {
-            fprintf (stderr, "cutting_loop failed\n");
-            goto CLEANUP;
-        }
-    }
-
-        double tourval;
-        CCutil_start_timer (&lp->stats.linkern);
-        rval = CCtsp_call_x_heuristic (lp, &tourval, besttour, silent, &rstate);
-        CCcheck_rval (rval, "CCtsp_call_x_heuristic failed");
-
-        if (!silent) CCutil_stop_timer (&lp->stats.linkern, 1);
-        else         CCutil_stop_timer (&lp->stats.linkern, 0);
-
-        if (tourval < lp->upperbound) {
-            printf ("New upperbound from x-heuristic: %.2f\n", tourval);
-            lp->upperbound = tourval;
-            rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
-                                   (char *) NULL, 0, silent);
-            CCcheck_rval (rval, "CCtsp_dumptour failed");
-        }
-        printf ("Final lower bound %f, upper bound %f\n", lp->lowerbound,
-                                                          lp->upperbound);
-        fflush (stdout);
-
-    if (xfname) {
-        rval = CCtsp_dump_x (lp, xfname);
-        CCcheck_rval (rval, "CCtsp_dump_x failed");
-    }
-    if (want_rcnearest) {
-        rval = dump_rc (lp, want_rcnearest, probname, 0);
-        CCcheck_rval (rval, "dump_rc failed");
-    }
-
-    if (lp->graph.ncount < 100000 || complete_price) {
-        CCbigguy bound;
-        CCbigguy bupper;
-        rval = CCtsp_exact_price (lp, &bound, complete_price, 0, silent);
-        if (rval) {
-            fprintf (stderr, "CCtsp_exact_price failed\n");
-            goto CLEANUP;
-        }
-        lp->exact_lowerbound = bound;
-        printf ("Exact lower bound: %.6f\n", CCbigguy_bigguytod (bound));
-        if (1 || !silent) {
-            printf ("DIFF: %f\n", lp->lowerbound - CCbigguy_bigguytod (bound));
-            fflush (stdout);
-        }
-
-        bupper = CCbigguy_dtobigguy (lp->upperbound);
-        CCbigguy_sub (&bupper, CCbigguy_ONE);
-
-        if (CCbigguy_cmp (lp->exact_lowerbound, bupper) > 0) {
-            upbound = lp->upperbound;
-            bbcount = 1;
-            if (!dfs_branching && !bfs_branching) {
-                printf ("Optimal Solution: %.2f\n", upbound);
-                printf ("Number of bbnodes: %d\n", bbcount);
-                fflush (stdout);
-            }
-            if (!silent) {
-                CCutil_stop_timer (&lp->stats.total, 1);
-            } else {
-                CCutil_stop_timer (&lp->stats.total, 0);
-            }
-            printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
-                    CClp_nrows (lp->lp), CClp_ncols (lp->lp),
-                    CClp_nnonzeros (lp->lp));
-
-            if (dat->ndepot > 0) {
-                rval = CCtsp_depot_valid (lp, dat->ndepot, (int *) NULL);
-                CCcheck_rval (rval, "CCtsp_depot_valid failed");
-            }
-            goto DONE;
-        }
-
-        if (dat->ndepot == 0 && eliminate_edges) {
-            rval = CCtsp_eliminate_variables (lp, eliminate_sparse, silent);
-            CCcheck_rval (rval, "CCtsp_eliminate_variables failed");
-        }
-    } else {
-        printf ("During testing, do not exact price large problems\n");
-        fflush (stdout);
-        CCutil_stop_timer (&lp->stats.total, 1);
-        printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
-                CClp_nrows (lp->lp), CClp_ncols (lp->lp),
-                CClp_nnonzeros (lp->lp));
-
-        goto DONE;
-    }
-#ifdef DEBUG
-  	print_array(ncount, besttour, "besttour");
-    print_array(ncount, ptour, "ptour");
-#endif
-    CCutil_stop_timer (&lp->stats.total, 1);
-    printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
-            CClp_nrows (lp->lp), CClp_ncols (lp->lp),
-            CClp_nnonzeros (lp->lp));
-    fflush (stdout);
-
-    if (dat->ndepot > 0) {
-        rval = CCtsp_depot_valid (lp, dat->ndepot, (int *) NULL);
-        CCcheck_rval (rval, "CCtsp_depot_valid failed");
-        goto DONE;
-    }
-
-    if (dfs_branching) {
-        upbound = lp->upperbound;
-        bbcount = 0;
-
-        if (simple_branching) CCtsp_init_simple_cutselect (&sel);
-        rval = CCtsp_easy_dfs_brancher (lp, &sel, 0, &upbound, &bbcount,
-                     usebranchcliques, besttour, longedge_branching,
-                     simple_branching, silent, &rstate);
-        CCcheck_rval (rval, "CCtsp_easy_dfs_brancher failed");
-    } else if (bfs_branching) {
-        double lowbound = lp->lowerbound;
-        int id          = lp->id;
-
-        upbound  = lp->upperbound;
-        bbcount = 0;
-
-        rval = CCtsp_write_probroot_id (problname, lp);
-        CCcheck_rval (rval, "CCtsp_write_probroot_id failed");
-        CCtsp_free_tsp_lp_struct (&lp);
-
-        rval = CCtsp_bfs_brancher (problname, id, lowbound, &sel,
-                &tentativesel, &upbound, &bbcount, usebranchcliques, dat,
-                ptour, pool, ncount, besttour, hostport, &branchzeit,
-                save_proof, tentative_branch_num, longedge_branching,
-                (double *) NULL, (int *) NULL, silent, &rstate);
-        CCcheck_rval (rval, "CCtsp_bfs_brancher failed");
-    }
-
-DONE:
-#ifdef DEBUG
-    print_array(ncount, besttour, "besttour");
-    print_array(ncount, ptour, "ptour");
-#endif
-    if (dfs_branching || bfs_branching || restartfname) {
-        printf ("Optimal Solution: %.2f\n", upbound);
-        printf ("Number of bbnodes: %d\n", bbcount);
-        fflush (stdout);
-        rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
-                               outfname, output_tour_as_edges, silent);
-        CCcheck_rval (rval, "CCtsp_dumptour failed");
-    } else {
-        rval = CCtsp_write_probfile_sav (lp);
-        CCcheck_rval (rval, "CCtsp_write_probfile_sav failed");
-    }
-
-    printf ("Total Running Time: %.2f (seconds)", CCutil_zeit () - szeit);
-    if (branchzeit != 0.0) {
-        printf ("  Branching Time: %.2f (seconds)", branchzeit);
-    }
-    printf ("\n"); fflush (stdout);
-
-    /*  CCtsp_output_statistics (&lp->stats);  */
-
-    if (pool && pool->cutcount) {
-        if (!silent) {
-            printf ("Final Pool: %d cuts\n", pool->cutcount); fflush (stdout);
-        }
-        sprintf (buf, "%s.pul", probname);
-        rval = CCtsp_write_cutpool (ncount, buf, pool);
-        CCcheck_rval (rval, "CCtsp_write_cutpool failed");
-    }
-
-#ifdef CCtsp_USE_DOMINO_CUTS
-    if (dominopool && dominopool->cutcount) {
-        if (1 || !silent) {
-            printf ("Final Domino Pool: %d cuts\n", dominopool->cutcount);
-            fflush (stdout);
-        }
-        sprintf (buf, "%s.dominopul", probname);
-        rval = CCtsp_write_cutpool (ncount, buf, dominopool);
-        CCcheck_rval (rval, "CCtsp_write_cutpool failed");
-    }
-#endif
-
-    if (sel.remotepool && pool && pool->cutcount > pool->savecount) {
-        rval = CCtsp_send_newcuts (ncount, pool, sel.remotehost,
-                sel.remoteport);
-        if (rval) {
-            fprintf (stderr, "CCtsp_send_newcuts failed\n");
-            rval = 0;
-        }
-    }
-
-    rval = 0;
-
-CLEANUP:
-
-    if (unlink_files) {
-        if (!run_silently) {
-            printf ("Delete the temporary files: pul sav mas\n");
-            fflush (stdout);
-        }
-
-        sprintf (buf, "%s.pul", probname);
-        rval = unlink (buf);
-        if (rval && !run_silently) {
-            printf ("CCutil_sdelete_file failed for %s\n", buf);
-        }
-
-        sprintf (buf, "O%s.pul", probname);
-        rval = unlink (buf);
-        if (rval && !run_silently) {
-            printf ("CCutil_sdelete_file failed for %s\n", buf);
-        }
-
-        sprintf (buf, "%s.sav", probname);
-        rval = unlink (buf);
-        if (rval && !run_silently) {
-            printf ("CCutil_sdelete_file failed for %s\n", buf);
-        }
-
-        sprintf (buf, "O%s.sav", probname);
-        rval = unlink (buf);
-        if (rval && !run_silently) {
-            printf ("CCutil_sdelete_file failed for %s\n", buf);
-        }
-
-        sprintf (buf, "%s.mas", probname);
-        rval = unlink (buf);
-        if (rval && !run_silently) {
-            printf ("CCutil_sdelete_file failed for %s\n", buf);
-        }
-
-        sprintf (buf, "O%s.mas", probname);
-        rval = unlink (buf);
-        if (rval && !run_silently) {
-            printf ("CCutil_sdelete_file failed for %s\n", buf);
-        }
-    }
-
-    if (lp) CCtsp_free_tsp_lp_struct (&lp);
-    if (pool) { CCtsp_free_cutpool (&pool); }
-    if (dominopool) { CCtsp_free_cutpool (&dominopool); }
-
-	int k, *tour = (int *) NULL;
-	tour = (int *)calloc(ncount, sizeof(int));
-	
-    for (k = 0; k < ncount; k++)
-    {
-		tour[k] = ptour[besttour[k]];
-    }
-#ifdef DEBUG
-	print_array(ncount, tour, "tour");
-#endif
-
-    CC_IFFREE (elist, int);
-    CC_IFFREE (elen, int);
-    CC_IFFREE (exlist, int);
-    CC_IFFREE (exlen, int);
-    CC_IFFREE (ptour, int);
-    CC_IFFREE (besttour, int);
-
-    return tour;
-}
-
 /** Main function
  *
  *  The main function parses the commandline arguments, creates a VRP instance,
@@ -653,12 +115,80 @@ int main(int argc, char** argv)
 	if (!silent)
   	printf ("Using random seed %d\n", seed); fflush (stdout);
 
+	/**
+	 *  Forked batch workers would fill their own copies of the profile, the
+	 *  trace, the counters and the route cache, and the parent would write out
+	 *  its own, empty ones. The workers still use the cache loaded here.
+	 */
+	if (batchsource && batchprocs > 1 && (profilefname || tracefname || perfcounters || cachefname))
+	{
+		fprintf(stderr, "Warning: -J, --trace and -H are ignored and the route cache is not saved "
+			"by a batch of %d processes.\n", batchprocs);
+		profilefname = tracefname = (char *) NULL;
+		perfcounters = 0;
+	}
+
+	// Timers and counters cost next to nothing unless asked for
+	BEL_InitProfile(profilefname != (char *) NULL);
+	if (tracefname)
+		BEL_InitTrace();
+	if (perfcounters)
+		BEL_InitPerf(!silent);
+
+	// Set up the TSP solver once, it will be reused for every route
+	BEL_InitTSPContext(&tspctx);
+	tspctx.seed = seed;
+	tspctx.outfname = outfname;
+	tspctx.silent = silent;
+	tspctx.in_memory = in_memory;
+	tspctx.method = tsp_method;
+	if (BEL_WarmTSPContext(&tspctx))
+	{
+		fprintf(stderr, "Error: couldn't set up the TSP solver. Aborting.\n");
+		exit(1);
+	}
+	// Routes solved by previous runs, if any
+	if (BEL_InitRouteCache(&routecache, cachesize) ||
+		(cachefname && BEL_RouteCacheLoad(&routecache, cachefname)))
+	{
+		fprintf(stderr, "Warning: couldn't load the route cache.\n");
+	}
+
+	// In batch mode the warm contexts are reused for every instance
+	if (batchsource)
+	{
+		int failed;
+		rval = BEL_SolveBatch(batchsource, batchsummary, batchprocs, batch_solve, &failed, !silent);
+		if (!rval && failed)
+			fprintf(stderr, "%d instances of the batch were not solved.\n", failed);
+		if (routecache.maxentries && cachefname && batchprocs <= 1)
+			BEL_RouteCacheSave(&routecache, cachefname);
+		BEL_FreeRouteCache(&routecache);
+		if (profilefname && BEL_WriteProfile(profilefname))
+			fprintf(stderr, "Warning: couldn't write the profile to %s.\n", profilefname);
+		if (tracefname && BEL_WriteTrace(tracefname))
+			fprintf(stderr, "Warning: couldn't write the trace to %s.\n", tracefname);
+		BEL_PrintPerf();
+		BEL_FreePerf();
+		BEL_FreeTrace();
+		BEL_FreeProfile();
+		return (rval || failed);
+	}
+
   // Initialize data structures
 	BEL_InitVRPData(&data);
 	BEL_InitVRPSolution(&sol);
   
 	// What data source are we using?
-	if (tsplib_in && datfname != (char *) NULL)
+	BEL_PhaseBegin(BEL_PHASE_READ);
+	if (tsplib_in && datfname != (char *) NULL && strlen(datfname) > 5 &&
+		!strcmp(datfname + strlen(datfname) - 5, ".vrpb"))
+	{
+		// A binary instance, possibly with its distance matrix
+		rval = BEL_VRPReadBinary(datfname, &data, !silent);
+		ncount = data.dimension;
+	}
+	else if (tsplib_in && datfname != (char *) NULL)
 	{
 		// We are reading data from a TSPLIB file
 		rval = BEL_VRPReadTSPLIB(datfname, &data, !silent);
@@ -674,11 +204,19 @@ int main(int argc, char** argv)
                            use_gridsize, allow_dups, &rstate, !silent);
 
   	}
+	BEL_PhaseEnd(BEL_PHASE_READ);
 	if (rval)
 	{
 		fprintf(stderr, "Error during data acquisition. Aborting.\n");
 		exit(1);
 	}
+	// Every edge length is computed once, here, unless the .vrpb file had them
+	BEL_PhaseBegin(BEL_PHASE_DISTANCES);
+	if (!data.dist)
+		BEL_BuildDistMatrix(&data, !silent);
+	BEL_PhaseEnd(BEL_PHASE_DISTANCES);
+	if (vrpbfname && BEL_VRPWriteBinary(vrpbfname, &data))
+		fprintf(stderr, "Warning: couldn't write %s.\n", vrpbfname);
 	
 #ifdef DEBUG
 	int adj[ncount][ncount];
@@ -687,7 +225,7 @@ int main(int argc, char** argv)
   {
     for (l = 0; l < ncount; l++)
     {
-      adj[k][l] = ((&data)->dat->edgelen)(k, l, (&data)->dat);
+      adj[k][l] = BEL_Dist(&data, k, l);
     }
   }
   print_matrix(ncount, ncount, &adj, "adj");
@@ -704,7 +242,10 @@ int main(int argc, char** argv)
 	int errCode;
 	if (!silent)
 		printf("Determining problem feasibility...\n");
-	if (!BEL_VRPProblemIsFeasible(&data, &errCode, !silent))
+	BEL_PhaseBegin(BEL_PHASE_FEASIBILITY);
+	rval = !BEL_VRPProblemIsFeasible(&data, &errCode, !silent);
+	BEL_PhaseEnd(BEL_PHASE_FEASIBILITY);
+	if (rval)
 	{
 		printf("Error: this is not a feasible instance of VRP (%d). Exiting.\n", errCode);
 		exit(1);
@@ -715,9 +256,14 @@ int main(int argc, char** argv)
 	 *  we cannot solve it, notify the user and then abort.
 	 */
 	 
-	if (!BEL_SolveVRPProblem(&data, &sol))
+	double start = BEL_TraceClock();
+	rval = BEL_SolveVRPProblem(&data, &sol);
+	BEL_TraceComplete("solve", "phase", start, "nodes", data.dimension, "vehicles", data.nvehicles);
+	if (!rval)
 	{
+		BEL_PhaseBegin(BEL_PHASE_OUTPUT);
     BEL_PrintVRPSolution(&sol, optfname, !silent);
+		BEL_PhaseEnd(BEL_PHASE_OUTPUT);
 	}
 	else
 	{
@@ -734,6 +280,24 @@ int main(int argc, char** argv)
 	{
 		BEL_VRPWriteTSPLIB(tsplibfname, &data);
 	}
+
+	if (routecache.maxentries)
+	{
+		printf("Route cache: %ld hits, %ld misses, %.2f seconds saved\n",
+			routecache.hits, routecache.misses, routecache.saved);
+		if (cachefname)
+			BEL_RouteCacheSave(&routecache, cachefname);
+	}
+	BEL_FreeRouteCache(&routecache);
+
+	if (profilefname && BEL_WriteProfile(profilefname))
+		fprintf(stderr, "Warning: couldn't write the profile to %s.\n", profilefname);
+	if (tracefname && BEL_WriteTrace(tracefname))
+		fprintf(stderr, "Warning: couldn't write the trace to %s.\n", tracefname);
+	BEL_PrintPerf();
+	BEL_FreePerf();
+	BEL_FreeTrace();
+	BEL_FreeProfile();
 	
 	// Sayonara
   return 0;
@@ -862,19 +426,19 @@ int BEL_SolveVRPProblem(BEL_VRPData *data, BEL_VRPSolution *sol)
 {
  	int dimension = data->dimension;
 	int items = data->ncustomers;
-	int seeds = data->nvehicles;
-	int capacity = data->capacity;
 	int depot = data->depots[curr_depot];
+	int nroutes = 0;
+	int rval;
 
 	int demand[items];
-  int cost[items][items];
   int seed_cost[items];
   int cluster[items];
   int customer2node[items];
   int node2customer[dimension];
-	int i, j, k, l;
+	int i, j, k;
+
+	BEL_PhaseBegin(BEL_PHASE_SEEDS);
 	k = 0;
-	l = 0;
 	for (i = 0; i < dimension; i++)
 	{
 		/**
@@ -899,45 +463,52 @@ int BEL_SolveVRPProblem(BEL_VRPData *data, BEL_VRPSolution *sol)
          *  <code>seed_cost<sub>i</sub> = 2d<sub>i0</sub></code>
          */
 
-			seed_cost[k] = 2 * (data->dat->edgelen)(i, depot, data->dat);
-
-			for (j = 0; j < dimension; j++)
-			{
-        /**
-         *  Node cost is defined as the difference between the cost of a path
-         *  from the depot to designed seed through current node
-         *  and the cost of a straight path from the depot to the
-         *  seed
-         *
-         *  <code>cost<sub>ij</sub> = d<sub>i0</sub> + d<sub>ij</sub> - d<sub>j0</sub></code>
-         */
-
-        /**
-				 *	As a further development, we could let the user decide what depot
-				 *	to choose, in multiple-depot instances of VRP.
-				 */
-
-				if (!data->isadepot[j])
-				{
-
-					cost[k][l] = (data->dat->edgelen)(i, depot, data->dat) +
-								 (data->dat->edgelen)(i, j, data->dat) -
-								 (data->dat->edgelen)(depot, j, data->dat);
-					l++;
-				}
-			}
+			seed_cost[k] = 2 * BEL_Dist(data, i, depot);
 			k++;
-			l = 0;
 		}
 	}
+	BEL_PhaseEnd(BEL_PHASE_SEEDS);
 	
-	// Call the CCLP solver
-  BEL_CCLPSolve(items, cost, demand, seeds, seed_cost, capacity, cluster, !silent);
+	/**
+	 *  Call the CCLP solver. Node cost is defined as the difference between
+	 *  the cost of a path from the depot to designed seed through current node
+	 *  and the cost of a straight path from the depot to the seed
+	 *
+	 *  <code>cost<sub>ij</sub> = d<sub>i0</sub> + d<sub>ij</sub> - d<sub>j0</sub></code>
+	 *
+	 *  Each customer only considers its cclp_candidates nearest seeds.
+	 */
+
+  if (cluster_method == BEL_CLUSTER_SPLIT)
+  {
+    // Route first, cluster second: phase 2 comes before phase 1
+    if (solve_giant_tour(data, depot, items, customer2node, sol))
+      return 1;
+    improve_routes(data, sol, depot);
+    return 0;
+  }
+
+  if (cluster_method == BEL_CLUSTER_SAVINGS || cluster_method == BEL_CLUSTER_SWEEP)
+  {
+    // No CCLP at all: the routes of a constructive heuristic are the clusters
+    BEL_PhaseBegin(BEL_PHASE_CLUSTER);
+    if (cluster_method == BEL_CLUSTER_SAVINGS)
+      rval = BEL_SavingsCluster(data, depot, items, customer2node, cclp_candidates, cluster, !silent);
+    else
+      rval = BEL_SweepCluster(data, depot, items, customer2node, nworkers, cluster, !silent);
+    BEL_PhaseEnd(BEL_PHASE_CLUSTER);
+  }
+  else
+    rval = BEL_CCLPCluster(data, depot, items, customer2node, demand, seed_cost,
+      cclp_candidates, cluster_method, cluster, !silent);
+  if (rval)
+  {
+    return 1;
+  }
   
 #ifdef DEBUG
 	print_array(items, demand, "demand");
 	print_array(items, seed_cost, "seed_cost");
-	print_matrix(items, items, cost, "cost");
   print_array(items, cluster, "cluster");
   print_array(items, customer2node, "customer2node");
   print_array(dimension, node2customer, "node2customer");
@@ -950,9 +521,23 @@ int BEL_SolveVRPProblem(BEL_VRPData *data, BEL_VRPSolution *sol)
 	 *	output the sequence. May need to build a custom data structure.
 	 */
 
-  CCdatagroup routes[data->nvehicles];
-  int seed[seeds];
+  // Usually one cluster per vehicle, but some heuristics need more
+  for (i = 0; i < items; i++)
+    nroutes += (cluster[i] == i);
+
+  CCdatagroup routes[nroutes];
+  int *route_set[nroutes];
+  int route_size[nroutes];
+  int *route_tour[nroutes];
+  int seed[nroutes];
   int total_cost = 0, n = 0;
+  for (i = 0; i < nroutes; i++)
+  {
+    CCutil_init_datagroup(&(routes[i]));
+    route_set[i] = (int *) NULL;
+    route_tour[i] = (int *) NULL;
+  }
+  BEL_PhaseBegin(BEL_PHASE_ROUTES);
   for (i = 0; i < items; i++)
   {
 		// If cluster[i] == i then node customer2node[i] is a seed
@@ -965,15 +550,16 @@ int BEL_SolveVRPProblem(BEL_VRPData *data, BEL_VRPSolution *sol)
   print_array(n, seed, "seed");
 #endif
 
-  sol->nvehicles = data->nvehicles;
-  sol->routelen = (int *)calloc(sol->nvehicles, sizeof(int));
-  sol->routes = (int **)calloc(sol->nvehicles, sizeof(int *));
-
-  for (i = 0; i < data->nvehicles; i++)
+  for (i = 0; i < nroutes && !rval; i++)
   {
 		// Group customers into clusters
-    int current_set[items];
+    int *current_set = (int *)calloc(items + 1, sizeof(int));
     int n = 1;
+    if (!current_set)
+    {
+      rval = 1;
+      break;
+    }
     // First element in the cluster is the current depot
     current_set[0] = depot;
     for (j = 0; j < items; j++)
@@ -986,75 +572,47 @@ int BEL_SolveVRPProblem(BEL_VRPData *data, BEL_VRPSolution *sol)
         n++;
       }
     }
+    route_set[i] = current_set;
+    route_size[i] = n;
 #ifdef DEBUG
     print_array(n, current_set, "current_set");
 #endif
-    CCutil_init_datagroup(&(routes[i]));
-    CCutil_dat_setnorm (&(routes[i]), data->dat->norm);
-    if ((data->dat->norm & CC_NORM_SIZE_BITS) == CC_D2_NORM_SIZE) {
-      routes[i].x = CC_SAFE_MALLOC (n, double);
-      if (!routes[i].x) {
-          CCutil_freedatagroup(&(routes[i]));
-          return 1;
-      }
-      routes[i].y = CC_SAFE_MALLOC (n, double);
-      if (!routes[i].y) {
-          CCutil_freedatagroup(&(routes[i]));
-          return 1;
-      }
-      for (k = 0; k < n; k++) {
-          routes[i].x[k] = data->dat->x[current_set[k]];
-          routes[i].y[k] = data->dat->y[current_set[k]];
-#ifdef DEBUG
-          printf("routes[%d].x[%d] = data->dat->x[current_set[%d]] = %f;\n", i, k, k, data->dat->x[current_set[k]]);
-          printf("routes[%d].y[%d] = data->dat->y[current_set[%d]] = %f;\n", i, k, k, data->dat->y[current_set[k]]);
-#endif
-      }
-    }
-    else if ((norm & CC_NORM_SIZE_BITS) == CC_D3_NORM_SIZE) {
-      routes[i].x = CC_SAFE_MALLOC (n, double);
-      if (!routes[i].x) {
-          CCutil_freedatagroup(&(routes[i]));
-          return 1;
-      }
-      routes[i].y = CC_SAFE_MALLOC (n, double);
-      if (!routes[i].y) {
-          CCutil_freedatagroup(&(routes[i]));
-          return 1;
-      }
-      routes[i].z = CC_SAFE_MALLOC (n, double);
-      if (!routes[i].z) {
-          CCutil_freedatagroup(&(routes[i]));
-          return 1;
-      }
-      for (k = 0; k < n; k++) {
-          routes[i].x[k] = data->dat->x[current_set[k]];
-          routes[i].y[k] = data->dat->y[current_set[k]];
-          routes[i].z[k] = data->dat->z[current_set[k]];
-      }
-    }
-    else {
-      fprintf (stderr, "ERROR: Node coordinates with norm %d?\n",
-                   data->dat->norm);
-      return 1;
-    }
-    char routename[255];
-    sprintf(routename, "%s-route-%d", data->name, i);
-    int *tour;
-    sol->routelen[i] = n - 1;
-    sol->routes[i] = (int *)calloc(n - 1, sizeof(int));
+    rval = route_datagroup(data, n, current_set, &(routes[i]));
+  }
 
-#ifdef DEBUG
-    printf("Solving TSP on route %d: ", i);
-    for (k = 0; k < n; k++)
-    {
-      printf("%d ", current_set[k]);
-    }
-    printf("\n");
-#endif
+  // Routes go into a single block, the depot is not stored
+  if (!rval)
+  {
+    n = 0;
+    for (i = 0; i < nroutes; i++)
+      n += route_size[i] - 1;
+    rval = BEL_AllocVRPSolution(sol, nroutes, n, (BEL_Arena *) NULL);
+  }
+  BEL_PhaseEnd(BEL_PHASE_ROUTES);
+  if (rval)
+    goto CLEANUP;
 
-    tour = BEL_TSPSolve(n, &(routes[i]), routename);
+  /**
+   *  Solve the TSP on every cluster. With more than one worker the clusters
+   *  are handed out to a pool of threads, largest first, so that the long
+   *  solves don't end up at the tail of the schedule. Every solve writes only
+   *  to its own slot in route_tour, and the routes are merged below in index
+   *  order, so the solution doesn't depend on which thread got which cluster.
+   */
 
+  if ((rval = BEL_SolveRoutes(&tspctx, &routecache, data, nroutes, routes, route_set, route_size,
+    route_tour, nworkers)))
+  {
+    fprintf(stderr, "Couldn't solve the TSP on every route.\n");
+    goto CLEANUP;
+  }
+
+  BEL_PhaseBegin(BEL_PHASE_MERGE);
+  for (i = 0; i < nroutes; i++)
+  {
+    int *current_set = route_set[i];
+    int *tour = route_tour[i];
+    n = route_size[i];
 #ifdef DEBUG
 		print_array(n, tour, "tour");
     printf("Route %d is: ", i);
@@ -1064,389 +622,435 @@ int BEL_SolveVRPProblem(BEL_VRPData *data, BEL_VRPSolution *sol)
     }
     printf("%d\n", current_set[tour[0]]);
 #endif
-    for (k = 0; k < n; k++)
+    sol->start[i + 1] = sol->start[i] + n - 1;
+    for (k = 1; k < n; k++)
     {
-      if (k > 0)
-      {
-        sol->routes[i][k - 1] = current_set[tour[k]];
-        total_cost += (data->dat->edgelen)(current_set[tour[k - 1]], current_set[tour[k]], data->dat);
-      }
+      sol->nodes[sol->start[i] + k - 1] = current_set[tour[k]];
+      sol->load[i] += data->demand[current_set[tour[k]]];
+      sol->routecost[i] += BEL_Dist(data, current_set[tour[k - 1]], current_set[tour[k]]);
     }
-    total_cost += (data->dat->edgelen)(current_set[tour[n - 1]], current_set[tour[0]], data->dat);
-
-    // Poi magari disegnamo un grafico in SVG! S! S!
+    sol->routecost[i] += BEL_Dist(data, current_set[tour[n - 1]], current_set[tour[0]]);
+    total_cost += sol->routecost[i];
   }
   sol->cost = total_cost;
+  BEL_PhaseEnd(BEL_PHASE_MERGE);
+  if ((rval = BEL_CheckVRPSolution(sol, data)))
+    fprintf(stderr, "The routes of phase 2 are not a valid solution.\n");
+
+CLEANUP:
+  for (i = 0; i < nroutes; i++)
+  {
+    CCutil_freedatagroup(&(routes[i]));
+    free(route_tour[i]);
+    free(route_set[i]);
+  }
+  if (rval)
+    return 1;
+
+  improve_routes(data, sol, depot);
   
   return 0;
 }
 
 /**
- *  See Concorde for details.
+ *  Builds the TSP instance of a route, copying the coordinates of the
+ *  nodes in <code>set</code>.
  *
- *  @see Concorde source
+ *  @return 1 on failure, 0 otherwise
  */
 
-static int handle_just_cuts (CCtsp_lp *lp, int the_cuts, CCrandstate *rstate,
-       int silent)
+static int route_datagroup(BEL_VRPData *data, int n, int *set, CCdatagroup *dat)
 {
-    int rval = 0;
-    CCtsp_cutselect sel;
-
-    if (the_cuts == CC_JUST_FAST_CUTS) {
-        CCtsp_init_fast_cutselect (&sel);
-        rval = CCtsp_cutselect_set_tols (&sel, lp, -1, silent);
-        CCcheck_rval (rval, "CCtsp_cutselect_set_tols failed");
-        rval = CCtsp_cutting_loop (lp, &sel, 1, silent, rstate);
-        CCcheck_rval (rval, "CCtsp_cutting_loop failed");
-    } else if (the_cuts == CC_JUST_SUBTOUR) {
-        rval = CCtsp_subtour_loop (lp, silent, rstate);
-        CCcheck_rval (rval, "CCtsp_subtour_loop failed");
-    } else if (just_cuts == CC_JUST_BLOSSOM) {
-        rval = CCtsp_blossom_loop (lp, silent, rstate);
-        CCcheck_rval (rval, "CCtsp_blossom_loop failed");
-    } else if (just_cuts == CC_JUST_SUBTOUR_AND_BLOSSOM) {
-        rval = CCtsp_subtour_and_blossom_loop (lp, silent, rstate);
-        CCcheck_rval (rval, "CCtsp_subtour_and_blossom_loop failed");
+  int k;
+
+  CCutil_init_datagroup(dat);
+  CCutil_dat_setnorm (dat, data->dat->norm);
+  if ((data->dat->norm & CC_NORM_SIZE_BITS) == CC_D2_NORM_SIZE) {
+    dat->x = CC_SAFE_MALLOC (n, double);
+    dat->y = CC_SAFE_MALLOC (n, double);
+    if (!dat->x || !dat->y) {
+        CCutil_freedatagroup(dat);
+        return 1;
     }
-
-    printf ("Bound: %f\n", lp->lowerbound); fflush (stdout);
-    CCutil_stop_timer (&lp->stats.total, 1);
-    printf ("Final Root LP has %d rows, %d columns, %d nonzeros\n",
-            CClp_nrows (lp->lp), CClp_ncols (lp->lp), CClp_nnonzeros (lp->lp));
-
-CLEANUP:
-
-    return rval;
+    for (k = 0; k < n; k++) {
+        dat->x[k] = data->dat->x[set[k]];
+        dat->y[k] = data->dat->y[set[k]];
+    }
+  }
+  else if ((data->dat->norm & CC_NORM_SIZE_BITS) == CC_D3_NORM_SIZE) {
+    dat->x = CC_SAFE_MALLOC (n, double);
+    dat->y = CC_SAFE_MALLOC (n, double);
+    dat->z = CC_SAFE_MALLOC (n, double);
+    if (!dat->x || !dat->y || !dat->z) {
+        CCutil_freedatagroup(dat);
+        return 1;
+    }
+    for (k = 0; k < n; k++) {
+        dat->x[k] = data->dat->x[set[k]];
+        dat->y[k] = data->dat->y[set[k]];
+        dat->z[k] = data->dat->z[set[k]];
+    }
+  }
+  else {
+    fprintf (stderr, "ERROR: Node coordinates with norm %d?\n",
+                 data->dat->norm);
+    return 1;
+  }
+  return 0;
 }
 
 /**
- *  Run Held-Karp TSP solver for small instances. See Concorde for details.
+ *  Route first, cluster second (Beasley 1983, Prins 2004): solves a single
+ *  TSP over the depot and all the customers, the giant tour, and splits it
+ *  optimally into routes that fit the capacity. The TSP goes through
+ *  BEL_SolveRoutes as a route of its own, so -R applies to it as well. It
+ *  stays out of the route cache: the cache is made for short routes, and
+ *  the tour of a whole instance would never be looked up again.
  *
- *  @see Concorde source
+ *  @return 1 on failure, 0 otherwise
  */
 
-static int run_hk (int ncount, CCdatagroup *dat, int *hk_tour)
+static int solve_giant_tour(BEL_VRPData *data, int depot, int items, int customer2node[],
+  BEL_VRPSolution *sol)
 {
-    double hk_val;
-    int hk_found, hk_yesno;
-    int *hk_tlist = (int *) NULL;
-    int rval = 0;
+  CCdatagroup giant;
+  int *set, *tour = (int *) NULL, *order;
+  int size = items + 1;
+  int i, k, rval = 1;
+
+  set = (int *) malloc(size * sizeof(int));
+  order = (int *) malloc(items * sizeof(int));
+  if (!set || !order)
+  {
+    free(set);
+    free(order);
+    return 1;
+  }
+  set[0] = depot;
+  for (i = 0; i < items; i++)
+    set[i + 1] = customer2node[i];
 
-    hk_tlist = CC_SAFE_MALLOC (2*ncount, int);
-    CCcheck_NULL (hk_tlist, "out of memory for hk_tlist");
+  BEL_PhaseBegin(BEL_PHASE_ROUTES);
+  rval = route_datagroup(data, size, set, &giant);
+  BEL_PhaseEnd(BEL_PHASE_ROUTES);
+  if (rval)
+    goto CLEANUP;
 
-    rval = CCheldkarp_small (ncount, dat, (double *) NULL, &hk_val,
-                             &hk_found, 0, hk_tlist, 1000000, 2);
-    CCcheck_rval (rval, "CCheldkarp_small failed");
-    printf ("Optimal Solution: %.2f\n", hk_val); fflush (stdout);
+  rval = BEL_SolveRoutes(&tspctx, (BEL_RouteCache *) NULL, data, 1, &giant, &set, &size, &tour, 1);
+  CCutil_freedatagroup(&giant);
+  if (rval)
+  {
+    fprintf(stderr, "Couldn't solve the giant tour.\n");
+    goto CLEANUP;
+  }
 
-    rval = CCutil_edge_to_cycle (ncount, hk_tlist, &hk_yesno, hk_tour);
-    CCcheck_rval (rval, "CCutil_edge_to_cycle failed");
+  // The customers in the order of the tour, starting after the depot
+  for (k = 0; tour[k] != 0; k++)
+    ;
+  for (i = 0; i < items; i++)
+    order[i] = set[tour[(k + 1 + i) % size]];
 
-    if (hk_yesno == 0) {
-        fprintf (stderr, "Held-Karp returned list that is not a tour\n");
-        rval = 1;  goto CLEANUP;
-    }
+  BEL_PhaseBegin(BEL_PHASE_CLUSTER);
+  rval = BEL_SplitTour(data, depot, items, order, sol, !silent);
+  BEL_PhaseEnd(BEL_PHASE_CLUSTER);
 
 CLEANUP:
-
-     CC_IFFREE (hk_tlist, int);
-     return rval;
+  free(tour);
+  free(set);
+  free(order);
+  return rval;
 }
 
 /**
- *  See Concorde for details.
- *
- *  @see Concorde source
+ *  The clusters are not revised by phase 2, so customers near the border of
+ *  two clusters may be in the wrong one. Moves them across routes as long as
+ *  the solution gets shorter.
  */
 
-static void adjust_upbound (double *bound, int ncount, CCdatagroup *dat)
+static void improve_routes(BEL_VRPData *data, BEL_VRPSolution *sol, int depot)
 {
-    double bnd;
-    int i;
-
-    bnd = CCutil_dat_edgelen (ncount - 1, 0, dat);
-    for (i = 1; i < ncount; i++) {
-        bnd += CCutil_dat_edgelen (i-1, i, dat);
-    }
-    if (bnd < *bound) {
-        printf ("Set initial upperbound to %.0f (from tour)\n", bnd);
-        fflush (stdout);
-        *bound = bnd;
-    }
+  BEL_PhaseBegin(BEL_PHASE_LOCALSEARCH);
+  if (BEL_VRPLocalSearch(data, sol, depot, ls_neighbors, !silent))
+    fprintf(stderr, "Warning: local search failed, keeping the routes of phase 2.\n");
+  BEL_PhaseEnd(BEL_PHASE_LOCALSEARCH);
 }
 
 /**
- *  See Concorde for details.
- *
- *  @see Concorde source
+ *  A single TSP to be solved by the worker pool.
  */
 
-static int build_edges (int *p_ecount, int **p_elist, int **p_elen,
-        int ncount, int *ptour, CCdatagroup *dat, char *in_edgefname,
-        char *in_edgegenfname, int in_just_cuts, int silent,
-        CCrandstate *rstate)
-{
-    int rval = 0;
-    int *elist = (int *) NULL;
-    int ecount;
-    int i;
-
-    if (in_edgefname) {
-        int *invperm = (int *) NULL;
-
-        printf ("Read initial edge set\n"); fflush (stdout);
-
-        rval = CCutil_getedgelist (ncount, in_edgefname, p_ecount, p_elist,
-                                   p_elen, 0);
-        CCcheck_rval (rval, "CCutil_getedgelist failed");
-        ecount = *p_ecount;
-        elist = *p_elist;
-        printf ("Initial edgeset: %d edges (%d nodes)\n", ecount, ncount);
-        printf ("Rearrange the edges to match the tour order\n");
-        fflush (stdout);
-
-        invperm = CC_SAFE_MALLOC (ncount, int);
-        CCcheck_NULL (invperm, "out of memory for invperm");
-        for (i = 0; i < ncount; i++) invperm[ptour[i]] = i;
-        for (i = 0; i < 2*ecount; i++) elist[i] = invperm[elist[i]];
-        CC_FREE (invperm, int);
-    } else if (dat) {
-        CCedgegengroup plan;
-
-        if (in_edgegenfname) {
-            rval = CCedgegen_read (in_edgegenfname, &plan);
-            CCcheck_rval (rval, "CCedgegen_read failed");
-        } else {
-            CCedgegen_init_edgegengroup (&plan);
-            if (in_just_cuts == CC_JUST_SUBTOUR ||
-                in_just_cuts == CC_JUST_BLOSSOM ||
-                in_just_cuts == CC_JUST_SUBTOUR_AND_BLOSSOM) {
-                plan.tour.greedy = 1;
-                plan.f2match_nearest.number = 4;
-            } else {
-                plan.linkern.count = 10;
-                plan.linkern.quadnearest = 2;
-                plan.linkern.greedy_start = 0;
-                plan.linkern.nkicks = (ncount / 100) + 1;
-            }
-        }
-
-        rval = getedges (dat, &plan, ncount, p_ecount, p_elist, p_elen,
-                         silent, rstate);
-        CCcheck_rval (rval, "getedges failed");
-    }
+typedef struct BEL_TSPJob {
+  int ncount;         //!< Number of nodes in the route, depot included.
+  CCdatagroup *dat;   //!< Route data.
+  char name[255];     //!< Name of the TSP instance.
+  int *tour;          //!< The tour found, or NULL on failure.
+  int cached;         //!< TRUE if the tour was found in the route cache.
+  BEL_TSPStats stats; //!< Outcome of the solve.
+} BEL_TSPJob;
 
-CLEANUP:
+/**
+ *  Shared state of the worker pool. Workers pick the next job from
+ *  <code>order</code> under <code>lock</code>.
+ */
 
-    return rval;
-}
+typedef struct BEL_TSPPool {
+  BEL_TSPContext *ctx;
+  BEL_TSPJob *jobs;
+  int *order;
+  int njobs;
+  int next;
+  pthread_mutex_t lock;
+} BEL_TSPPool;
 
 /**
- *  See Concorde for details.
- *
- *  @see Concorde source
+ *  Solves the TSP of one route, recording it in the trace.
  */
 
-static int build_fulledges (int *p_excount, int **p_exlist, int **p_exlen,
-        int ncount, int *ptour, char *in_fullfname)
+static void solve_job(BEL_TSPContext *ctx, BEL_TSPJob *job, int route)
 {
-    int i;
-    int rval = 0;
-    int *exlist;
-    int excount;
-
-    if (in_fullfname) {
-        int *invperm = (int *) NULL;
-
-        rval = CCutil_getedgelist (ncount, in_fullfname, p_excount, p_exlist,
-                                   p_exlen, 0);
-        CCcheck_rval (rval, "CCutil_getedgelist failed");
-
-        invperm = CC_SAFE_MALLOC (ncount, int);
-        CCcheck_NULL (invperm, "out of memory for invperm");
-        for (i = 0; i < ncount; i++) invperm[ptour[i]] = i;
-        excount = *p_excount;
-        exlist = *p_exlist;
-        for (i = 0; i < 2*excount; i++) exlist[i] = invperm[exlist[i]];
-        CC_FREE (invperm, int);
-    } else {
-        *p_excount = 0;
-    }
-
-CLEANUP:
+  double start = BEL_TraceClock();
 
-    return rval;
+  job->tour = BEL_TSPSolve(ctx, job->ncount, job->dat, job->name, &job->stats);
+  BEL_TraceComplete("route tsp", "tsp", start, "route", route, "nodes", job->ncount);
 }
 
 /**
- *  See Concorde for details.
- *
- *  @see Concorde source
+ *  Worker thread body: solves jobs until the pool is empty.
  */
 
-static int find_tour (int ncount, CCdatagroup *dat, int *perm, double *ub,
-        int trials, int silent, CCrandstate *rstate)
+static void *tsp_worker(void *arg)
 {
-    int rval = 0;
-    CCedgegengroup plan;
-    int ecount;
-    int *elist = (int *) NULL;
-    int tcount;
-    int *tlist = (int *) NULL;
-    int *bestcyc = (int *) NULL;
-    int *cyc     = (int *) NULL;
-    int *tmp;
-    double val, bestval, szeit;
-    int kicks, i, istour;
-
-    szeit = CCutil_zeit ();
-    bestval = CCtsp_LP_MAXDOUBLE;
-
-    if (trials == -1) {
-        kicks = (ncount > 400 ? 100 : ncount/4);
-    } else {
-        kicks = (ncount > 1000 ? 500 : ncount/2);
-    }
-
-    if (!silent) {
-        printf ("Finding a good tour for compression: %d\n", trials);
-        fflush (stdout);
-    }
+  BEL_TSPPool *pool = (BEL_TSPPool *) arg;
+  double start = BEL_TraceClock();
+  int r, njobs = 0;
 
-    cyc = CC_SAFE_MALLOC (ncount, int);
-    CCcheck_NULL (cyc, "out of memory for cyc");
-    bestcyc = CC_SAFE_MALLOC (ncount, int);
-    CCcheck_NULL (bestcyc, "out of memory for bestcyc");
-
-    CCedgegen_init_edgegengroup (&plan);
-    plan.quadnearest = 2;
-    rval = CCedgegen_edges (&plan, ncount, dat, (double *) NULL, &ecount,
-                            &elist, silent, rstate);
-    CCcheck_rval (rval, "CCedgegen_edges failed");
-    plan.quadnearest = 0;
-
-    plan.tour.greedy = 1;
-    rval = CCedgegen_edges (&plan, ncount, dat, (double *) NULL, &tcount,
-                            &tlist, silent, rstate);
-    CCcheck_rval (rval, "CCedgegen_edges failed");
-
-    if (tcount != ncount) {
-        fprintf (stderr, "wrong edgeset from CCedgegen_edges\n");
-        rval = 1; goto CLEANUP;
-    }
-
-    rval = CCutil_edge_to_cycle (ncount, tlist, &istour, cyc);
-    CCcheck_rval (rval, "CCutil_edge_to_cycle failed");
-    if (istour == 0) {
-        fprintf (stderr, "Starting tour has an error\n");
-        rval = 1; goto CLEANUP;
-    }
-    CC_FREE (tlist, int);
-
-    rval = CClinkern_tour (ncount, dat, ecount, elist, ncount, kicks,
-                    cyc, bestcyc, &bestval, silent, 0.0, 0.0,
-                    (char *) NULL,
-                    CC_LK_GEOMETRIC_KICK, rstate);
-    CCcheck_rval (rval, "CClinkern_tour failed");
-
-    for (i = 0; i < trials; i++) {
-        rval = CClinkern_tour (ncount, dat, ecount, elist, ncount, kicks,
-                        (int *) NULL, cyc, &val, silent, 0.0, 0.0,
-                        (char *) NULL, CC_LK_GEOMETRIC_KICK, rstate);
-        CCcheck_rval (rval, "CClinkern_tour failed");
-        if (val < bestval) {
-            CC_SWAP (cyc, bestcyc, tmp);
-            bestval = val;
-        }
-    }
-
-    if (trials > 0) {
-        rval = CClinkern_tour (ncount, dat, ecount, elist, ncount, 2 * kicks,
-                        bestcyc, perm, ub, silent, 0.0, 0.0,
-                        (char *) NULL, CC_LK_GEOMETRIC_KICK, rstate);
-        CCcheck_rval (rval, "CClinkern_tour failed");
-    } else {
-        for (i = 0; i < ncount; i++) {
-            perm[i] = bestcyc[i];
-        }
-    }
-
-    if (!silent) {
-        printf ("Time to find compression tour: %.2f (seconds)\n",
-                CCutil_zeit() - szeit);
-        fflush (stdout);
-    }
-
-CLEANUP:
-
-    CC_IFFREE (cyc, int);
-    CC_IFFREE (bestcyc, int);
-    CC_IFFREE (elist, int);
-    CC_IFFREE (tlist, int);
-    return rval;
+  BEL_TraceThreadName("tsp worker");
+  for (;;)
+  {
+    pthread_mutex_lock(&pool->lock);
+    r = (pool->next < pool->njobs) ? pool->order[pool->next++] : -1;
+    pthread_mutex_unlock(&pool->lock);
+    if (r < 0)
+      break;
+    solve_job(pool->ctx, &pool->jobs[r], r);
+    njobs++;
+  }
+  BEL_TraceComplete("worker", "thread", start, "jobs", njobs, (char *) NULL, 0);
+  return NULL;
 }
 
-/**
- *  See Concorde for details.
+/**	Solve the TSP on every route of a clustered VRP instance
  *
- *  @see Concorde source
+ *  Solves the TSP on each of the <code>nroutes</code> routes. With
+ *  <code>workers</code> greater than one, the routes are solved concurrently
+ *  by a pool of threads, scheduling the largest routes first. The tour of
+ *  route <code>i</code> is always stored in <code>tours[i]</code>, therefore
+ *  the outcome is independent of the scheduling. Routes found in the route
+ *  cache are not solved at all, and the routes that were solved are added
+ *  to it, unless the context takes the 2-opt fast path: the cache only holds
+ *  optimal tours.
+ *
+ *  @param ctx The TSP solver context, shared by all the workers
+ *  @param cache The route cache, or NULL
+ *  @param data The problem instance
+ *  @param nroutes The number of routes
+ *  @param routes The data of each route
+ *  @param sets The nodes of each route, depot first
+ *  @param sizes The number of nodes of each route
+ *  @param tours The tours found, as indexes into <code>sets</code>
+ *  @param workers The number of worker threads
+ *  @return 1 on failure, 0 otherwise
  */
 
-static int getedges (CCdatagroup *dat, CCedgegengroup *plan, int ncount,
-        int *ecount, int **elist, int **elen, int silent,
-        CCrandstate *rstate)
+int BEL_SolveRoutes(BEL_TSPContext *ctx, BEL_RouteCache *cache, BEL_VRPData *data, int nroutes,
+	CCdatagroup *routes, int **sets, int *sizes, int **tours, int workers)
 {
-    int i;
-    int rval = 0;
+  BEL_TSPJob jobs[nroutes];
+  int order[nroutes];
+  int i, j, tmp, njobs = 0, rval = 0;
 
-    *elist = (int *) NULL;
-    *elen = (int *) NULL;
+  BEL_PhaseBegin(BEL_PHASE_TSP);
 
-    if (dat == (CCdatagroup *) NULL || plan == (CCedgegengroup *) NULL) {
-        fprintf (stderr, "getedges needs CCdatagroup and CCedgegengroup\n");
-        rval = 1;  goto CLEANUP;
-    }
-
-    rval = CCedgegen_edges (plan, ncount, dat, (double *) NULL, ecount, elist,
-                            silent, rstate);
-    CCcheck_rval (rval, "CCedgegen_edges failed");
+  for (i = 0; i < nroutes; i++)
+  {
+    jobs[i].ncount = sizes[i];
+    jobs[i].dat = &(routes[i]);
+    jobs[i].tour = (cache ? BEL_RouteCacheLookup(cache, data->dat, sizes[i], sets[i]) : (int *) NULL);
+    jobs[i].cached = (jobs[i].tour != NULL);
+    jobs[i].stats.time = 0.0;
+    snprintf(jobs[i].name, sizeof(jobs[i].name), "%s-route-%d", data->name, i);
+    if (!jobs[i].cached)
+      order[njobs++] = i;
+  }
 
-    *elen = CC_SAFE_MALLOC(*ecount, int);
-    CCcheck_NULL (*elen, "out of memory for elen");
+  // Largest routes first, ties broken by route index
+  for (i = 1; i < njobs; i++)
+  {
+    tmp = order[i];
+    for (j = i; j > 0 && sizes[order[j - 1]] < sizes[tmp]; j--)
+      order[j] = order[j - 1];
+    order[j] = tmp;
+  }
 
-    for (i = 0; i < *ecount; i++) {
-        (*elen)[i] = CCutil_dat_edgelen ((*elist)[2*i], (*elist)[(2*i)+1], dat);
+  if (workers <= 1 || njobs <= 1)
+  {
+    for (i = 0; i < nroutes; i++)
+    {
+      if (jobs[i].cached)
+        continue;
+#ifdef DEBUG
+      printf("Solving TSP on route %d: ", i);
+      print_array(sizes[i], sets[i], "current_set");
+#endif
+      solve_job(ctx, &jobs[i], i);
     }
+  }
+  else if (BEL_WarmTSPContext(ctx))
+  {
+    // The context must be warm before it is shared, the routes are left unsolved
+    rval = 1;
+  }
+  else
+  {
+    BEL_TSPPool pool;
+    int nthreads = MIN(workers, njobs);
+    pthread_t threads[nthreads];
+
+    pool.ctx = ctx;
+    pool.jobs = jobs;
+    pool.order = order;
+    pool.njobs = njobs;
+    pool.next = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    fflush(stdout);
+    for (i = 0; i < nthreads; i++)
+    {
+      if (pthread_create(&threads[i], NULL, tsp_worker, &pool))
+      {
+        fprintf(stderr, "Couldn't start worker thread %d\n", i);
+        break;
+      }
+    }
+    // If no thread could be started, do the work ourselves
+    if (i == 0)
+      tsp_worker(&pool);
+    for (j = 0; j < i; j++)
+      pthread_join(threads[j], NULL);
+    pthread_mutex_destroy(&pool.lock);
+  }
 
-CLEANUP:
+  BEL_PhaseEnd(BEL_PHASE_TSP);
 
-    if (rval) {
-        CC_IFFREE (*elist, int);
-        CC_IFFREE (*elen, int);
-    }
-    return rval;
+  for (i = 0; i < nroutes; i++)
+  {
+    tours[i] = jobs[i].tour;
+    if (!tours[i])
+      rval = 1;
+    else if (cache && !jobs[i].cached && ctx->method == BEL_TSP_EXACT)
+      BEL_RouteCacheInsert(cache, data->dat, sizes[i], sets[i], tours[i], jobs[i].stats.time);
+    BEL_ProfileRoute(i, sizes[i], &jobs[i].stats, jobs[i].cached);
+  }
+  return rval;
 }
 
-/**
- *  See Concorde for details.
+/** Solves one instance of a batch
  *
- *  @see Concorde source
+ *  Loads the instance, checks its feasibility and solves it with the same
+ *  options as a single run, timing every phase into <code>rec</code>. The
+ *  tour is written to the batch tour directory, if there is one, as the
+ *  instance name with a .opt extension. Every instance gets its own data,
+ *  released before returning, while the TSP context and the route cache are
+ *  kept for the next one.
+ *
+ *  @param fname  The instance file, TSPLIB or .vrpb
+ *  @param rec  The record to be filled
+ *  @return 1 on failure, 0 otherwise
  */
 
-static int dump_rc (CCtsp_lp *lp, int count, char *pname, int usesparse)
+static int batch_solve(char *fname, BEL_BatchRecord *rec)
 {
-    int rval = 0;
-    char rcnname[1024];
+	BEL_VRPData *data;
+	BEL_VRPSolution sol;
+	size_t len = strlen(fname);
+	double szeit, start = BEL_TraceClock();
+	int errCode, rval;
+
+	data = (BEL_VRPData *) malloc(sizeof(BEL_VRPData));
+	if (!data)
+	{
+		rec->status = BEL_BATCH_READ_ERROR;
+		return 1;
+	}
+	BEL_InitVRPData(data);
+	BEL_InitVRPSolution(&sol);
 
-    sprintf (rcnname, "%s.rcn", pname);
-    rval = CCtsp_dump_rc_nearest (lp, count, rcnname, usesparse);
-    CCcheck_rval (rval, "CCtsp_dump_rc failed");
+	szeit = CCutil_zeit();
+	BEL_PhaseBegin(BEL_PHASE_READ);
+	if (len > 5 && !strcmp(fname + len - 5, ".vrpb"))
+		rval = BEL_VRPReadBinary(fname, data, !silent);
+	else
+		rval = BEL_VRPReadTSPLIB(fname, data, !silent);
+	BEL_PhaseEnd(BEL_PHASE_READ);
+	BEL_PhaseBegin(BEL_PHASE_DISTANCES);
+	if (!rval && !data->dist)
+		BEL_BuildDistMatrix(data, !silent);
+	BEL_PhaseEnd(BEL_PHASE_DISTANCES);
+	rec->readtime = CCutil_zeit() - szeit;
+	rec->dimension = data->dimension;
+	if (rval || curr_depot >= data->ndepots)
+	{
+		rec->status = BEL_BATCH_READ_ERROR;
+		goto CLEANUP;
+	}
 
-CLEANUP:
+	szeit = CCutil_zeit();
+	BEL_PhaseBegin(BEL_PHASE_FEASIBILITY);
+	rval = !BEL_VRPProblemIsFeasible(data, &errCode, !silent);
+	BEL_PhaseEnd(BEL_PHASE_FEASIBILITY);
+	rec->feasibletime = CCutil_zeit() - szeit;
+	if (rval)
+	{
+		rec->status = BEL_BATCH_INFEASIBLE;
+		goto CLEANUP;
+	}
+
+	szeit = CCutil_zeit();
+	start = BEL_TraceClock();
+	rval = BEL_SolveVRPProblem(data, &sol);
+	BEL_TraceComplete("solve", "phase", start, "nodes", data->dimension, "vehicles", data->nvehicles);
+	rec->solvetime = CCutil_zeit() - szeit;
+	if (rval)
+	{
+		rec->status = BEL_BATCH_SOLVE_ERROR;
+		goto CLEANUP;
+	}
+	rec->status = BEL_BATCH_SOLVED;
+	rec->cost = sol.cost;
+	rec->nvehicles = sol.nvehicles;
 
-    return rval;
+	if (batchtourdir)
+	{
+		char tourfname[BEL_BATCH_NAMELEN * 2];
+		char *base = strrchr(fname, '/');
+		char *ext;
+
+		base = (base ? base + 1 : fname);
+		ext = strrchr(base, '.');
+		szeit = CCutil_zeit();
+		BEL_PhaseBegin(BEL_PHASE_OUTPUT);
+		snprintf(tourfname, sizeof(tourfname), "%s/%.*s.opt", batchtourdir,
+			(int) (ext ? ext - base : (int) strlen(base)), base);
+		BEL_PrintVRPSolution(&sol, tourfname, !silent);
+		BEL_PhaseEnd(BEL_PHASE_OUTPUT);
+		rec->writetime = CCutil_zeit() - szeit;
+	}
+
+CLEANUP:
+	BEL_TraceComplete("instance", "batch", start, "nodes", rec->dimension, "status", rec->status);
+	BEL_FreeVRPSolution(&sol);
+	BEL_FreeVRPData(data);
+	return (rec->status != BEL_BATCH_SOLVED);
 }
 
 /** Parse the commandline arguments.
@@ -1481,13 +1085,61 @@ static int parseargs(int ac, char **av)
  		} while (tok != NULL);
  	}
  	
+    /* --trace has no short form, take it out before the other options */
+    for (c = 1; c < ac; c++)
+    {
+        if (!strcmp(av[c], "--trace"))
+        {
+            if (c + 1 >= ac) {
+                usage (execname);
+                return 1;
+            }
+            tracefname = av[c + 1];
+            for (inorm = c; inorm + 2 < ac; inorm++)
+                av[inorm] = av[inorm + 2];
+            ac -= 2;
+            c--;
+        }
+    }
+
     /* options that require an argument must be followed by a colon (:) */
     /* Claudio 10/3/2006 */
-    while ((c = CCutil_bix_getopt (ac, av, "k:N:o:s:vt:T:D:", &boptind, &boptarg)) != EOF)
+    while ((c = CCutil_bix_getopt (ac, av, "b:c:C:Hj:J:k:K:L:mN:o:O:p:P:R:s:S:vt:T:W:D:", &boptind, &boptarg)) != EOF)
         switch (c) {
+        case 'b':
+            batchsource = boptarg;
+            break;
+        case 'c':
+            cluster_method = atoi (boptarg);
+            if (cluster_method < BEL_CLUSTER_MIP || cluster_method > BEL_CLUSTER_SPLIT) {
+                usage (execname);
+                return 1;
+            }
+            break;
+        case 'C':
+            cachesize = atoi (boptarg);
+            break;
+        case 'H':
+            perfcounters = 1;
+            break;
+        case 'j':
+            nworkers = atoi (boptarg);
+            break;
+        case 'J':
+            profilefname = boptarg;
+            break;
         case 'k':
             nnodes_want = atoi (boptarg);
             break;
+        case 'K':
+            cclp_candidates = atoi (boptarg);
+            break;
+        case 'L':
+            ls_neighbors = atoi (boptarg);
+            break;
+        case 'm':
+            in_memory = 1;
+            break;
         case 't':
             optfname = boptarg;
             break;
@@ -1497,6 +1149,28 @@ static int parseargs(int ac, char **av)
         case 'o':
             outfname = boptarg;
             break;
+        case 'O':
+            batchtourdir = boptarg;
+            break;
+        case 'p':
+            batchprocs = atoi (boptarg);
+            break;
+        case 'S':
+            batchsummary = boptarg;
+            break;
+        case 'W':
+            vrpbfname = boptarg;
+            break;
+        case 'P':
+            cachefname = boptarg;
+            break;
+        case 'R':
+            tsp_method = atoi (boptarg);
+            if (tsp_method < BEL_TSP_EXACT || tsp_method > BEL_TSP_NEARESTNEIGHBOR) {
+                usage (execname);
+                return 1;
+            }
+            break;
         case 's':
             seed = atoi (boptarg);
             break;
@@ -1549,7 +1223,7 @@ static int parseargs(int ac, char **av)
         return 1;
     }
 
-    if (datfname == (char *) NULL && nnodes_want == 0) {
+    if (datfname == (char *) NULL && nnodes_want == 0 && batchsource == (char *) NULL) {
         usage (execname);
         return 1;
     }
@@ -1567,11 +1241,30 @@ static int parseargs(int ac, char **av)
 static void usage (char *execname)
 {
     fprintf (stderr, "Usage: %s [options] dat_file\n", execname);
+    fprintf (stderr, "       %s [options] -b source\n", execname);
+    fprintf (stderr, "   -b s  batch mode: solve every instance of a directory, glob pattern or manifest\n");
+    fprintf (stderr, "   -c #  phase 1 clustering: 0 CCLP by GLPK (default), 1 CCLP by Lagrangian relaxation,\n");
+    fprintf (stderr, "         2 Clarke-Wright savings, 3 sweep around the depot, 4 split of a giant TSP tour\n");
+    fprintf (stderr, "   -C #  number of routes kept in the route cache (default %d, 0 disables)\n", BEL_ROUTECACHE_SIZE);
+    fprintf (stderr, "   -H    read the hardware counters (perf_event_open) of every phase, print IPC and miss rates\n");
+    fprintf (stderr, "   -j #  number of threads solving the route TSPs, or trying the sweep starts (default 1)\n");
+    fprintf (stderr, "   --trace f  write a Chrome trace of phases, route TSPs, MIP solves and threads to f\n");
+    fprintf (stderr, "   -J f  write the time of every phase and the statistics of every route TSP to a JSON file\n");
     fprintf (stderr, "   -k #  number of nodes for random problem\n");
+    fprintf (stderr, "   -K #  candidate seeds, or savings pairs, of each customer in phase 1 (default %d, 0 for all)\n", BEL_CCLP_CANDIDATES);
+    fprintf (stderr, "   -L #  neighbors of each customer in the local search between routes (default %d, 0 disables)\n", BEL_LS_NEIGHBORS);
+    fprintf (stderr, "   -m    solve the route TSPs in memory (no .mas/.sav/.pul/.sol files)\n");
     fprintf (stderr, "   -D #  use custom depot (if more than one)\n");
     fprintf (stderr, "   -t f  output tour file name\n");
     fprintf (stderr, "   -T f  output TSPLIB file name\n");
+    fprintf (stderr, "   -W f  write the instance and its distance matrix to a .vrpb file\n");
     fprintf (stderr, "   -o f  output file name (for optimal tour)\n");
+    fprintf (stderr, "   -O d  batch mode: write the tour of every instance to directory d\n");
+    fprintf (stderr, "   -p #  batch mode: number of worker processes (default 1)\n");
+    fprintf (stderr, "   -P f  route cache file, loaded at start and saved at exit\n");
+    fprintf (stderr, "   -R #  route TSPs: 0 exact by Concorde (default), 2-opt and Or-opt from 1 a Lin-Kernighan tour\n");
+    fprintf (stderr, "         or 2 a nearest neighbor tour\n");
+    fprintf (stderr, "   -S f  batch mode: summary file, CSV if it ends in .csv, JSON Lines otherwise\n");
     fprintf (stderr, "   -s #  random seed\n");
     fprintf (stderr, "   -v    verbose (turn on lots of messages)\n");
     fprintf (stderr, "   -N #  norm (must specify if dat file is not a TSPLIB file)\n");
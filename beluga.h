@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <malloc.h>
 #include <stdlib.h>
+#include <time.h>
 #include <glpk.h>
 #include <concorde.h>
 
@@ -33,6 +34,75 @@
 #define MAX_NONZEROES 100000
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
+/* Largest TSP instance solved by dynamic programming instead of Concorde */
+#define BEL_HK_MAXNODES 16
+
+/* How the route TSPs are solved: exactly, or by the 2-opt fast path from a starting tour */
+#define BEL_TSP_EXACT 0
+#define BEL_TSP_LINKERN 1
+#define BEL_TSP_NEARESTNEIGHBOR 2
+
+/* Length of the neighbor lists of 2-opt and Or-opt */
+#define BEL_TWOOPT_NEIGHBORS 8
+
+/* Largest instance whose distance matrix is precomputed */
+#define BEL_DISTMATRIX_MAXNODES 16384
+
+/* Default number of candidate seeds of each customer in the CCLP */
+#define BEL_CCLP_CANDIDATES 10
+
+/* Candidate seeds per vehicle in the sparse CCLP */
+#define BEL_CCLP_SEEDPOOL 4
+
+/* Clustering methods of phase 1 */
+#define BEL_CLUSTER_MIP 0
+#define BEL_CLUSTER_LAGRANGIAN 1
+#define BEL_CLUSTER_SAVINGS 2
+#define BEL_CLUSTER_SWEEP 3
+#define BEL_CLUSTER_SPLIT 4
+
+/* Default length of the neighbor lists of the local search */
+#define BEL_LS_NEIGHBORS 20
+
+/* Default number of routes kept in the route cache */
+#define BEL_ROUTECACHE_SIZE 4096
+
+/* Phases timed by the profile */
+#define BEL_PHASE_READ 0
+#define BEL_PHASE_DISTANCES 1
+#define BEL_PHASE_FEASIBILITY 2
+#define BEL_PHASE_SEEDS 3
+#define BEL_PHASE_CCLP_BUILD 4
+#define BEL_PHASE_CCLP_SOLVE 5
+#define BEL_PHASE_CLUSTER 6
+#define BEL_PHASE_ROUTES 7
+#define BEL_PHASE_TSP 8
+#define BEL_PHASE_MERGE 9
+#define BEL_PHASE_LOCALSEARCH 10
+#define BEL_PHASE_OUTPUT 11
+#define BEL_NPHASES 12
+
+/* Hardware counters read at the phase boundaries (see BEL_InitPerf) */
+#define BEL_PERF_CYCLES 0
+#define BEL_PERF_INSTRUCTIONS 1
+#define BEL_PERF_BRANCHES 2
+#define BEL_PERF_BRANCH_MISSES 3
+#define BEL_PERF_L1D_LOADS 4
+#define BEL_PERF_L1D_MISSES 5
+#define BEL_PERF_LLC_REFERENCES 6
+#define BEL_PERF_LLC_MISSES 7
+#define BEL_NPERF 8
+
+/* Outcome of an instance solved in batch mode */
+#define BEL_BATCH_SOLVED 0
+#define BEL_BATCH_READ_ERROR 1
+#define BEL_BATCH_INFEASIBLE 2
+#define BEL_BATCH_SOLVE_ERROR 3
+#define BEL_BATCH_NOT_RUN 4
+
+/* Longest instance file name kept in a batch record */
+#define BEL_BATCH_NAMELEN 256
+
 #define BEL_VRP_SOLVED                (1)
 #define BEL_VRP_INFEASIBLE            (2)
 #define BEL_VRP_NOT_ENOUGH_VEHICLES   (6)
@@ -47,22 +117,62 @@ typedef char BOOL; //!< Boolean type
 #define TRUE 1	//!< Boolean TRUE
 #define FALSE 0	//!< Boolean FALSE
 
+/** A bump allocator for objects that are released together.
+ *
+ *	Memory is handed out from large chunks, 64 byte aligned, and only given
+ *	back when the whole arena is freed (see BEL_ArenaAlloc).
+ *
+ */
+
+typedef struct BEL_ArenaChunk BEL_ArenaChunk;
+
+typedef struct BEL_Arena {
+
+	BEL_ArenaChunk *chunks;	//!< Chunks in use, the newest first.
+	size_t chunksize;				//!< Default size of a new chunk.
+
+} BEL_Arena;
+
 /** A structure to hold the solution of VRP problem.
  *
  *	A solution is described by the ordered list of nodes to be visited
  *	by each vehicle, the number of vehicles and the total cost.
+ *	The routes are stored flat: route i is <code>nodes[start[i]]</code> to
+ *	<code>nodes[start[i + 1] - 1]</code>, depot excluded. All the arrays live
+ *	in one block, from malloc or from an arena, so a solution is cloned with
+ *	a single memcpy and freed with a single call.
  *
  */
 
 typedef struct BEL_VRPSolution {
 
-	int **routes;		//!< A variable length array of routes. A route is an array of customers.
-	int *routelen;	//!< An array that holds the length of the corresponding route.
+	int *start;			//!< Offset of each route in nodes, nvehicles + 1 entries.
+	int *nodes;			//!< The customers of all the routes, one route after the other.
+	int *load;			//!< Total demand of each route.
+	int *routecost;	//!< Length of each route, from the depot and back.
 	int cost;				//!< The total cost of the solution.
 	int nvehicles;	//!< Number of vehicles needed.
-	
+	int nstops;			//!< Number of customers in all the routes.
+	void *block;		//!< The block that holds the arrays above.
+	size_t blocksize;	//!< Size of the block.
+	BEL_Arena *arena;	//!< Arena the block comes from, NULL if it comes from malloc.
+
 } BEL_VRPSolution;
 
+/** Returns the customers of route i of a solution */
+
+static inline int *BEL_Route(BEL_VRPSolution *sol, int i)
+{
+	return sol->nodes + sol->start[i];
+}
+
+/** Returns the number of customers of route i of a solution */
+
+static inline int BEL_RouteLen(BEL_VRPSolution *sol, int i)
+{
+	return sol->start[i + 1] - sol->start[i];
+}
+
 /** A structure to hold VRP Problem data.
  *
  *	This is an extension of the data structure used by Concorde,
@@ -83,9 +193,265 @@ typedef struct BEL_VRPData {
 	int ndepots;			//!< Number of depots.
 	int ncustomers;		//!< Number of customers (just dimension - ndepots).
 	int nvehicles;		//!< Number of available vehicles (usually not set).
+	int *dist;				//!< Packed lower triangle of edge lengths, or NULL (see BEL_Dist).
+	void *map;				//!< Memory map of the .vrpb file the arrays point into, or NULL.
+	size_t mapsize;		//!< Size of the memory map.
 
 } BEL_VRPData;
 
+/** Returns the length of edge (i, j) of a VRP instance
+ *
+ *	Reads the precomputed distance matrix if there is one, otherwise calls
+ *	the edgelen function of Concorde. Row i of the matrix holds the lengths
+ *	from node i to nodes 0...i, starting at offset <code>i(i+1)/2</code>.
+ *
+ */
+
+static inline int BEL_Dist(BEL_VRPData *data, int i, int j)
+{
+	if (!data->dist)
+		return (data->dat->edgelen)(i, j, data->dat);
+	if (i < j)
+		return data->dist[(size_t) j * (j + 1) / 2 + i];
+	return data->dist[(size_t) i * (i + 1) / 2 + j];
+}
+
+
+/** A structure to hold the state of the TSP solver.
+ *
+ *	Holds the options passed to Concorde for every TSP instance, and the
+ *	setup that only needs to be done once. Once warm, a context is never
+ *	modified by the solver, so it can be kept across many solves and shared
+ *	by several threads.
+ *
+ */
+
+typedef struct BEL_TSPContext {
+
+	char *edgegenfname;				//!< Edge generation plan file.
+	char *problname;					//!< Fixed name for all problems (usually not set).
+	char *probfname;					//!< Problem file to start from.
+	char *edgefname;					//!< Initial edge set file.
+	char *fullfname;					//!< Full edge set file.
+	char *tourfname;					//!< Starting tour file.
+	char *poolfname;					//!< Cut pool file.
+	char *restartfname;				//!< Restart file for the branching.
+	char *xfname;							//!< Output file for the LP solution.
+	char *outfname;						//!< Output file for the optimal tour.
+	char *filecutname;				//!< File of cuts to be used.
+	int seed;									//!< Random seed.
+	int just_cuts;						//!< Only run the given cutting loop.
+	int dontcutroot;					//!< Do not cut the root LP.
+	int usetighten;						//!< Tighten before adding cuts.
+	int usedominos;						//!< Use domino parity cuts.
+	int maxchunksize;					//!< Maximum chunk size for local cuts.
+	int multiple_chunker;			//!< Use multiple chunk sizes.
+	int valid_edges;					//!< Only use valid edges.
+	int dfs_branching;				//!< Use depth first branching.
+	int bfs_branching;				//!< Use best first branching.
+	int simple_branching;			//!< Use simple branching.
+	int usebranchcliques;			//!< Branch on cliques.
+	int tentative_branch_num;	//!< Number of tentative branches.
+	int complete_price;				//!< Price the complete graph.
+	int want_rcnearest;				//!< Dump the nearest edges by reduced cost.
+	int output_tour_as_edges;	//!< Write the tour as a list of edges.
+	int silent;								//!< Turn off most messages.
+	int be_nethost;						//!< Act as a host for remote branching.
+	int unlink_files;					//!< Delete the temporary files.
+	double initial_ub;				//!< Initial upper bound.
+	unsigned short hostport;	//!< Port for remote branching.
+	int eliminate_edges;			//!< Set to 1 to force elim, 0 to not elim.
+	int eliminate_sparse;			//!< Set to 1 to elim from full edge list.
+	int longedge_branching;		//!< Set to 0 to turn off.
+	int save_proof;						//!< Set to 1 to save the proof.
+	int standalone_branch;		//!< Set to 1 to do a manual branch.
+	int in_memory;						//!< Set to 1 to solve without writing any file.
+	int method;								//!< BEL_TSP_EXACT, or where 2-opt starts from.
+
+	CCtsp_cutselect sel;					//!< Cut selection, set up when warm.
+	CCtsp_cutselect tentativesel;	//!< Tentative cut selection, set up when warm.
+	int warm;											//!< TRUE once the context is set up.
+
+} BEL_TSPContext;
+
+
+/** A structure to hold the outcome of a TSP solve.
+ *
+ *	Filled by BEL_TSPSolve along with the tour, so that callers don't
+ *	need to read the bounds back from Concorde output files.
+ *
+ */
+
+typedef struct BEL_TSPStats {
+
+	double upperbound;	//!< Length of the tour found.
+	double lowerbound;	//!< Best lower bound proved on the tour length.
+	int bbnodes;				//!< Number of branch and bound nodes.
+	int lprows;					//!< Rows of the final root LP.
+	int lpcols;					//!< Columns of the final root LP.
+	int lpnonzeros;			//!< Nonzeros of the final root LP.
+	int cutrounds;			//!< Rounds of the cutting loop.
+	double time;				//!< Running time in seconds.
+
+} BEL_TSPStats;
+
+
+typedef struct BEL_RouteCacheEntry BEL_RouteCacheEntry; //!< A cached route, see routecache.c
+
+/** A structure to hold the cache of the optimal route tours.
+ *
+ *	Maps a route, that is a depot and a set of customers under a given
+ *	norm, to its optimal tour. The cache holds up to maxentries routes and
+ *	evicts the least recently used one. It is only accessed by the thread
+ *	that schedules the route TSPs, so it needs no locking.
+ *
+ */
+
+typedef struct BEL_RouteCache {
+
+	BEL_RouteCacheEntry **buckets;	//!< Hash table of the routes.
+	int nbuckets;										//!< Number of buckets, a power of two.
+	BEL_RouteCacheEntry *head;			//!< Most recently used route.
+	BEL_RouteCacheEntry *tail;			//!< Least recently used route.
+	int nentries;										//!< Number of routes in the cache.
+	int maxentries;									//!< Maximum number of routes, 0 if disabled.
+	long hits;											//!< Number of routes found in the cache.
+	long misses;										//!< Number of routes not found in the cache.
+	double saved;										//!< TSP solving time saved by the hits.
+
+} BEL_RouteCache;
+
+
+/** A structure to hold the statistics of one route TSP of the profile */
+
+typedef struct BEL_RouteProfile {
+
+	int route;					//!< Index of the route in its solution.
+	int nodes;					//!< Nodes of the TSP, depot included.
+	int lprows;					//!< Rows of the final root LP.
+	int bbnodes;				//!< Number of branch and bound nodes.
+	int cutrounds;			//!< Rounds of the cutting loop.
+	int cached;					//!< TRUE if the tour came from the route cache.
+	double time;				//!< Running time in seconds.
+
+} BEL_RouteProfile;
+
+/** A structure to hold the timers and counters of a run.
+ *
+ *	There is a single profile per process, BEL_profile. The phases are
+ *	timed by BEL_PhaseBegin and BEL_PhaseEnd, which only test a flag when
+ *	the profile is disabled. Phases are only timed by the thread running
+ *	<code>main</code>; the route TSPs solved by worker threads are recorded
+ *	once they are all done.
+ *
+ */
+
+typedef struct BEL_Profile {
+
+	int enabled;										//!< Whether anything is recorded.
+	int trace;											//!< Whether trace events are recorded too (see BEL_InitTrace).
+	int perf;												//!< Whether hardware counters are read too (see BEL_InitPerf).
+	double start[BEL_NPHASES];			//!< Start of the running interval of each phase.
+	double time[BEL_NPHASES];				//!< Total time spent in each phase.
+	long count[BEL_NPHASES];				//!< Number of intervals of each phase.
+	long long perfstart[BEL_NPHASES][BEL_NPERF];	//!< Counters at the start of the running interval.
+	long long counters[BEL_NPHASES][BEL_NPERF];	//!< Counters accumulated by each phase.
+	int perfvalid[BEL_NPERF];				//!< Whether each counter could be opened.
+	BEL_RouteProfile *routes;				//!< Every route TSP of the run.
+	int nroutes;										//!< Number of route TSPs.
+	int maxroutes;									//!< Size of routes.
+
+} BEL_Profile;
+
+extern BEL_Profile BEL_profile;
+extern const char *BEL_phase_names[BEL_NPHASES];
+
+/** Returns a monotonic time in seconds, for the profile */
+
+static inline double BEL_ProfileClock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Reads the hardware counters at the start of a phase */
+void BEL_PerfBegin(int phase);
+
+/* Accumulates the hardware counters at the end of a phase */
+void BEL_PerfEnd(int phase);
+
+/** Starts timing a phase, if the profile is enabled */
+
+static inline void BEL_PhaseBegin(int phase)
+{
+	if (BEL_profile.enabled)
+	{
+		if (BEL_profile.perf)
+			BEL_PerfBegin(phase);
+		BEL_profile.start[phase] = BEL_ProfileClock();
+	}
+}
+
+/* Records a complete trace event in the buffer of the calling thread */
+void BEL_TraceComplete(const char *name, const char *cat, double start,
+	const char *arg1, int val1, const char *arg2, int val2);
+
+/** Stops timing a phase, if the profile is enabled */
+
+static inline void BEL_PhaseEnd(int phase)
+{
+	if (BEL_profile.enabled)
+	{
+		double now = BEL_ProfileClock();
+		if (BEL_profile.perf)
+			BEL_PerfEnd(phase);
+		BEL_profile.time[phase] += now - BEL_profile.start[phase];
+		BEL_profile.count[phase]++;
+		if (BEL_profile.trace)
+			BEL_TraceComplete(BEL_phase_names[phase], "phase", BEL_profile.start[phase],
+				(char *) NULL, 0, (char *) NULL, 0);
+	}
+}
+
+/** Returns the start time of a trace event, 0 if tracing is off */
+
+static inline double BEL_TraceClock(void)
+{
+	return (BEL_profile.trace ? BEL_ProfileClock() : 0.0);
+}
+
+
+/** A structure to hold the outcome of one instance of a batch.
+ *
+ *	Records are filled by the worker processes in shared memory and written
+ *	to the batch summary once all the instances are done, so they hold no
+ *	pointers.
+ *
+ */
+
+typedef struct BEL_BatchRecord {
+
+	char fname[BEL_BATCH_NAMELEN];	//!< The instance file.
+	int status;							//!< BEL_BATCH_SOLVED, or why the instance was not solved.
+	int dimension;					//!< Number of nodes.
+	int nvehicles;					//!< Number of routes of the solution.
+	int cost;								//!< Cost of the solution.
+	int bestcost;						//!< Cost of the known best solution, 0 if there is none.
+	long maxrss;						//!< Peak resident set size while solving, in KB.
+	double readtime;				//!< Time spent loading the instance.
+	double feasibletime;		//!< Time spent on the BPP feasibility check.
+	double solvetime;				//!< Time spent by BEL_SolveVRPProblem.
+	double writetime;				//!< Time spent writing the tour.
+	double totaltime;				//!< Wall time of the whole instance.
+
+} BEL_BatchRecord;
+
+/** A function solving the instance in a file of a batch */
+
+typedef int (*BEL_BatchSolver)(char *fname, BEL_BatchRecord *rec);
+
 
 /* VRP Data handling */
 
@@ -95,11 +461,65 @@ void BEL_InitVRPData(BEL_VRPData *data);
 /* Release the memory allocated by a BEL_VRPData structure */
 void BEL_FreeVRPData(BEL_VRPData *data);
 
+/* Builds the distance matrix of a VRP instance */
+int BEL_BuildDistMatrix(BEL_VRPData *data, int verbose);
+
 /* Creates the data to generate edge lengths in the dat structure */
 int BEL_VRPGetData(char *datname, int binary_in, int innorm, int *ncount, BEL_VRPData *data,
 	int gridsize, int allow_dups, CCrandstate *rstate, int verbose);
 
 
+/* TSP solver handling */
+
+/* Initializes a BEL_TSPContext structure */
+void BEL_InitTSPContext(BEL_TSPContext *ctx);
+
+/* Does the one-time setup of a BEL_TSPContext structure */
+int BEL_WarmTSPContext(BEL_TSPContext *ctx);
+
+/* Solves a small TSP instance to optimality by dynamic programming */
+int BEL_HeldKarpSolve(int ncount, CCdatagroup *dat, int *tour, int *val);
+
+/* Builds a tour by the nearest neighbor heuristic */
+int BEL_NearestNeighborTour(int ncount, CCdatagroup *dat, int *tour);
+
+/* Improves a tour by 2-opt and Or-opt moves */
+int BEL_TwoOptTour(int ncount, CCdatagroup *dat, int *tour, int neighbors);
+
+
+/* Route cache handling */
+
+/* Initializes a BEL_RouteCache structure */
+int BEL_InitRouteCache(BEL_RouteCache *cache, int maxentries);
+
+/* Release the memory allocated by a BEL_RouteCache structure */
+void BEL_FreeRouteCache(BEL_RouteCache *cache);
+
+/* Looks up the optimal tour of a route in the cache */
+int *BEL_RouteCacheLookup(BEL_RouteCache *cache, CCdatagroup *dat, int ncount, int *set);
+
+/* Stores the optimal tour of a route in the cache */
+void BEL_RouteCacheInsert(BEL_RouteCache *cache, CCdatagroup *dat, int ncount, int *set,
+	int *tour, double time);
+
+/* Loads the routes saved by BEL_RouteCacheSave into the cache */
+int BEL_RouteCacheLoad(BEL_RouteCache *cache, char *fname);
+
+/* Saves the routes in the cache to a file */
+int BEL_RouteCacheSave(BEL_RouteCache *cache, char *fname);
+
+
+/* Arena allocation */
+
+/* Initializes an arena */
+void BEL_InitArena(BEL_Arena *arena, size_t chunksize);
+
+/* Allocates 64 byte aligned memory from an arena */
+void *BEL_ArenaAlloc(BEL_Arena *arena, size_t size);
+
+/* Releases all the memory of an arena */
+void BEL_FreeArena(BEL_Arena *arena);
+
 /* Solution handling */
 
 /* Initializes a BEL_VRPSolution structure */
@@ -108,6 +528,18 @@ void BEL_InitVRPSolution(BEL_VRPSolution *sol);
 /* Release the memory allocated by a BEL_VRPData structure */
 void BEL_FreeVRPSolution(BEL_VRPSolution *sol);
 
+/* Allocates the arrays of a solution with the given routes and stops */
+int BEL_AllocVRPSolution(BEL_VRPSolution *sol, int nvehicles, int nstops, BEL_Arena *arena);
+
+/* Copies a solution, routes included */
+int BEL_CloneVRPSolution(BEL_VRPSolution *dst, BEL_VRPSolution *src, BEL_Arena *arena);
+
+/* Computes the load and the cost of every route, and the total cost */
+void BEL_EvaluateVRPSolution(BEL_VRPSolution *sol, BEL_VRPData *data, int depot);
+
+/* Checks that every customer is visited exactly once */
+int BEL_CheckVRPSolution(BEL_VRPSolution *sol, BEL_VRPData *data);
+
 /* Prints a BEL_VRPSolution to a file */
 void BEL_PrintVRPSolution(BEL_VRPSolution *sol, char *optfname, int verbose);
 
@@ -124,16 +556,57 @@ BOOL BEL_VRPProblemIsFeasible(BEL_VRPData *data, int *errorCode, int verbose);
 int BEL_SolveVRPProblem(BEL_VRPData *data, BEL_VRPSolution *sol);
 
 /* Solves a TSP instance calling Concorde TSP solver */
-int *BEL_TSPSolve(int ncount, CCdatagroup *dat, char *probname);
+int *BEL_TSPSolve(BEL_TSPContext *ctx, int ncount, CCdatagroup *dat, char *probname,
+	BEL_TSPStats *stats);
+
+/* Solves the TSP on every route of a clustered VRP instance, possibly in parallel */
+int BEL_SolveRoutes(BEL_TSPContext *ctx, BEL_RouteCache *cache, BEL_VRPData *data, int nroutes,
+	CCdatagroup *routes, int **sets, int *sizes, int **tours, int workers);
+
+/* Lower and upper bounds on the bins of a Bin Packing Problem */
+int BEL_BPPBounds(int capacity, int items, int volume[], int *lower, int *upper);
 
 /* Solve an instance of Bin Packing Problem */
 int BEL_BPPSolve(int bins, int capacity, int items, int volume[],
 	int *min_bins, int verbose);
 
 /* Solve an instance of Capacitated Concentrator Location Problem */
-int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seeds,
+int BEL_CCLPSolve(int items, int cost[], int weight[items], int seeds,
 	int seed_cost[items], int capacity, int assignments[items], int verbose);
 
+/* Solve an instance of CCLP where items can only go to candidate seeds */
+int BEL_CCLPSolveSparse(int items, int start[], int cand[], int cost[], int weight[items],
+	int seeds, int seed_cost[items], int capacity, int assignments[items], int verbose);
+
+/* Solve an instance of CCLP by Lagrangian relaxation */
+int BEL_CCLPSolveLagrangian(int items, int start[], int cand[], int cost[], int weight[items],
+	int seeds, int seed_cost[items], int capacity, int assignments[items],
+	double *lowerbound, int verbose);
+
+/* Clusters the customers of a VRP instance by solving a CCLP */
+int BEL_CCLPCluster(BEL_VRPData *data, int depot, int items, int customer2node[], int weight[],
+	int seed_cost[], int ncand, int method, int assignments[], int verbose);
+
+
+/* Clusters the customers of a VRP instance by the savings heuristic */
+int BEL_SavingsCluster(BEL_VRPData *data, int depot, int items, int customer2node[],
+	int neighbors, int assignments[], int verbose);
+
+/* Clusters the customers of a VRP instance by the sweep heuristic */
+int BEL_SweepCluster(BEL_VRPData *data, int depot, int items, int customer2node[],
+	int workers, int assignments[], int verbose);
+
+/* Splits a giant tour into the routes of a VRP solution */
+int BEL_SplitTour(BEL_VRPData *data, int depot, int n, int *tour, BEL_VRPSolution *sol,
+	int verbose);
+
+/* Builds the lists of the nearest customers of every node */
+int *BEL_NearestNeighbors(BEL_VRPData *data, int k);
+
+/* Improves a VRP solution by moving customers between routes */
+int BEL_VRPLocalSearch(BEL_VRPData *data, BEL_VRPSolution *sol, int depot, int neighbors,
+	int verbose);
+
 
 /* TSPLIB format utilities */
 
@@ -143,6 +616,55 @@ int BEL_VRPReadTSPLIB(char *datfile, BEL_VRPData *data, int verbose);
 /* Writes a VRP instance to a file in standard TSPLIB format */
 int BEL_VRPWriteTSPLIB(char *datfile, BEL_VRPData *data);
 
+/* Writes a VRP instance to a binary .vrpb file */
+int BEL_VRPWriteBinary(char *datfile, BEL_VRPData *data);
+
+/* Loads a VRP instance from a binary .vrpb file */
+int BEL_VRPReadBinary(char *datfile, BEL_VRPData *data, int verbose);
+
+
+/* Profiling */
+
+/* Clears the profile and turns it on or off */
+void BEL_InitProfile(int enabled);
+
+/* Records the statistics of a route TSP in the profile */
+void BEL_ProfileRoute(int route, int nodes, BEL_TSPStats *stats, int cached);
+
+/* Writes the profile to a JSON file */
+int BEL_WriteProfile(char *fname);
+
+/* Releases the memory of the profile */
+void BEL_FreeProfile(void);
+
+/* Opens the hardware counters read at the phase boundaries */
+int BEL_InitPerf(int verbose);
+
+/* Prints the hardware counters of every phase */
+void BEL_PrintPerf(void);
+
+/* Closes the hardware counters */
+void BEL_FreePerf(void);
+
+/* Starts recording trace events */
+void BEL_InitTrace(void);
+
+/* Names the calling thread in the trace */
+void BEL_TraceThreadName(const char *name);
+
+/* Writes the trace events to a file in Chrome trace format */
+int BEL_WriteTrace(char *fname);
+
+/* Releases the memory of the trace */
+void BEL_FreeTrace(void);
+
+
+/* Batch mode */
+
+/* Solves all the instances of a directory, glob or manifest and writes a summary */
+int BEL_SolveBatch(char *source, char *summary, int nprocs, BEL_BatchSolver solve,
+	int *failed, int verbose);
+
 
 /* Misc utilities */
 
@@ -0,0 +1,252 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  benchcmp.c
+ *
+ *  Compares the summary of a batch run on the benchmark instances with a
+ *  stored baseline. Run by <code>make bench</code>.
+ *
+ *  Usage: benchcmp [-g gap] [-t ratio] [-r ratio] baseline.jsonl report.jsonl
+ *
+ *  Prints the gap to the known best cost, the time and the peak memory of
+ *  every instance next to the baseline, and exits with 1 if any instance got
+ *  worse: it is no longer solved, its gap grew by more than <code>gap</code>
+ *  percent points (0.5 by default), its time grew by more than
+ *  <code>ratio</code> times (1.25 by default, ignoring differences under
+ *  50ms) or its peak memory by more than the <code>-r</code> ratio (1.5 by
+ *  default). Without a baseline, the report is printed and nothing is
+ *  compared.
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+#include <string.h>
+
+#define BENCH_LINELEN 4096			//!< Longest line of a report
+#define BENCH_MINTIME 0.05			//!< Time differences below this are noise
+
+/**
+ *  One line of a batch summary, as written by BEL_SolveBatch.
+ */
+
+typedef struct bench_entry {
+	char instance[BEL_BATCH_NAMELEN];	//!< The instance file
+	int solved;								//!< The status was "solved"
+	double cost;							//!< Cost of the solution
+	double best;							//!< Known best cost, 0 if unknown
+	double gap;								//!< Percent above the known best
+	double maxrss;						//!< Peak memory, in KB
+	double solve;							//!< Time spent solving
+	double total;							//!< Wall time of the instance
+} bench_entry;
+
+/**
+ *  Finds the number following <code>"key":</code> in a JSON line.
+ *
+ *  @return 1 if the key is missing, 0 otherwise
+ */
+
+static int json_number(const char *line, const char *key, double *v)
+{
+	char pattern[64];
+	const char *p;
+
+	snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+	if (!(p = strstr(line, pattern)))
+		return 1;
+	*v = strtod(p + strlen(pattern), NULL);
+	return 0;
+}
+
+/**
+ *  Copies the string following <code>"key":</code> in a JSON line,
+ *  undoing the escapes.
+ *
+ *  @return 1 if the key is missing, 0 otherwise
+ */
+
+static int json_string(const char *line, const char *key, char *buf, size_t size)
+{
+	char pattern[64];
+	const char *p;
+	size_t n = 0;
+
+	snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+	if (!(p = strstr(line, pattern)))
+		return 1;
+	for (p += strlen(pattern); *p && *p != '"' && n + 1 < size; p++)
+	{
+		if (*p == '\\' && p[1])
+			p++;
+		buf[n++] = *p;
+	}
+	buf[n] = '\0';
+	return 0;
+}
+
+/**
+ *  Loads a JSON Lines batch summary.
+ *
+ *  @return The number of entries, -1 if the file can't be read
+ */
+
+static int load_report(char *fname, bench_entry **entries)
+{
+	FILE *in;
+	char line[BENCH_LINELEN], status[32];
+	int n = 0, max = 0;
+
+	*entries = (bench_entry *) NULL;
+	if (!(in = fopen(fname, "r")))
+		return -1;
+	while (fgets(line, sizeof(line), in))
+	{
+		bench_entry *e;
+
+		if (n == max)
+		{
+			bench_entry *grown = (bench_entry *) realloc(*entries, (max = 2 * max + 64) * sizeof(bench_entry));
+			if (!grown)
+			{
+				fclose(in);
+				return -1;
+			}
+			*entries = grown;
+		}
+		e = &(*entries)[n];
+		memset(e, 0, sizeof(bench_entry));
+		if (json_string(line, "instance", e->instance, sizeof(e->instance)))
+			continue;
+		if (!json_string(line, "status", status, sizeof(status)))
+			e->solved = !strcmp(status, "solved");
+		json_number(line, "cost", &e->cost);
+		json_number(line, "best", &e->best);
+		json_number(line, "gap", &e->gap);
+		json_number(line, "maxrss", &e->maxrss);
+		json_number(line, "solve", &e->solve);
+		json_number(line, "total", &e->total);
+		n++;
+	}
+	fclose(in);
+	return n;
+}
+
+static bench_entry *find_entry(bench_entry *entries, int n, char *instance)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (!strcmp(entries[i].instance, instance))
+			return &entries[i];
+	return (bench_entry *) NULL;
+}
+
+int main(int ac, char **av)
+{
+	bench_entry *base = (bench_entry *) NULL, *cur = (bench_entry *) NULL;
+	double maxgap = 0.5, maxtime = 1.25, maxrss = 1.5;
+	double sumgap = 0.0, sumtime = 0.0, basetime = 0.0;
+	int nbase, ncur, i, ngap = 0, regressions = 0;
+	int c, boptind = 1;
+	char *boptarg = (char *) NULL;
+
+	while ((c = CCutil_bix_getopt(ac, av, "g:t:r:", &boptind, &boptarg)) != EOF)
+	{
+		switch (c)
+		{
+			case 'g': maxgap = atof(boptarg); break;
+			case 't': maxtime = atof(boptarg); break;
+			case 'r': maxrss = atof(boptarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-g gap] [-t ratio] [-r ratio] baseline.jsonl report.jsonl\n", av[0]);
+				return 1;
+		}
+	}
+	if (boptind + 2 != ac)
+	{
+		fprintf(stderr, "Usage: %s [-g gap] [-t ratio] [-r ratio] baseline.jsonl report.jsonl\n", av[0]);
+		return 1;
+	}
+	if ((ncur = load_report(av[boptind + 1], &cur)) < 0)
+	{
+		fprintf(stderr, "Cannot read report %s\n", av[boptind + 1]);
+		return 1;
+	}
+	if ((nbase = load_report(av[boptind], &base)) < 0)
+	{
+		printf("No baseline in %s, nothing to compare\n", av[boptind]);
+		nbase = 0;
+	}
+
+	printf("%-32s %8s %8s %7s %8s %8s  %s\n", "instance", "cost", "best", "gap%", "time", "rss(KB)", "baseline");
+	for (i = 0; i < ncur; i++)
+	{
+		bench_entry *e = &cur[i];
+		bench_entry *b = find_entry(base, nbase, e->instance);
+		char *name = strrchr(e->instance, '/');
+		char note[128] = "";
+
+		name = (name ? name + 1 : e->instance);
+		if (e->solved && e->best > 0)
+		{
+			sumgap += e->gap;
+			ngap++;
+		}
+		sumtime += e->total;
+
+		if (b)
+		{
+			basetime += b->total;
+			if (b->solved && !e->solved)
+				snprintf(note, sizeof(note), "REGRESSION: no longer solved");
+			else if (e->solved && b->solved && e->best > 0 && e->gap > b->gap + maxgap)
+				snprintf(note, sizeof(note), "REGRESSION: gap %.2f%% was %.2f%%", e->gap, b->gap);
+			else if (e->total > b->total * maxtime && e->total - b->total > BENCH_MINTIME)
+				snprintf(note, sizeof(note), "REGRESSION: time %.2fx", e->total / b->total);
+			else if (b->maxrss > 0 && e->maxrss > b->maxrss * maxrss)
+				snprintf(note, sizeof(note), "REGRESSION: memory %.2fx", e->maxrss / b->maxrss);
+			else
+				snprintf(note, sizeof(note), "gap %+.2f, time %.2fx", e->gap - b->gap,
+					(b->total > 0 ? e->total / b->total : 1.0));
+			if (!strncmp(note, "REGRESSION", 10))
+				regressions++;
+		}
+		else if (nbase)
+			snprintf(note, sizeof(note), "new");
+
+		if (e->solved)
+			printf("%-32s %8.0f %8.0f %7.2f %8.3f %8.0f  %s\n", name, e->cost, e->best, e->gap,
+				e->total, e->maxrss, note);
+		else
+			printf("%-32s %8s %8.0f %7s %8.3f %8.0f  %s\n", name, "-", e->best, "-",
+				e->total, e->maxrss, note);
+	}
+
+	printf("%d instances, mean gap %.2f%% over %d with a known best, %.2f seconds",
+		ncur, (ngap ? sumgap / ngap : 0.0), ngap, sumtime);
+	if (nbase)
+		printf(" (baseline %.2f seconds), %d regressions", basetime, regressions);
+	printf("\n");
+
+	free(base);
+	free(cur);
+	return (regressions > 0);
+}
@@ -0,0 +1,573 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  tsplibread.c
+ *
+ *  Throughput benchmark of the TSPLIB reader of Beluga VRP solver, against
+ *  the stdio reader it replaced. Build with <code>make readbench</code>.
+ *
+ *  Usage: tsplibread [-n nodes] [-r repeats] [file.vrp]
+ *
+ *  Without a file, a random EUC_2D instance of the given number of nodes
+ *  (100000 by default) is written and read.
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define MATRIX_LOWER_DIAG_ROW  0
+#define MATRIX_UPPER_ROW       1
+#define MATRIX_UPPER_DIAG_ROW  2
+#define MATRIX_FULL_MATRIX     3
+
+/** The stdio TSPLIB reader, as it was before the memory mapped one
+ *
+ *  Reads the file line by line with fgets, and every number with fscanf.
+ *  Kept verbatim as the baseline of the benchmark.
+ *
+ *  @param datfile  The name of the TSPLIB file
+ *  @param data     The target BEL_VRPData structure to load data into.
+ *  @param verbose  Turns on lots of messages.
+ *  @return 1 on failure, 0 otherwise.
+ */
+
+static int stdio_read(char *datfile, BEL_VRPData *data, int verbose)
+{
+	FILE *in;
+	char buffer[256], key[256], field[256];
+	char *p;
+	int norm = -1;
+	int matrixform = MATRIX_LOWER_DIAG_ROW;
+	int ncount = -1;
+	int ndepot = 0;
+	int i, j;
+	
+	if ((in = fopen(datfile, "r")) == NULL)
+	{
+		fprintf(stderr, "Cannot open file %s for reading. Aborting\n", datfile);
+		exit(1);
+	}
+	// Read the file line by line
+	while (fgets(buffer, 256, in) != NULL)
+	{
+		p = buffer;
+		while (*p != '\0')
+		{
+			if (*p == ':')
+			{
+				*p = ' ';			
+			}
+			p++;
+		}
+		p = buffer;
+		if (sscanf(p, "%s", key) != EOF)
+		{
+			p += strlen(key);
+			while (*p == ' ')
+			{
+				p++;
+			}
+			if (!strcmp(key, "NAME"))
+			{
+        /**
+         *  We cannot directly strcpy p over data->name, for it's NULL.
+         *  We have to malloc the room for p and then strcpy it.
+         */
+        free(data->name);
+        data->name = (char *)calloc(strlen(p), sizeof(char));
+        memcpy(data->name, p, strlen(p)-1);
+			}
+			else if (!strcmp(key, "TYPE"))
+			{
+				if (verbose)
+					printf("Problem type: %s", p);
+			}
+			else if (!strcmp(key, "COMMENT"))
+			{
+				if (verbose)
+					printf("%s", p);
+			}
+			else if (!strcmp(key, "DIMENSION"))
+			{
+                if (sscanf (p, "%s", field) == EOF) {
+                    fprintf (stderr, "ERROR in DIMENSION line\n");
+                    return FALSE;
+                }
+                ncount = atoi (field);
+                data->dimension = ncount;
+                if (verbose)
+                	printf ("Number of Nodes: %d\n", data->dimension);
+			}
+			else if (!strcmp(key, "EDGE_WEIGHT_TYPE"))
+			{
+          if (sscanf (p, "%s", field) == EOF) {
+                    fprintf (stderr, "ERROR in EDGE_WEIGHT_TYPE line\n");
+                    return FALSE;
+                }
+                if (!strcmp (field, "EXPLICIT")) {
+                    norm = CC_MATRIXNORM;
+                    if (verbose)
+                    	printf ("Explicit Lengths (CC_MATRIXNORM)\n");
+                } else if (!strcmp (field, "EUC_2D")) {
+                    norm = CC_EUCLIDEAN;
+                    if (verbose)
+                    	printf ("Rounded Euclidean Norm (CC_EUCLIDEAN)\n");
+                } else if (!strcmp (field, "EUC_3D")) {
+                    norm = CC_EUCLIDEAN_3D;
+                    if (verbose)
+                    	printf ("Rounded Euclidean 3D Norm (CC_EUCLIDEAN_3D)\n");
+                } else if (!strcmp (field, "MAX_2D")) {
+                    norm = CC_MAXNORM;
+                    if (verbose)
+                    	printf ("Max Norm (CC_MAXNORM)\n");
+                } else if (!strcmp (field, "MAN_2D")) {
+                    norm = CC_MANNORM;
+                    if (verbose)
+                    	printf ("Max Norm (CC_MAXNORM)\n");
+                } else if (!strcmp (field, "GEO")) {
+                    norm = CC_GEOGRAPHIC;
+                    if (verbose)
+                    	printf ("Geographical Norm (CC_GEOGRAPHIC)\n");
+                } else if (!strcmp (field, "GEOM")) {
+                    norm = CC_GEOM;
+                    if (verbose)
+                    	printf ("Geographical Norm in Meters (CC_GEOM)\n");
+                } else if (!strcmp (field, "ATT")) {
+                    norm = CC_ATT;
+                    if (verbose)
+                    	printf ("ATT Norm (CC_ATT)\n");
+                } else if (!strcmp (field, "CEIL_2D")) {
+                    norm = CC_EUCLIDEAN_CEIL;
+                    if (verbose)
+                    	printf ("Rounded Up Euclidean Norm (CC_EUCLIDEAN_CEIL)\n");
+                } else if (!strcmp (field, "DSJRAND")) {
+                    norm = CC_DSJRANDNORM;
+                    if (verbose)
+                    	printf ("David Johnson Random Norm (CC_DSJRANDNORM)\n");
+                } else {
+                    fprintf (stderr, "ERROR: Not set up for norm %s\n", field);
+                    return FALSE;
+                }
+                if (CCutil_dat_setnorm (data->dat, norm)) {
+                    fprintf (stderr, "ERROR: Couldn't set norm %d\n", norm);
+                    return FALSE;
+                }
+			}
+			else if (!strcmp(key, "EDGE_WEIGHT_FORMAT"))
+			{
+                if (sscanf (p, "%s", field) == EOF) {
+                    fprintf (stderr, "ERROR in EDGE_WEIGHT_FORMAT line\n");
+                    return FALSE;
+                }
+                if (!strcmp (field, "LOWER_DIAG_ROW")) {
+                    matrixform = MATRIX_LOWER_DIAG_ROW;
+                } else if (!strcmp (field, "UPPER_ROW")) {
+                    matrixform = MATRIX_UPPER_ROW;
+                } else if (!strcmp (field, "UPPER_DIAG_ROW")) {
+                    matrixform = MATRIX_UPPER_DIAG_ROW;
+                } else if (!strcmp (field, "FULL_MATRIX")) {
+                    matrixform = MATRIX_FULL_MATRIX;
+                } else if (strcmp (field, "FUNCTION")) {
+                    fprintf (stderr, "Cannot handle format: %s\n", field);
+                    return FALSE;
+                }
+			}
+			else if (!strcmp(key, "NODE_COORD_SECTION"))
+			{
+                if (ncount <= 0) {
+                    fprintf (stderr, "ERROR: Dimension not specified\n");
+                    return FALSE;
+                }
+                if (data->dat->x != (double *) NULL) {
+                    fprintf (stderr, "ERROR: A second NODE_COORD_SECTION?\n");
+                    BEL_FreeVRPData(data);
+                    return FALSE;
+                }
+                if ((norm & CC_NORM_SIZE_BITS) == CC_D2_NORM_SIZE) {
+                    data->dat->x = CC_SAFE_MALLOC (ncount, double);
+                    if (!data->dat->x) {
+                        BEL_FreeVRPData(data);
+                        return FALSE;
+                    }
+                    data->dat->y = CC_SAFE_MALLOC (ncount, double);
+                    if (!data->dat->y) {
+                        BEL_FreeVRPData(data);
+                        return FALSE;
+                    }
+                    for (i = 0; i < ncount; i++) {
+                        fscanf (in, "%*d %lf %lf", &(data->dat->x[i]), &(data->dat->y[i]));
+                    }
+                } else if ((norm & CC_NORM_SIZE_BITS) == CC_D3_NORM_SIZE) {
+                    data->dat->x = CC_SAFE_MALLOC (ncount, double);
+                    if (!data->dat->x) {
+                        BEL_FreeVRPData(data);
+                        return FALSE;
+                    }
+                    data->dat->y = CC_SAFE_MALLOC (ncount, double);
+                    if (!data->dat->y) {
+                        BEL_FreeVRPData(data);
+                        return FALSE;
+                    }
+                    data->dat->z = CC_SAFE_MALLOC (ncount, double);
+                    if (!data->dat->z) {
+                        BEL_FreeVRPData(data);
+                        return FALSE;
+                    }
+                    for (i = 0; i < ncount; i++) {
+                        fscanf (in, "%*d %lf %lf %lf",
+                               &(data->dat->x[i]), &(data->dat->y[i]), &(data->dat->z[i]));
+                    }
+                } else {
+                    fprintf (stderr, "ERROR: Node coordinates with norm %d?\n",
+                                 norm);
+                    return FALSE;
+                }
+			}
+			else if (!strcmp(key, "EDGE_WEIGHT_SECTION"))
+			{
+	                if (ncount <= 0) {
+	                    fprintf (stderr, "ERROR: Dimension not specified\n");
+                     return FALSE;
+	                }
+	                if (data->dat->adj != (int **) NULL) {
+	                    fprintf (stderr, "ERROR: A second NODE_COORD_SECTION?\n");
+	                    CCutil_freedatagroup (data->dat);
+                     return FALSE;
+	                }
+	                if ((norm & CC_NORM_SIZE_BITS) == CC_MATRIX_NORM_SIZE) {
+	                    data->dat->adj = CC_SAFE_MALLOC (ncount, int *);
+	                    data->dat->adjspace = CC_SAFE_MALLOC (ncount*(ncount+1)/2,
+	                                                    int);
+	                    if (data->dat->adj == (int **) NULL ||
+	                        data->dat->adjspace == (int *) NULL) {
+	                        CCutil_freedatagroup (data->dat);
+                         return FALSE;
+	                    }
+	                    for (i = 0, j = 0; i < ncount; i++) {
+	                        data->dat->adj[i] = data->dat->adjspace + j;
+	                        j += (i+1);
+	                    }
+	                    if (matrixform == MATRIX_LOWER_DIAG_ROW) {
+	                        for (i = 0; i < ncount; i++) {
+	                            for (j = 0; j <= i; j++)
+	                                fscanf (in, "%d", &(data->dat->adj[i][j]));
+	                        }
+	                    } else if (matrixform == MATRIX_UPPER_ROW ||
+	                               matrixform == MATRIX_UPPER_DIAG_ROW ||
+	                               matrixform == MATRIX_FULL_MATRIX) {
+	                        int **tempadj = (int **) NULL;
+	                        int *tempadjspace = (int *) NULL;
+	                        tempadj = CC_SAFE_MALLOC (ncount, int *);
+	                        tempadjspace = CC_SAFE_MALLOC (ncount * ncount,
+	                                                       int);
+	                        if (tempadj == (int **) NULL ||
+	                            tempadjspace == (int *) NULL) {
+	                            CC_IFFREE (tempadj, int *);
+	                            CC_IFFREE (tempadjspace, int);
+	                            CCutil_freedatagroup (data->dat);
+                             return FALSE;
+	                        }
+	                        for (i = 0; i < ncount; i++) {
+	                            tempadj[i] = tempadjspace + i * ncount;
+	                            if (matrixform == MATRIX_UPPER_ROW) {
+	                                tempadj[i][i] = 0;
+	                                for (j = i + 1; j < ncount; j++)
+	                                    fscanf (in, "%d", &(tempadj[i][j]));
+	                            } else if (matrixform == MATRIX_UPPER_DIAG_ROW) {
+	                                for (j = i; j < ncount; j++)
+	                                    fscanf (in, "%d", &(tempadj[i][j]));
+	                            } else {
+	                                for (j = 0; j < ncount; j++)
+	                                    fscanf (in, "%d", &(tempadj[i][j]));
+	                            }
+	                        }
+	                        for (i = 0; i < ncount; i++) {
+	                            for (j = 0; j <= i; j++)
+	                                data->dat->adj[i][j] = tempadj[j][i];
+	                        }
+	                        CC_FREE (tempadjspace, int);
+	                        CC_FREE (tempadj, int *);
+	                    }
+	                } else {
+	                    fprintf (stderr, "ERROR: Matrix with norm %d?\n",
+	                             norm);
+                     return FALSE;
+	                }
+			}
+			else if (!strcmp(key, "FIXED_EDGES_SECTION"))
+			{
+                fprintf (stderr, "ERROR: Not set up for fixed edges\n");
+                return FALSE;
+			}
+			else if (!strcmp(key, "CAPACITY"))
+			{
+                if (sscanf (p, "%s", field) == EOF) {
+                    fprintf (stderr, "ERROR in DIMENSION line\n");
+                    return FALSE;
+                }
+                data->capacity = atoi (field);
+                if (verbose)
+                	printf ("Vehicle capacity: %d\n", data->capacity);
+			}
+			else if (!strcmp(key, "DEMAND_SECTION"))
+			{
+				int demand;
+                if (ncount <= 0) {
+                    fprintf (stderr, "ERROR: Dimension not specified\n");
+                    return FALSE;
+                }
+                if (data->demand != (int *) NULL) {
+                    fprintf (stderr, "ERROR: A second DEMAND_SECTION?\n");
+                    BEL_FreeVRPData(data);
+                    return FALSE;
+                }
+                data->demand = CC_SAFE_MALLOC (ncount, int);
+                if (!data->demand) {
+                    BEL_FreeVRPData(data);
+                    return FALSE;
+                }
+                for (i = 0; i < ncount; i++) {
+                    fscanf (in, "%d %d", &j, &demand);
+                    if (i != j - 1)
+                    {
+                      fprintf (stderr, "ERROR: Malformed DEMAND_SECTION. Found %d, expecting %d.\n", j - 1, i);
+                      BEL_FreeVRPData(data);
+                      return FALSE;
+                    }
+                    if (demand == 0)
+                    {
+                      // This entry is a depot
+                      ndepot++;
+                    }
+                    data->demand[i] = demand;
+                }
+                data->ncustomers = data->dimension - ndepot;
+                data->ndepots = ndepot;
+			}
+			else if (!strcmp(key, "DEPOT_SECTION"))
+			{
+             	int dep;
+                if (ncount <= 0) {
+                    fprintf (stderr, "ERROR: Dimension not specified\n");
+                    return FALSE;
+                }
+                if (!data->demand) {
+                    fprintf (stderr, "ERROR: Missing DEMAND_SECTION?\n");
+                    BEL_FreeVRPData(data);
+                    return FALSE;
+                }
+                if (data->depots != (int *) NULL) {
+                    fprintf (stderr, "ERROR: A second DEPOT_SECTION?\n");
+                    BEL_FreeVRPData(data);
+                    return FALSE;
+                }
+                data->isadepot = CC_SAFE_MALLOC (ncount, int);
+                if (!data->isadepot) {
+                    BEL_FreeVRPData(data);
+                    return FALSE;
+                }
+								data->depots = CC_SAFE_MALLOC (ndepot, int);
+                if (!data->depots) {
+                    BEL_FreeVRPData(data);
+                    return FALSE;
+                }
+                int k = 0;
+                do {
+                    fscanf (in, "%d", &dep);
+                    if (dep != -1)
+                    {
+											// Assign 1 to identify this node as a depot
+											data->isadepot[dep - 1] = 1;
+											
+											// Put this node in the depots list
+											data->depots[k++] = dep - 1;
+                    }
+                } while (dep != -1);
+			}
+		}
+	}
+	fclose(in);
+
+#ifdef DEBUG
+		for (i = 0; i < ncount; i++)
+		{
+			printf("Coordinates: %.4lf, %.4lf, Demand: %d, Depot: %d\n", data->dat->x[i], data->dat->y[i], data->demand[i], data->isadepot[i]);
+		}
+#endif
+
+	return 0;
+}
+
+/**
+ *  Writes a random CVRP instance with one depot and nnodes - 1 customers.
+ */
+
+static int write_instance(char *fname, int nnodes, int seed)
+{
+	FILE *out;
+	int i;
+
+	if ((out = fopen(fname, "w")) == NULL)
+	{
+		fprintf(stderr, "Cannot open file %s for writing\n", fname);
+		return 1;
+	}
+	srand(seed);
+	fprintf(out, "NAME : bench-n%d\n", nnodes);
+	fprintf(out, "COMMENT : Random instance for the reader benchmark\n");
+	fprintf(out, "TYPE : CVRP\n");
+	fprintf(out, "DIMENSION : %d\n", nnodes);
+	fprintf(out, "EDGE_WEIGHT_TYPE : EUC_2D\n");
+	fprintf(out, "CAPACITY : 1000\n");
+	fprintf(out, "NODE_COORD_SECTION\n");
+	for (i = 0; i < nnodes; i++)
+		fprintf(out, " %d %.3f %.3f\n", i + 1, rand() / (RAND_MAX / 100000.0), rand() / (RAND_MAX / 100000.0));
+	fprintf(out, "DEMAND_SECTION\n");
+	for (i = 0; i < nnodes; i++)
+		fprintf(out, "%d %d\n", i + 1, i ? 1 + rand() % 100 : 0);
+	fprintf(out, "DEPOT_SECTION\n 1\n -1\nEOF\n");
+	fclose(out);
+	return 0;
+}
+
+/**
+ *  Checks that two readers loaded the same instance. The stdio reader took
+ *  every node without demand for a depot, so only the depots listed in the
+ *  file are compared.
+ */
+
+static int same_data(BEL_VRPData *a, BEL_VRPData *b)
+{
+	int i, n = a->dimension;
+
+	if (a->dimension != b->dimension || a->capacity != b->capacity ||
+		a->dat->norm != b->dat->norm)
+		return 0;
+	for (i = 0; i < n; i++)
+	{
+		if (a->dat->x && (a->dat->x[i] != b->dat->x[i] || a->dat->y[i] != b->dat->y[i]))
+			return 0;
+		if (a->dat->adj && memcmp(a->dat->adj[i], b->dat->adj[i], (i + 1) * sizeof(int)))
+			return 0;
+		if (a->demand && a->demand[i] != b->demand[i])
+			return 0;
+	}
+	for (i = 0; i < b->ndepots; i++)
+	{
+		if (a->depots[i] != b->depots[i])
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ *  Reads the file repeats times with a reader, and reports the best time.
+ *  The data of the last read is left in *last.
+ */
+
+static double time_reader(int (*reader)(char *, BEL_VRPData *, int), char *fname,
+	int repeats, BEL_VRPData **last)
+{
+	BEL_VRPData *data;
+	double start, t, best = -1.0;
+	int r;
+
+	for (r = 0; r < repeats; r++)
+	{
+		data = (BEL_VRPData *) malloc(sizeof(BEL_VRPData));
+		BEL_InitVRPData(data);
+		start = CCutil_real_zeit();
+		if (reader(fname, data, 0))
+		{
+			fprintf(stderr, "Error reading %s\n", fname);
+			exit(1);
+		}
+		t = CCutil_real_zeit() - start;
+		if (best < 0.0 || t < best)
+			best = t;
+		if (r < repeats - 1)
+			BEL_FreeVRPData(data);
+		else
+			*last = data;
+	}
+	return best;
+}
+
+int main(int ac, char **av)
+{
+	char *fname = (char *) NULL;
+	char tmpname[64];
+	int nnodes = 100000, repeats = 5;
+	int c, boptind = 1;
+	char *boptarg = (char *) NULL;
+	struct stat st;
+	double mb, t_stdio, t_mmap;
+	BEL_VRPData *a, *b;
+
+	while ((c = CCutil_bix_getopt(ac, av, "n:r:", &boptind, &boptarg)) != EOF)
+	{
+		switch (c)
+		{
+			case 'n': nnodes = atoi(boptarg); break;
+			case 'r': repeats = atoi(boptarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-n nodes] [-r repeats] [file.vrp]\n", av[0]);
+				return 1;
+		}
+	}
+	if (boptind < ac)
+		fname = av[boptind];
+	else
+	{
+		sprintf(tmpname, "tsplibread-n%d.vrp", nnodes);
+		fname = tmpname;
+		if (write_instance(fname, nnodes, 1))
+			return 1;
+	}
+	if (repeats < 1)
+		repeats = 1;
+	if (stat(fname, &st))
+	{
+		fprintf(stderr, "Cannot stat %s\n", fname);
+		return 1;
+	}
+	mb = st.st_size / (1024.0 * 1024.0);
+
+	t_stdio = time_reader(stdio_read, fname, repeats, &a);
+	t_mmap = time_reader(BEL_VRPReadTSPLIB, fname, repeats, &b);
+
+	printf("%s: %d nodes, %.1f MB, best of %d\n", fname, a->dimension, mb, repeats);
+	printf("  stdio reader: %8.4f s  %8.1f MB/s\n", t_stdio, mb / t_stdio);
+	printf("  mmap reader:  %8.4f s  %8.1f MB/s  (%.1fx)\n", t_mmap, mb / t_mmap, t_stdio / t_mmap);
+	if (!same_data(a, b))
+	{
+		fprintf(stderr, "The readers disagree on %s\n", fname);
+		return 1;
+	}
+
+	BEL_FreeVRPData(a);
+	BEL_FreeVRPData(b);
+	if (fname == tmpname)
+		remove(fname);
+	return 0;
+}
@@ -26,11 +26,152 @@
 
 #include "beluga.h"
 #include <glpk.h>
+#include <string.h>
+
+/**
+ *  qsort comparator, sorts volumes by decreasing size.
+ */
+
+static int decreasing(const void *a, const void *b)
+{
+	return *(const int *) b - *(const int *) a;
+}
+
+/**
+ *  Returns the number of volumes greater than x in v, sorted by decreasing
+ *  size.
+ */
+
+static int count_greater(int *v, int n, int x)
+{
+	int lo = 0, hi = n, mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (v[mid] > x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/** Combinatorial bounds on the number of bins of a Bin Packing Problem
+ *
+ *  The lower bound is the L2 bound of Martello and Toth. For every
+ *  threshold <code>K <= V/2</code> the items are split in
+ *
+ *  <code>N1 = {i : v<sub>i</sub> > V - K}</code>,
+ *  <code>N2 = {i : V - K >= v<sub>i</sub> > V/2}</code>,
+ *  <code>N3 = {i : V/2 >= v<sub>i</sub> >= K}</code>
+ *
+ *  Items in N1 and N2 need a bin each, and items in N3 only fit in the
+ *  room left by N2 or in new bins:
+ *
+ *  <code>L(K) = |N1| + |N2| + max(0, ceil((Sum<sub>N3</sub>(v<sub>i</sub>) - (|N2| V - Sum<sub>N2</sub>(v<sub>i</sub>))) / V))</code>
+ *
+ *  With K = 0 this is the L1 bound <code>ceil(Sum<sub>i</sub>(v<sub>i</sub>) / V)</code>
+ *  or better. Only thresholds equal to some item volume need checking, and
+ *  with the volumes sorted each takes O(log n). The upper bound is the best of
+ *  First-Fit-Decreasing and Best-Fit-Decreasing.
+ *
+ *  @param capacity Bin capacity
+ *  @param items Number of items
+ *  @param volume Array of volumes of the items
+ *  @param lower The lower bound
+ *  @param upper The upper bound
+ *  @return 1 if some item doesn't fit in a bin (or on failure), 0 otherwise
+ */
+
+int BEL_BPPBounds(int capacity, int items, int volume[], int *lower, int *upper)
+{
+	int *v, *sum, *room;
+	int i, j, k, n1, n2, n3, lb, l, ffd, bfd, best;
+	long free2;
+
+	v = (int *) malloc((items + 1) * sizeof(int));
+	sum = (int *) malloc((items + 1) * sizeof(int));
+	room = (int *) malloc((items + 1) * sizeof(int));
+	if (!v || !sum || !room)
+	{
+		fprintf(stderr, "BEL_BPPBounds: out of memory\n");
+		free(v);
+		free(sum);
+		free(room);
+		return 1;
+	}
+	memcpy(v, volume, items * sizeof(int));
+	qsort(v, items, sizeof(int), decreasing);
+	if (items && v[0] > capacity)
+	{
+		free(v);
+		free(sum);
+		free(room);
+		return 1;
+	}
+
+	// sum[i] is the total volume of the i largest items
+	for (i = 0, sum[0] = 0; i < items; i++)
+		sum[i + 1] = sum[i] + v[i];
+
+	// L2, with K = 0 first and then every distinct volume up to V/2
+	lb = 0;
+	for (j = items; j >= 0; j--)
+	{
+		k = (j == items ? 0 : v[j]);
+		if (j < items && (2 * k > capacity || (j + 1 < items && v[j + 1] == k)))
+			continue;
+		n1 = count_greater(v, items, capacity - k);
+		n2 = count_greater(v, items, capacity / 2) - n1;
+		n3 = (k ? count_greater(v, items, k - 1) : items);
+		free2 = (long) n2 * capacity - (sum[n1 + n2] - sum[n1]);
+		l = n1 + n2;
+		if (sum[n3] - sum[n1 + n2] > free2)
+			l += (int) ((sum[n3] - sum[n1 + n2] - free2 + capacity - 1) / capacity);
+		if (l > lb)
+			lb = l;
+	}
+
+	// First-Fit-Decreasing
+	for (i = 0, ffd = 0; i < items; i++)
+	{
+		for (j = 0; j < ffd && room[j] < v[i]; j++)
+			;
+		if (j == ffd)
+			room[ffd++] = capacity;
+		room[j] -= v[i];
+	}
+
+	// Best-Fit-Decreasing
+	for (i = 0, bfd = 0; i < items; i++)
+	{
+		for (j = 0, best = -1; j < bfd; j++)
+		{
+			if (room[j] >= v[i] && (best < 0 || room[j] < room[best]))
+				best = j;
+		}
+		if (best < 0)
+		{
+			best = bfd;
+			room[bfd++] = capacity;
+		}
+		room[best] -= v[i];
+	}
+
+	*lower = lb;
+	*upper = MIN(ffd, bfd);
+	free(v);
+	free(sum);
+	free(room);
+	return 0;
+}
 
 /** Bin Packing Problem solver routine
  *
  *  This routine tries to solve a standard Bin Packing Problem instance with our
- *  MIP solver.
+ *  MIP solver. The MIP is only built when the bounds of BEL_BPPBounds don't
+ *  settle the number of bins, and then with no more bins than the upper bound.
  *
  *  @param bins Number of available bins
  *  @param capacity Bin capacity (assumed the same for all bins)
@@ -100,8 +241,24 @@ int BEL_BPPSolve(int bins, int capacity, int items, int volume[], int *min_bins,
 	 */
 
 	LPX *lp;
-	int ia[1 + MAX_NONZEROES], ja[1 + MAX_NONZEROES], required_bins, rows, cols, nonzeroes;
-	double ar[1 + MAX_NONZEROES];
+	int *ia, *ja, rows, cols, nonzeroes, lower, upper;
+	double *ar;
+
+	/**
+	 * The MIP is very symmetric and slow, so first try the combinatorial
+	 * bounds. When they agree, they already give the number of bins.
+	 */
+
+	if (BEL_BPPBounds(capacity, items, volume, &lower, &upper))
+		return 0;
+	if (verbose)
+		printf("Bin packing bounds: L2 %d, FFD/BFD %d\n", lower, upper);
+	if (lower > bins || lower == upper)
+	{
+		*min_bins = lower;
+		return (lower <= bins);
+	}
+	bins = MIN(bins, upper);
 
 	rows = (items)            // (2)
 	       + (bins)           // (3)
@@ -122,6 +279,18 @@ int BEL_BPPSolve(int bins, int capacity, int items, int volume[], int *min_bins,
 	  printf("Nonzeroes: %d\n", nonzeroes);
 	}
 	
+	ia = (int *) malloc((1 + nonzeroes) * sizeof(int));
+	ja = (int *) malloc((1 + nonzeroes) * sizeof(int));
+	ar = (double *) malloc((1 + nonzeroes) * sizeof(double));
+	if (!ia || !ja || !ar)
+	{
+		fprintf(stderr, "Out of memory for the BPP model\n");
+		free(ia);
+		free(ja);
+		free(ar);
+		return 0;
+	}
+
 	// Create a problem
 	lp = lpx_create_prob();
 
@@ -136,7 +305,7 @@ int BEL_BPPSolve(int bins, int capacity, int items, int volume[], int *min_bins,
 	
 	// Initialize rows
 	int i, j, offset, row = 0, col = 0;
-	char *s;
+	char s[64];
 	for (i = 1; i <= items; i++)
 	{
 	  sprintf(s, "c2[%d]", i);
@@ -270,9 +439,14 @@ int BEL_BPPSolve(int bins, int capacity, int items, int volume[], int *min_bins,
 	}
 
 	lpx_load_matrix(lp, offset, ia, ja, ar);
+	free(ia);
+	free(ja);
+	free(ar);
 	
+#ifdef DEBUG
 	// Write to a file
 	lpx_write_cpxlp(lp, "binpacking.lp");
+#endif
 	
 	lpx_set_class(lp, LPX_MIP);
 	for (i = 1; i <= (items + 1) * bins; i++)
@@ -283,14 +457,18 @@ int BEL_BPPSolve(int bins, int capacity, int items, int volume[], int *min_bins,
   	printf("Integer columns: %d\n", lpx_get_num_int(lp));
   	
   // Launch the MIP solver
+  double start = BEL_TraceClock();
   lpx_intopt(lp);
+  BEL_TraceComplete("lpx_intopt", "glpk", start, "items", items, "bins", bins);
 
+#ifdef DEBUG
 	// Write problem to a file
 	lpx_print_prob(lp, "binpacking.dat");
 	// Write output to a file
 	lpx_print_sol(lp, "binpacking.sol");
 	// Write output to a file
 	lpx_print_mip(lp, "binpacking.mipsol");
+#endif
 
 	// Set the minimum number of bins
 	*min_bins = lpx_mip_obj_val(lp);
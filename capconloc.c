@@ -27,22 +27,30 @@
 #include "beluga.h"
 #include <glpk.h>
 
-/** Bin Packing Problem solver routine
+/** Capacitated Concentrator Location Problem solver routine
  *
- *  This routine tries to solve a standard Bin Packing Problem instance with our
- *  MIP solver.
+ *  This routine solves a Capacitated Concentrator Location Problem instance
+ *  with our MIP solver, where each item can only be assigned to a given list
+ *  of candidate seeds. The candidates of the ith item are
+ *  <code>cand[start[i]]...cand[start[i + 1] - 1]</code>, and assigning it to
+ *  the candidate at position p costs <code>cost[p]</code>. Only the items
+ *  that appear in some list can become seeds.
  *
  *  @param items Number of items (nodes) to allocate
- *  @param  cost Bidimensional array of cost of allocation for the items
+ *  @param start Array of items + 1 offsets into cand and cost
+ *  @param cand Candidate seeds of each item
+ *  @param cost Cost of assigning each item to each of its candidate seeds
  *  @param weight Array of weights for the nodes
  *  @param seeds  Number of nodes to be chosen as seeds for clusters
  *  @param seed_cost  Array of cost for a node to become seed
  *  @param capacity  Cluster capacity
  *  @param assignments  Array of assignations. Indicates what seed the ith item is assigned to.
  *  @param verbose  Turns on lots of messages
- *  @return 1 on failure, 0 otherwise
+ *  @return 0 on success, BEL_VRP_INFEASIBLE if no assignment fits the
+ *  candidate lists, 1 on any other failure
  */
-int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seeds, int seed_cost[items], int capacity, int assignments[items], int verbose)
+int BEL_CCLPSolveSparse(int items, int start[], int cand[], int cost[], int weight[items],
+	int seeds, int seed_cost[items], int capacity, int assignments[items], int verbose)
 {
   /**
    * Here we use the GLPK LP solver library.
@@ -51,77 +59,124 @@ int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seed
    * We are interested in building K lists of customers, then the caller will
    * find an optimal TSP tour between them.
    *
-   * A CCLP problem has the following structure:
+   * Let C(i) be the candidate seeds of the i-th item, and S the union of the
+   * C(i). A CCLP problem has the following structure:
    *
    * <ol><li>Variables:
    *
-   *    <code>y<sub>ij</sub>: i-th item is assigned to j-th seed, i=1...N, j=1...N</code><br>
-   *    <code>z<sub>j</sub>: j-th item is a seed, j=1...N</code></li>
+   *    <code>y<sub>ij</sub>: i-th item is assigned to j-th seed, i=1...N, j in C(i)</code><br>
+   *    <code>z<sub>j</sub>: j-th item is a seed, j in S</code></li>
    *
    * <li>Parameters:
    *
-   *    <code>d<sub>ij</sub>: cost of assigning i-th item to j-th seed, i=1...N, j=1...N</code><br>
-   *    <code>v<sub>j</sub>: cost of choosing j-th item to be seed, j=1...N</code><br>
+   *    <code>d<sub>ij</sub>: cost of assigning i-th item to j-th seed, i=1...N, j in C(i)</code><br>
+   *    <code>v<sub>j</sub>: cost of choosing j-th item to be seed, j in S</code><br>
    *    <code>a<sub>i</sub>: weight of i-th item, i=1...N</li></code><br>
    *
    * <li>Objective function
    *
    * <ul><li>Minimize the total cost
    *
-   *    <code>min Sum<sub>i=1...N,j=1...N</sub>(d<sub>ij</sub>y<sub>ij</sub>) +
-	 *		Sum<sub>j=1...N</sub>(v<sub>j</sub>z<sub>j</sub>) (1)</code></li></ul>
+   *    <code>min Sum<sub>i=1...N,j in C(i)</sub>(d<sub>ij</sub>y<sub>ij</sub>) +
+	 *		Sum<sub>j in S</sub>(v<sub>j</sub>z<sub>j</sub>) (1)</code></li></ul>
    *
    * <li>Constraints
    *
    * <ul><li>We can accept only K seeds:
    *
-   *    <code>Sum<sub>j=1...N</sub>(z<sub>j</sub>) = K (2)</code></li>
+   *    <code>Sum<sub>j in S</sub>(z<sub>j</sub>) = K (2)</code></li>
    *
    * <li>An item must be assigned to one and only one seed:
    *
-   *    <code>Sum<sub>j=1...N</sub>(y<sub>ij</sub>) = 1, i=1...N (3)</code></li>
+   *    <code>Sum<sub>j in C(i)</sub>(y<sub>ij</sub>) = 1, i=1...N (3)</code></li>
    *
    * <li>Total weight of items associated with j-th seed cannot exceed cluster
    * capacity:
    *
-   *    <code>Sum<sub>i=1...M</sub>(a<sub>i</sub>y<sub>ij</sub>) <= V*z<sub>j</sub>, j=1...N (4)</code>
+   *    <code>Sum<sub>i: j in C(i)</sub>(a<sub>i</sub>y<sub>ij</sub>) <= V*z<sub>j</sub>, j in S (4)</code>
    *
    * we write it as:
 	 *
-   *    <code>Sum<sub>i=1...M</sub>(a<sub>i</sub>y<sub>ij</sub>) - V*z<sub>j</sub> <= 0, j=1...N (4')</code></li>
+   *    <code>Sum<sub>i: j in C(i)</sub>(a<sub>i</sub>y<sub>ij</sub>) - V*z<sub>j</sub> <= 0, j in S (4')</code></li>
    *
    *
    * <li>For performance issues, we also add the following constraints:
    *
    * We can assign i-th item to j-th item only if it is a seed
    *
-   *    <code>y<sub>ij</sub> <= z<sub>j</sub>, i=1...N, j=1...N (5)</code>
+   *    <code>y<sub>ij</sub> <= z<sub>j</sub>, i=1...N, j in C(i) (5)</code>
    *
    * we write it as:
    *
-   *    <code>y<sub>ij</sub> - z<sub>j</sub> <= 0, i=1...N, j=1...N (5')</code></li></ul></li></ol>
+   *    <code>y<sub>ij</sub> - z<sub>j</sub> <= 0, i=1...N, j in C(i) (5')</code></li></ul></li></ol>
    *
+   * When every C(i) holds all the items, this is the full model with
+   * (N+1)N columns. With k candidates per item it has (k+1)N at most.
    */
    
 #ifdef DEBUG
-	print_matrix(items, items, cost, "cost");
+	print_array(items + 1, start, "start");
+	print_array(start[items], cand, "cand");
+	print_array(start[items], cost, "cost");
 	print_array(items, weight, "weight");
 	print_array(items, seed_cost, "seed_cost");
 #endif
 
   LPX *lp;
-  int ia[1 + MAX_NONZEROES], ja[1 + MAX_NONZEROES], rows, cols, nonzeroes;
-  double ar[1 + MAX_NONZEROES];
+  int *rowind = (int *) NULL;
+  double *rowval = (double *) NULL;
+  int *seedcol = (int *) NULL;    // z column of each item, 0 if not in S
+  int *seedstart = (int *) NULL;  // pairs of each seed, as offsets into seedpair
+  int *seedpair = (int *) NULL;   // pairs (y columns - 1) grouped by seed
+  int *seeditem = (int *) NULL;   // item of each pair in seedpair
+  int npairs = start[items];
+  int nseeds, maxlen, rows, cols, nonzeroes;
+  int i, j, p, row, ret, mip_status, rval = 0;
+  double val;
+  char s[255];
+
+  seedcol = (int *) calloc(items, sizeof(int));
+  seedstart = (int *) calloc(items + 2, sizeof(int));
+  seedpair = (int *) malloc((npairs + 1) * sizeof(int));
+  seeditem = (int *) malloc((npairs + 1) * sizeof(int));
+  if (!seedcol || !seedstart || !seedpair || !seeditem)
+  {
+    fprintf(stderr, "BEL_CCLPSolveSparse: out of memory\n");
+    rval = 1;
+    goto CLEANUP;
+  }
+
+  // Number the seeds in S and group the pairs by seed
+  for (p = 0; p < npairs; p++)
+    seedstart[cand[p] + 2]++;
+  nseeds = 0;
+  maxlen = items;
+  for (j = 0; j < items; j++)
+  {
+    if (seedstart[j + 2])
+      seedcol[j] = npairs + (++nseeds);
+    if (seedstart[j + 2] + 1 > maxlen)
+      maxlen = seedstart[j + 2] + 1;
+    seedstart[j + 2] += seedstart[j + 1];
+  }
+  for (i = 0; i < items; i++)
+  {
+    for (p = start[i]; p < start[i + 1]; p++)
+    {
+      seeditem[seedstart[cand[p] + 1]] = i;
+      seedpair[seedstart[cand[p] + 1]++] = p;
+    }
+  }
 
   rows = (1)                 // (2)
+         + (nseeds)          // (4)
          + (items)           // (3)
-         + (items)           // (4)
-         + (items * items);  // (5)
-  cols = (items + 1) * items;
-  nonzeroes = (1) * (items)
-         + (items) * (items + 1)
-         + (items) * (items)
-         + (items * items) * (2);
+         + (npairs);         // (5)
+  cols = npairs + nseeds;
+  nonzeroes = (1) * (nseeds)
+         + (npairs + nseeds)
+         + (npairs)
+         + (npairs) * (2);
 
 	if (verbose)
 	{
@@ -129,6 +184,7 @@ int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seed
 
 		printf("Items: %d\n", items);
 		printf("Seeds: %d\n", seeds);
+		printf("Candidate seeds: %d\n", nseeds);
 		printf("Capacity: %d\n", capacity);
 
 	  printf("Rows: %d\n", rows);
@@ -136,7 +192,14 @@ int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seed
    	printf("Nonzeroes: %d\n", nonzeroes);
  	}
 
+  if (nseeds < MIN(seeds, items))
+  {
+    rval = BEL_VRP_INFEASIBLE;
+    goto CLEANUP;
+  }
+
   // Create a problem
+  BEL_PhaseBegin(BEL_PHASE_CCLP_BUILD);
   lp = lpx_create_prob();
 
   // Set the problem's name
@@ -149,8 +212,7 @@ int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seed
   lpx_add_rows(lp, rows);
   
   // Initialize rows
-  int i, j, offset, row = 1, col = 0;
-  char s[255];
+  row = 1;
 
   // Constraint (2)
 
@@ -158,17 +220,17 @@ int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seed
 	lpx_set_row_name(lp, row, s);
 	lpx_set_row_bnds(lp, row, LPX_FX, (float)MIN(seeds, items), (float)MIN(seeds, items));
 
-  // Constraint (3)
+  // Constraint (4')
 
-  for (i = 1; i <= items; i++)
+  for (i = 1; i <= nseeds; i++)
   {
     sprintf(s, "c3[%d]", i);
     lpx_set_row_name(lp, i + row, s);
     lpx_set_row_bnds(lp, i + row, LPX_UP, 0.0, 0.0);
   }
-  row += items;
+  row += nseeds;
   
-  // Constraint (4)
+  // Constraint (3)
   
   for (i = 1; i <= items; i++)
   {
@@ -178,156 +240,403 @@ int BEL_CCLPSolve(int items, int cost[items][items], int weight[items], int seed
   }
   row += items;
   
-  // Contraint (5)
+  // Contraint (5')
   
-  for (i = 1; i <= items; i++)
+  for (p = 1; p <= npairs; p++)
   {
-    for (j = 1; j <= items; j++)
-    {
-      sprintf(s, "c5[%d]", i * items + j);
-      lpx_set_row_name(lp, j + row, s);
-      lpx_set_row_bnds(lp, j + row, LPX_UP, 0.0, 0.0);
-    }
-    row += items;
+    sprintf(s, "c5[%d]", p);
+    lpx_set_row_name(lp, p + row, s);
+    lpx_set_row_bnds(lp, p + row, LPX_UP, 0.0, 0.0);
   }
 
   // Initialize cols
   lpx_add_cols(lp, cols);
-  for (i = 1, row = 0; i <= items; i++)
+  for (i = 0; i < items; i++)
   {
-    for (j = 1; j <= items; j++)
+    for (p = start[i]; p < start[i + 1]; p++)
     {
-      sprintf(s, "y[%d][%d]", i, j);
-      lpx_set_col_name(lp, j + col, s);
-      lpx_set_col_bnds(lp, j + col, LPX_DB, 0.0, 1.0);
-      lpx_set_obj_coef(lp, j + col, cost[i - 1][j - 1]);
+      sprintf(s, "y[%d][%d]", i + 1, cand[p] + 1);
+      lpx_set_col_name(lp, p + 1, s);
+      lpx_set_col_bnds(lp, p + 1, LPX_DB, 0.0, 1.0);
+      lpx_set_obj_coef(lp, p + 1, cost[p]);
     }
-    col += items;
   }
-  for (j = 1; j <= items; j++)
+  for (j = 0; j < items; j++)
   {
-    sprintf(s, "z[%d]", j);
-    lpx_set_col_name(lp, j + col, s);
-    lpx_set_col_bnds(lp, j + col, LPX_DB, 0.0, 1.0);
-    lpx_set_obj_coef(lp, j + col, seed_cost[j - 1]);
+    if (!seedcol[j])
+      continue;
+    sprintf(s, "z[%d]", j + 1);
+    lpx_set_col_name(lp, seedcol[j], s);
+    lpx_set_col_bnds(lp, seedcol[j], LPX_DB, 0.0, 1.0);
+    lpx_set_obj_coef(lp, seedcol[j], seed_cost[j]);
   }
 
-  // Initialize matrix
-  row = 0;
-  col = 0;
-  offset = 0;
-  for (i = 1; i <= items; i++)
+  /**
+   *  Initialize matrix. Rows are passed to GLPK one at a time, so we only
+   *  need room for the longest one. Indexes start from 1, as usual in GLPK.
+   */
+
+  rowind = (int *) malloc((maxlen + 1) * sizeof(int));
+  rowval = (double *) malloc((maxlen + 1) * sizeof(double));
+  if (!rowind || !rowval)
   {
-    offset++;
-    ia[offset] = 1;
-    ja[offset] = i + items * items + row;
-    ar[offset] = 1.0;
-#ifdef DEBUG
-    printf("%d: a[%d][%d] = %f\n", offset, 1, i + items * items + row, 1.0);
-#endif
+    fprintf(stderr, "BEL_CCLPSolveSparse: out of memory for the constraint matrix\n");
+    lpx_delete_prob(lp);
+    BEL_PhaseEnd(BEL_PHASE_CCLP_BUILD);
+    rval = 1;
+    goto CLEANUP;
   }
-  row++;
-  for (i = 1; i <= items; i++)
+
+  // (2): Sum z[j] = K
+  row = 1;
+  for (j = 0, i = 0; j < items; j++)
   {
-    for (j = i; j <= i + items * (items - 1); j += items)
+    if (!seedcol[j])
+      continue;
+    i++;
+    rowind[i] = seedcol[j];
+    rowval[i] = 1.0;
+  }
+  lpx_set_mat_row(lp, row, nseeds, rowind, rowval);
+
+  // (4'): Sum a[i] y[i][j] - V z[j] <= 0
+  for (j = 0; j < items; j++)
+  {
+    if (!seedcol[j])
+      continue;
+    row++;
+    for (p = seedstart[j], i = 0; p < seedstart[j + 1]; p++)
     {
-      offset++;
-      ia[offset] = i + row;
-      ja[offset] = j;
-      ar[offset] = weight[(j - 1) / items];
-#ifdef DEBUG
-      printf("%d: a[%d][%d] = weight[%d] = %d\n", offset, i + row, j, (j - 1) / items, weight[(j - 1) / items]);
-#endif
+      i++;
+      rowind[i] = seedpair[p] + 1;
+      rowval[i] = weight[seeditem[p]];
     }
-    offset++;
-    ia[offset] = i + row;
-    ja[offset] = i + (items * items);
-    ar[offset] = -capacity;
+    rowind[i + 1] = seedcol[j];
+    rowval[i + 1] = -capacity;
+    lpx_set_mat_row(lp, row, i + 1, rowind, rowval);
   }
-  row += items;
 
-  for (i = 1; i <= items; i++)
+  // (3): Sum y[i][j] = 1
+  for (i = 0; i < items; i++)
   {
-    for (j = (i - 1) * items + 1; j <= i * items; j++)
+    row++;
+    for (p = start[i]; p < start[i + 1]; p++)
     {
-      offset++;
-      ia[offset] = i + row;
-      ja[offset] = j;
-      ar[offset] = 1.0;
-#ifdef DEBUG
-      printf("%d: a[%d][%d] = %d\n", offset, i + row, j, 1.0);
-#endif
+      rowind[p - start[i] + 1] = p + 1;
+      rowval[p - start[i] + 1] = 1.0;
     }
+    lpx_set_mat_row(lp, row, start[i + 1] - start[i], rowind, rowval);
   }
-  row += items;
 
-  for (i = 1; i <= items * items; i++)
+  // (5'): y[i][j] - z[j] <= 0
+  rowval[1] = 1.0;
+  rowval[2] = -1.0;
+  for (p = 0; p < npairs; p++)
   {
-    offset++;
-    ia[offset] = i + row;
-    ja[offset] = i;
-    ar[offset] = 1.0;
-#ifdef DEBUG
-    printf("%d: a[%d][%d] = %f\n", offset, i + row, i, 1.0);
-#endif
-
-    offset++;
-    ia[offset] = i + row;
-    ja[offset] = items * items + ((i - 1) % items) + 1;
-    ar[offset] = -1.0;
-#ifdef DEBUG
-    printf("%d: a[%d][%d] = %f\n", offset, i + row, items * items + ((i - 1) % items) + 1, -1.0);
-#endif
+    row++;
+    rowind[1] = p + 1;
+    rowind[2] = seedcol[cand[p]];
+    lpx_set_mat_row(lp, row, 2, rowind, rowval);
   }
-  row += items * items;
 
-  lpx_load_matrix(lp, offset, ia, ja, ar);
-  
+#ifdef DEBUG
   // Write to a file
   lpx_write_cpxlp(lp, "capconloc.lp");
+#endif
 
   lpx_set_class(lp, LPX_MIP);
-  for (i = 1; i <= (items + 1) * items; i++)
+  for (i = 1; i <= cols; i++)
   {
     lpx_set_col_kind(lp, i, LPX_IV);
   }
   if (verbose)
   	printf("Integer columns: %d\n", lpx_get_num_int(lp));
 
+  BEL_PhaseEnd(BEL_PHASE_CCLP_BUILD);
+
   // Launch the MIP solver
-  lpx_intopt(lp);
+  BEL_PhaseBegin(BEL_PHASE_CCLP_SOLVE);
+  double tracestart = BEL_TraceClock();
+  ret = lpx_intopt(lp);
+  BEL_TraceComplete("lpx_intopt", "glpk", tracestart, "rows", rows, "cols", cols);
+  BEL_PhaseEnd(BEL_PHASE_CCLP_SOLVE);
 
-  int mip_status = lpx_mip_status(lp);
+  mip_status = lpx_mip_status(lp);
   if (verbose)
   	printf("Status: %d\n", mip_status);
-  double val;
   switch (mip_status)
   {
-    default:
+    case LPX_I_OPT:
+    case LPX_I_FEAS:
       for (i = 0; i < items; i++)
       {
         // Consider i-th item
-        for (j = 0; j < items; j++)
+        for (p = start[i]; p < start[i + 1]; p++)
         {
           // If y[ij] = 1 assign item i to seed j
-          val = lpx_mip_col_val(lp, i * items + j + 1);
-          if (val != 0)
-            assignments[i] = j;
+          val = lpx_mip_col_val(lp, p + 1);
+          if (val > 0.5)
+            assignments[i] = cand[p];
 #ifdef DEBUG
-          printf("%d: y[%d][%d] = %lf\n", i * items + j, i, j, lpx_mip_col_val(lp, i * items + j + 1));
+          printf("%d: y[%d][%d] = %lf\n", p, i, cand[p], val);
 #endif
         }
       }
+      break;
+    case LPX_I_NOFEAS:
+      rval = BEL_VRP_INFEASIBLE;
+      break;
+    default:
+      // The LP relaxation is already infeasible
+      rval = (ret == LPX_E_NOPFS ? BEL_VRP_INFEASIBLE : 1);
   }
 
+#ifdef DEBUG
   // Write problem to a file
   lpx_print_prob(lp, "capconloc.dat");
   // Write output to a file
   lpx_print_sol(lp, "capconloc.sol");
   // Write output to a file
   lpx_print_mip(lp, "capconloc.mipsol");
+#endif
 
   lpx_delete_prob(lp);
 
+CLEANUP:
+  free(rowind);
+  free(rowval);
+  free(seedcol);
+  free(seedstart);
+  free(seedpair);
+  free(seeditem);
+  return rval;
+}
+
+/** Capacitated Concentrator Location Problem solver routine
+ *
+ *  Solves the full model, where every item can be assigned to every other
+ *  item.
+ *
+ *  @param items Number of items (nodes) to allocate
+ *  @param  cost Cost of allocation for the items, as an items x items array
+ *  stored by rows: <code>cost[i * items + j]</code> is the cost of assigning
+ *  the ith item to the jth seed
+ *  @param weight Array of weights for the nodes
+ *  @param seeds  Number of nodes to be chosen as seeds for clusters
+ *  @param seed_cost  Array of cost for a node to become seed
+ *  @param capacity  Cluster capacity
+ *  @param assignments  Array of assignations. Indicates what seed the ith item is assigned to.
+ *  @param verbose  Turns on lots of messages
+ *  @return 0 on success, BEL_VRP_INFEASIBLE if the instance is infeasible,
+ *  1 on any other failure
+ */
+int BEL_CCLPSolve(int items, int cost[], int weight[items], int seeds, int seed_cost[items], int capacity, int assignments[items], int verbose)
+{
+  int *start, *cand;
+  int i, j, rval;
+
+  start = (int *) malloc((items + 1) * sizeof(int));
+  cand = (int *) malloc((size_t) items * items * sizeof(int));
+  if (!start || !cand)
+  {
+    fprintf(stderr, "BEL_CCLPSolve: out of memory\n");
+    free(start);
+    free(cand);
+    return 1;
+  }
+  for (i = 0; i <= items; i++)
+  {
+    start[i] = i * items;
+    for (j = 0; j < items && i < items; j++)
+      cand[i * items + j] = j;
+  }
+
+  rval = BEL_CCLPSolveSparse(items, start, cand, cost, weight, seeds, seed_cost,
+    capacity, assignments, verbose);
+
+  free(start);
+  free(cand);
+  return rval;
+}
+
+/**
+ *  qsort comparator for (distance, item) pairs: farthest first, ties
+ *  broken by item so that the order does not depend on the library.
+ */
+
+static int farthest_first(const void *a, const void *b)
+{
+  const int *x = (const int *) a, *y = (const int *) b;
+
+  if (x[0] != y[0])
+    return (x[0] > y[0] ? -1 : 1);
+  return x[1] - y[1];
+}
+
+/**
+ *  Builds the candidate lists for BEL_CCLPSolveSparse. Candidate seeds are
+ *  the nseeds customers farthest from the depot, and each customer gets the
+ *  ncand of them nearest to it. A customer that is a candidate seed always
+ *  has itself among its candidates. The cost of assigning customer i to
+ *  seed j is <code>d<sub>i0</sub> + d<sub>ij</sub> - d<sub>j0</sub></code>.
+ */
+
+static int build_candidates(BEL_VRPData *data, int depot, int items, int customer2node[],
+  int nseeds, int ncand, int start[], int cand[], int cost[])
+{
+  int *keys, *seedlist, *bestd;
+  int i, j, k, p, q, d, node;
+
+  keys = (int *) malloc(2 * items * sizeof(int));
+  seedlist = (int *) malloc(items * sizeof(int));
+  bestd = (int *) malloc((ncand + 1) * sizeof(int));
+  if (!keys || !seedlist || !bestd)
+  {
+    fprintf(stderr, "Out of memory for the CCLP candidate seeds\n");
+    free(keys);
+    free(seedlist);
+    free(bestd);
+    return 1;
+  }
+
+  for (i = 0; i < items; i++)
+  {
+    keys[2 * i] = BEL_Dist(data, customer2node[i], depot);
+    keys[2 * i + 1] = i;
+  }
+  qsort(keys, items, 2 * sizeof(int), farthest_first);
+  for (j = 0; j < nseeds; j++)
+    seedlist[j] = keys[2 * j + 1];
+
+  for (i = 0, p = 0; i < items; i++)
+  {
+    node = customer2node[i];
+    start[i] = p;
+    if (ncand >= nseeds)
+    {
+      for (j = 0; j < nseeds; j++)
+        cand[p + j] = seedlist[j];
+      k = nseeds;
+    }
+    else
+    {
+      // Keep the ncand nearest seeds sorted by distance, ourselves first
+      for (j = 0, k = 0; j < nseeds; j++)
+      {
+        d = (seedlist[j] == i ? -1 : BEL_Dist(data, node, customer2node[seedlist[j]]));
+        if (k == ncand && d >= bestd[k - 1])
+          continue;
+        if (k < ncand)
+          k++;
+        for (q = k - 1; q > 0 && bestd[q - 1] > d; q--)
+        {
+          bestd[q] = bestd[q - 1];
+          cand[p + q] = cand[p + q - 1];
+        }
+        bestd[q] = d;
+        cand[p + q] = seedlist[j];
+      }
+    }
+    for (j = p; j < p + k; j++)
+      cost[j] = BEL_Dist(data, node, depot) + BEL_Dist(data, node, customer2node[cand[j]]) -
+        BEL_Dist(data, depot, customer2node[cand[j]]);
+    p += k;
+  }
+  start[items] = p;
+
+  free(keys);
+  free(seedlist);
+  free(bestd);
   return 0;
 }
+
+/** Clusters the customers of a VRP instance by solving a CCLP
+ *
+ *  With <code>ncand</code> greater than 0, solves the sparse model of
+ *  BEL_CCLPSolveSparse, where each customer can only be assigned to its
+ *  ncand nearest candidate seeds, and the candidate seeds are the
+ *  BEL_CCLP_SEEDPOOL * K customers farthest from the depot. This takes the
+ *  model from O(n<sup>2</sup>) to O(n ncand) columns and rows. If the sparse
+ *  model is infeasible, both the candidates and the seeds are doubled until
+ *  the model is the full one. With ncand 0 the full model is solved directly.
+ *  The model is solved by GLPK with method BEL_CLUSTER_MIP, or by the
+ *  heuristic of BEL_CCLPSolveLagrangian with BEL_CLUSTER_LAGRANGIAN. If the
+ *  heuristic finds no assignment even on the full model, GLPK is tried.
+ *
+ *  @param data The problem instance
+ *  @param depot The depot of the routes
+ *  @param items Number of customers
+ *  @param customer2node Node of each customer
+ *  @param weight Demand of each customer
+ *  @param seed_cost Cost for each customer to become a seed
+ *  @param ncand Number of candidate seeds for each customer, 0 for all
+ *  @param method BEL_CLUSTER_MIP or BEL_CLUSTER_LAGRANGIAN
+ *  @param assignments Seed each customer is assigned to
+ *  @param verbose Turns on lots of messages
+ *  @return 1 on failure, 0 otherwise
+ */
+int BEL_CCLPCluster(BEL_VRPData *data, int depot, int items, int customer2node[], int weight[],
+  int seed_cost[], int ncand, int method, int assignments[], int verbose)
+{
+  int seeds = MIN(data->nvehicles, items);
+  int nseeds = items;
+  int *start, *cand, *cost;
+  int rval;
+
+  if (ncand <= 0 || ncand >= items)
+    ncand = items;
+  else if (BEL_CCLP_SEEDPOOL * seeds < items)
+    nseeds = (BEL_CCLP_SEEDPOOL * seeds > ncand ? BEL_CCLP_SEEDPOOL * seeds : ncand);
+
+  for (;;)
+  {
+    ncand = MIN(ncand, nseeds);
+    start = (int *) malloc((items + 1) * sizeof(int));
+    cand = (int *) malloc((size_t) items * ncand * sizeof(int));
+    cost = (int *) malloc((size_t) items * ncand * sizeof(int));
+    if (!start || !cand || !cost)
+    {
+      fprintf(stderr, "Out of memory for the CCLP model\n");
+      rval = 1;
+    }
+    else
+    {
+      BEL_PhaseBegin(BEL_PHASE_CCLP_BUILD);
+      rval = build_candidates(data, depot, items, customer2node, nseeds, ncand, start, cand, cost);
+      BEL_PhaseEnd(BEL_PHASE_CCLP_BUILD);
+    }
+    if (!rval)
+    {
+      if (method == BEL_CLUSTER_LAGRANGIAN)
+      {
+        BEL_PhaseBegin(BEL_PHASE_CCLP_SOLVE);
+        rval = BEL_CCLPSolveLagrangian(items, start, cand, cost, weight, data->nvehicles,
+          seed_cost, data->capacity, assignments, NULL, verbose);
+        BEL_PhaseEnd(BEL_PHASE_CCLP_SOLVE);
+        if (rval == BEL_VRP_INFEASIBLE && ncand == items && nseeds == items)
+        {
+          if (verbose)
+            printf("No assignment found by the Lagrangian heuristic, solving the MIP\n");
+          method = BEL_CLUSTER_MIP;
+        }
+      }
+      if (method == BEL_CLUSTER_MIP)
+        rval = BEL_CCLPSolveSparse(items, start, cand, cost, weight, data->nvehicles,
+          seed_cost, data->capacity, assignments, verbose);
+    }
+    free(start);
+    free(cand);
+    free(cost);
+
+    if (rval != BEL_VRP_INFEASIBLE || (ncand == items && nseeds == items))
+      break;
+    if (verbose)
+      printf("CCLP with %d candidates among %d seeds is infeasible, widening\n", ncand, nseeds);
+    ncand = MIN(2 * ncand, items);
+    nseeds = MIN(2 * nseeds, items);
+  }
+
+  if (rval == BEL_VRP_INFEASIBLE)
+    fprintf(stderr, "The CCLP has no feasible assignment\n");
+  return (rval ? 1 : 0);
+}
@@ -26,11 +26,8 @@
 
 #include "beluga.h"
 #include <concorde.h>
-
-#define MATRIX_LOWER_DIAG_ROW  0
-#define MATRIX_UPPER_ROW       1
-#define MATRIX_UPPER_DIAG_ROW  2
-#define MATRIX_FULL_MATRIX     3
+#include <string.h>
+#include <sys/mman.h>
 
 void print_matrix(int, int, int **, char *);
 void print_array(int, int *, char *);
@@ -55,7 +52,11 @@ void BEL_InitVRPData(BEL_VRPData *data)
 	data->comment = (char *) NULL;
 
 	data->demand = (int *) NULL;
+	data->isadepot = (int *) NULL;
 	data->depots = (int *) NULL;
+	data->dist = (int *) NULL;
+	data->map = NULL;
+	data->mapsize = 0;
 	CCutil_init_datagroup(data->dat);
 }
 
@@ -63,18 +64,37 @@ void BEL_InitVRPData(BEL_VRPData *data)
  *
  *  Recursively calls <code>free</code> on all pointer members of the
  *  BEL_VRPData structure. Calls Concorde's <code>CCutil_freedatagroup</code> on
- *  <code>CCdatagroup dat</code> member.
+ *  <code>CCdatagroup dat</code> member. Arrays mapped from a .vrpb file are
+ *  released by unmapping the file.
  *
  *  @param data The structure to be released.
  */
 
 void BEL_FreeVRPData(BEL_VRPData *data)
 {
+  if (data->map)
+  {
+    // Arrays loaded from a .vrpb file live in its memory map
+    char *lo = (char *) data->map, *hi = lo + data->mapsize;
+#define IN_MAP(p) ((char *) (p) >= lo && (char *) (p) < hi)
+    if (IN_MAP(data->dat->x)) data->dat->x = (double *) NULL;
+    if (IN_MAP(data->dat->y)) data->dat->y = (double *) NULL;
+    if (IN_MAP(data->dat->z)) data->dat->z = (double *) NULL;
+    if (IN_MAP(data->dat->adjspace)) data->dat->adjspace = (int *) NULL;
+    if (IN_MAP(data->demand)) data->demand = (int *) NULL;
+    if (IN_MAP(data->depots)) data->depots = (int *) NULL;
+    if (IN_MAP(data->dist)) data->dist = (int *) NULL;
+#undef IN_MAP
+    munmap(data->map, data->mapsize);
+  }
   CCutil_freedatagroup(data->dat);
+  free(data->dat);
   free(data->name);
   free(data->comment);
   free(data->demand);
+  free(data->isadepot);
   free(data->depots);
+  free(data->dist);
   free(data);
 }
 
@@ -88,403 +108,171 @@ void BEL_FreeVRPData(BEL_VRPData *data)
  
 void BEL_InitVRPSolution(BEL_VRPSolution *sol)
 {
-	sol->routes = (int **) NULL;
-	sol->routelen = (int *) NULL;
+	sol->start = (int *) NULL;
+	sol->nodes = (int *) NULL;
+	sol->load = (int *) NULL;
+	sol->routecost = (int *) NULL;
 	sol->cost = 0;
-  sol->nvehicles = 0;
+	sol->nvehicles = 0;
+	sol->nstops = 0;
+	sol->block = NULL;
+	sol->blocksize = 0;
+	sol->arena = (BEL_Arena *) NULL;
 }
 
 /** Releases memory allocated by a BEL_VRPSolution struct
  *
- *  Recursively calls <code>free</code> on all pointer members of the
- *  BEL_VRPSolution structure.
+ *  All the arrays of a solution are in one block, so this is a single
+ *  <code>free</code>. A block that comes from an arena is left alone, it
+ *  is released with the arena.
  *
  *  @param sol The structure to be released.
  */
 
 void BEL_FreeVRPSolution(BEL_VRPSolution *sol)
 {
-  free(sol->routes);
-  free(sol->routelen);
+	if (!sol->arena)
+		free(sol->block);
+	BEL_InitVRPSolution(sol);
 }
 
-/** Reads a TSPLIB file to a BEL_VRPData structure
+/** Allocates the arrays of a BEL_VRPSolution
  *
- *  This function reads a TSPLIB file and creates a BEL_VRPData structure
- *	representing the given problem instance.
- *  Returns 1 on failure, 0 otherwise.
+ *  Lays out <code>start</code>, <code>load</code>, <code>routecost</code>
+ *  and <code>nodes</code> one after the other in a single block, taken from
+ *  <code>arena</code> or, if it is NULL, from malloc. Any previous block of
+ *  the solution is released first. All the offsets are set to 0, so every
+ *  route is empty until <code>start</code> is filled in.
  *
- *  @param datfile  The name of the TSPLIB file
- *  @param data     The target BEL_VRPData structure to load data into.
- *  @param verbose  Turns on lots of messages.
- *  @return 1 on failure, 0 otherwise.
+ *  @param sol  The solution to be allocated
+ *  @param nvehicles  The number of routes
+ *  @param nstops The number of customers in all the routes
+ *  @param arena  The arena to allocate from, or NULL
+ *  @return 1 on failure, 0 otherwise
  */
 
-int BEL_VRPReadTSPLIB(char *datfile, BEL_VRPData *data, int verbose)
+int BEL_AllocVRPSolution(BEL_VRPSolution *sol, int nvehicles, int nstops, BEL_Arena *arena)
 {
-	FILE *in;
-	char buffer[256], key[256], field[256];
-	char *p;
-	int norm = -1;
-	int matrixform = MATRIX_LOWER_DIAG_ROW;
-	int ncount = -1;
-	int ndepot = 0;
-	int i, j;
-	
-	if ((in = fopen(datfile, "r")) == NULL)
+	size_t size = ((size_t) 3 * nvehicles + 1 + nstops) * sizeof(int);
+	int *block;
+
+	BEL_FreeVRPSolution(sol);
+	block = (int *) (arena ? BEL_ArenaAlloc(arena, size) : malloc(size));
+	if (!block)
 	{
-		fprintf(stderr, "Cannot open file %s for reading. Aborting\n", datfile);
-		exit(1);
+		fprintf(stderr, "Out of memory allocating a solution of %d routes\n", nvehicles);
+		return 1;
 	}
-	// Read the file line by line
-	while (fgets(buffer, 256, in) != NULL)
+	memset(block, 0, size);
+
+	sol->start = block;
+	sol->load = sol->start + nvehicles + 1;
+	sol->routecost = sol->load + nvehicles;
+	sol->nodes = sol->routecost + nvehicles;
+	sol->nvehicles = nvehicles;
+	sol->nstops = nstops;
+	sol->block = block;
+	sol->blocksize = size;
+	sol->arena = arena;
+	return 0;
+}
+
+/** Copies a BEL_VRPSolution
+ *
+ *  Allocates <code>dst</code> with the size of <code>src</code> and copies
+ *  the whole block with a single memcpy.
+ *
+ *  @param dst  The copy, released first if it holds a solution
+ *  @param src  The solution to be copied
+ *  @param arena  The arena to allocate from, or NULL
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_CloneVRPSolution(BEL_VRPSolution *dst, BEL_VRPSolution *src, BEL_Arena *arena)
+{
+	if (BEL_AllocVRPSolution(dst, src->nvehicles, src->nstops, arena))
+		return 1;
+	if (src->block)
+		memcpy(dst->block, src->block, src->blocksize);
+	dst->cost = src->cost;
+	return 0;
+}
+
+/** Computes the load and the cost of every route of a BEL_VRPSolution
+ *
+ *  Sums the demands of each route into <code>load</code> and its length,
+ *  from the depot through the customers and back, into
+ *  <code>routecost</code>. The total cost of the solution is updated too.
+ *
+ *  @param sol  The solution to be evaluated
+ *  @param data The VRP instance
+ *  @param depot  The depot all the routes start from
+ */
+
+void BEL_EvaluateVRPSolution(BEL_VRPSolution *sol, BEL_VRPData *data, int depot)
+{
+	int i, j, len, prev, *route;
+
+	sol->cost = 0;
+	for (i = 0; i < sol->nvehicles; i++)
 	{
-		p = buffer;
-		while (*p != '\0')
+		route = BEL_Route(sol, i);
+		len = BEL_RouteLen(sol, i);
+		sol->load[i] = 0;
+		sol->routecost[i] = 0;
+		prev = depot;
+		for (j = 0; j < len; j++)
 		{
-			if (*p == ':')
-			{
-				*p = ' ';			
-			}
-			p++;
+			sol->load[i] += data->demand[route[j]];
+			sol->routecost[i] += BEL_Dist(data, prev, route[j]);
+			prev = route[j];
 		}
-		p = buffer;
-		if (sscanf(p, "%s", key) != EOF)
+		if (len > 0)
+			sol->routecost[i] += BEL_Dist(data, prev, depot);
+		sol->cost += sol->routecost[i];
+	}
+}
+
+/** Checks that a BEL_VRPSolution visits every customer once
+ *
+ *  Every customer of the instance must be in exactly one route, and no
+ *  route may hold a depot or a node out of range.
+ *
+ *  @param sol  The solution to be checked
+ *  @param data The VRP instance
+ *  @return 1 if the solution is not valid, 0 otherwise
+ */
+
+int BEL_CheckVRPSolution(BEL_VRPSolution *sol, BEL_VRPData *data)
+{
+	char *seen;
+	int i, node, rval = 0;
+
+	seen = (char *) calloc(data->dimension, sizeof(char));
+	if (!seen)
+	{
+		fprintf(stderr, "Out of memory checking a solution\n");
+		return 1;
+	}
+	for (i = 0; i < sol->start[sol->nvehicles] && !rval; i++)
+	{
+		node = sol->nodes[i];
+		if (node < 0 || node >= data->dimension || data->isadepot[node] || seen[node]++)
 		{
-			p += strlen(key);
-			while (*p == ' ')
-			{
-				p++;
-			}
-			if (!strcmp(key, "NAME"))
-			{
-        /**
-         *  We cannot directly strcpy p over data->name, for it's NULL.
-         *  We have to malloc the room for p and then strcpy it.
-         */
-        free(data->name);
-        data->name = (char *)calloc(strlen(p)-1, sizeof(char));
-        strncpy(data->name, p, strlen(p)-1);
-			}
-			else if (!strcmp(key, "TYPE"))
-			{
-				if (verbose)
-					printf("Problem type: %s", p);
-			}
-			else if (!strcmp(key, "COMMENT"))
-			{
-				if (verbose)
-					printf("%s", p);
-			}
-			else if (!strcmp(key, "DIMENSION"))
-			{
-                if (sscanf (p, "%s", field) == EOF) {
-                    fprintf (stderr, "ERROR in DIMENSION line\n");
-                    return FALSE;
-                }
-                ncount = atoi (field);
-                data->dimension = ncount;
-                if (verbose)
-                	printf ("Number of Nodes: %d\n", data->dimension);
-			}
-			else if (!strcmp(key, "EDGE_WEIGHT_TYPE"))
-			{
-          if (sscanf (p, "%s", field) == EOF) {
-                    fprintf (stderr, "ERROR in EDGE_WEIGHT_TYPE line\n");
-                    return FALSE;
-                }
-                if (!strcmp (field, "EXPLICIT")) {
-                    norm = CC_MATRIXNORM;
-                    if (verbose)
-                    	printf ("Explicit Lengths (CC_MATRIXNORM)\n");
-                } else if (!strcmp (field, "EUC_2D")) {
-                    norm = CC_EUCLIDEAN;
-                    if (verbose)
-                    	printf ("Rounded Euclidean Norm (CC_EUCLIDEAN)\n");
-                } else if (!strcmp (field, "EUC_3D")) {
-                    norm = CC_EUCLIDEAN_3D;
-                    if (verbose)
-                    	printf ("Rounded Euclidean 3D Norm (CC_EUCLIDEAN_3D)\n");
-                } else if (!strcmp (field, "MAX_2D")) {
-                    norm = CC_MAXNORM;
-                    if (verbose)
-                    	printf ("Max Norm (CC_MAXNORM)\n");
-                } else if (!strcmp (field, "MAN_2D")) {
-                    norm = CC_MANNORM;
-                    if (verbose)
-                    	printf ("Max Norm (CC_MAXNORM)\n");
-                } else if (!strcmp (field, "GEO")) {
-                    norm = CC_GEOGRAPHIC;
-                    if (verbose)
-                    	printf ("Geographical Norm (CC_GEOGRAPHIC)\n");
-                } else if (!strcmp (field, "GEOM")) {
-                    norm = CC_GEOM;
-                    if (verbose)
-                    	printf ("Geographical Norm in Meters (CC_GEOM)\n");
-                } else if (!strcmp (field, "ATT")) {
-                    norm = CC_ATT;
-                    if (verbose)
-                    	printf ("ATT Norm (CC_ATT)\n");
-                } else if (!strcmp (field, "CEIL_2D")) {
-                    norm = CC_EUCLIDEAN_CEIL;
-                    if (verbose)
-                    	printf ("Rounded Up Euclidean Norm (CC_EUCLIDEAN_CEIL)\n");
-                } else if (!strcmp (field, "DSJRAND")) {
-                    norm = CC_DSJRANDNORM;
-                    if (verbose)
-                    	printf ("David Johnson Random Norm (CC_DSJRANDNORM)\n");
-                } else {
-                    fprintf (stderr, "ERROR: Not set up for norm %s\n", field);
-                    return FALSE;
-                }
-                if (CCutil_dat_setnorm (data->dat, norm)) {
-                    fprintf (stderr, "ERROR: Couldn't set norm %d\n", norm);
-                    return FALSE;
-                }
-			}
-			else if (!strcmp(key, "EDGE_WEIGHT_FORMAT"))
-			{
-                if (sscanf (p, "%s", field) == EOF) {
-                    fprintf (stderr, "ERROR in EDGE_WEIGHT_FORMAT line\n");
-                    return FALSE;
-                }
-                if (!strcmp (field, "LOWER_DIAG_ROW")) {
-                    matrixform = MATRIX_LOWER_DIAG_ROW;
-                } else if (!strcmp (field, "UPPER_ROW")) {
-                    matrixform = MATRIX_UPPER_ROW;
-                } else if (!strcmp (field, "UPPER_DIAG_ROW")) {
-                    matrixform = MATRIX_UPPER_DIAG_ROW;
-                } else if (!strcmp (field, "FULL_MATRIX")) {
-                    matrixform = MATRIX_FULL_MATRIX;
-                } else if (strcmp (field, "FUNCTION")) {
-                    fprintf (stderr, "Cannot handle format: %s\n", field);
-                    return FALSE;
-                }
-			}
-			else if (!strcmp(key, "NODE_COORD_SECTION"))
-			{
-                if (ncount <= 0) {
-                    fprintf (stderr, "ERROR: Dimension not specified\n");
-                    return FALSE;
-                }
-                if (data->dat->x != (double *) NULL) {
-                    fprintf (stderr, "ERROR: A second NODE_COORD_SECTION?\n");
-                    BEL_FreeVRPData(data);
-                    return FALSE;
-                }
-                if ((norm & CC_NORM_SIZE_BITS) == CC_D2_NORM_SIZE) {
-                    data->dat->x = CC_SAFE_MALLOC (ncount, double);
-                    if (!data->dat->x) {
-                        BEL_FreeVRPData(data);
-                        return FALSE;
-                    }
-                    data->dat->y = CC_SAFE_MALLOC (ncount, double);
-                    if (!data->dat->y) {
-                        BEL_FreeVRPData(data);
-                        return FALSE;
-                    }
-                    for (i = 0; i < ncount; i++) {
-                        fscanf (in, "%*d %lf %lf", &(data->dat->x[i]), &(data->dat->y[i]));
-                    }
-                } else if ((norm & CC_NORM_SIZE_BITS) == CC_D3_NORM_SIZE) {
-                    data->dat->x = CC_SAFE_MALLOC (ncount, double);
-                    if (!data->dat->x) {
-                        BEL_FreeVRPData(data);
-                        return FALSE;
-                    }
-                    data->dat->y = CC_SAFE_MALLOC (ncount, double);
-                    if (!data->dat->y) {
-                        BEL_FreeVRPData(data);
-                        return FALSE;
-                    }
-                    data->dat->z = CC_SAFE_MALLOC (ncount, double);
-                    if (!data->dat->z) {
-                        BEL_FreeVRPData(data);
-                        return FALSE;
-                    }
-                    for (i = 0; i < ncount; i++) {
-                        fscanf (in, "%*d %lf %lf %lf",
-                               &(data->dat->x[i]), &(data->dat->y[i]), &(data->dat->z[i]));
-                    }
-                } else {
-                    fprintf (stderr, "ERROR: Node coordinates with norm %d?\n",
-                                 norm);
-                    return FALSE;
-                }
-			}
-			else if (!strcmp(key, "EDGE_WEIGHT_SECTION"))
-			{
-	                if (ncount <= 0) {
-	                    fprintf (stderr, "ERROR: Dimension not specified\n");
-                     return FALSE;
-	                }
-	                if (data->dat->adj != (int **) NULL) {
-	                    fprintf (stderr, "ERROR: A second NODE_COORD_SECTION?\n");
-	                    CCutil_freedatagroup (data->dat);
-                     return FALSE;
-	                }
-	                if ((norm & CC_NORM_SIZE_BITS) == CC_MATRIX_NORM_SIZE) {
-	                    data->dat->adj = CC_SAFE_MALLOC (ncount, int *);
-	                    data->dat->adjspace = CC_SAFE_MALLOC (ncount*(ncount+1)/2,
-	                                                    int);
-	                    if (data->dat->adj == (int **) NULL ||
-	                        data->dat->adjspace == (int *) NULL) {
-	                        CCutil_freedatagroup (data->dat);
-                         return FALSE;
-	                    }
-	                    for (i = 0, j = 0; i < ncount; i++) {
-	                        data->dat->adj[i] = data->dat->adjspace + j;
-	                        j += (i+1);
-	                    }
-	                    if (matrixform == MATRIX_LOWER_DIAG_ROW) {
-	                        for (i = 0; i < ncount; i++) {
-	                            for (j = 0; j <= i; j++)
-	                                fscanf (in, "%d", &(data->dat->adj[i][j]));
-	                        }
-	                    } else if (matrixform == MATRIX_UPPER_ROW ||
-	                               matrixform == MATRIX_UPPER_DIAG_ROW ||
-	                               matrixform == MATRIX_FULL_MATRIX) {
-	                        int **tempadj = (int **) NULL;
-	                        int *tempadjspace = (int *) NULL;
-	                        tempadj = CC_SAFE_MALLOC (ncount, int *);
-	                        tempadjspace = CC_SAFE_MALLOC (ncount * ncount,
-	                                                       int);
-	                        if (tempadj == (int **) NULL ||
-	                            tempadjspace == (int *) NULL) {
-	                            CC_IFFREE (tempadj, int *);
-	                            CC_IFFREE (tempadjspace, int);
-	                            CCutil_freedatagroup (data->dat);
-                             return FALSE;
-	                        }
-	                        for (i = 0; i < ncount; i++) {
-	                            tempadj[i] = tempadjspace + i * ncount;
-	                            if (matrixform == MATRIX_UPPER_ROW) {
-	                                tempadj[i][i] = 0;
-	                                for (j = i + 1; j < ncount; j++)
-	                                    fscanf (in, "%d", &(tempadj[i][j]));
-	                            } else if (matrixform == MATRIX_UPPER_DIAG_ROW) {
-	                                for (j = i; j < ncount; j++)
-	                                    fscanf (in, "%d", &(tempadj[i][j]));
-	                            } else {
-	                                for (j = 0; j < ncount; j++)
-	                                    fscanf (in, "%d", &(tempadj[i][j]));
-	                            }
-	                        }
-	                        for (i = 0; i < ncount; i++) {
-	                            for (j = 0; j <= i; j++)
-	                                data->dat->adj[i][j] = tempadj[j][i];
-	                        }
-	                        CC_FREE (tempadjspace, int);
-	                        CC_FREE (tempadj, int *);
-	                    }
-	                } else {
-	                    fprintf (stderr, "ERROR: Matrix with norm %d?\n",
-	                             norm);
-                     return FALSE;
-	                }
-			}
-			else if (!strcmp(key, "FIXED_EDGES_SECTION"))
-			{
-                fprintf (stderr, "ERROR: Not set up for fixed edges\n");
-                return FALSE;
-			}
-			else if (!strcmp(key, "CAPACITY"))
-			{
-                if (sscanf (p, "%s", field) == EOF) {
-                    fprintf (stderr, "ERROR in DIMENSION line\n");
-                    return FALSE;
-                }
-                data->capacity = atoi (field);
-                if (verbose)
-                	printf ("Vehicle capacity: %d\n", data->capacity);
-			}
-			else if (!strcmp(key, "DEMAND_SECTION"))
-			{
-				int demand;
-                if (ncount <= 0) {
-                    fprintf (stderr, "ERROR: Dimension not specified\n");
-                    return FALSE;
-                }
-                if (data->demand != (int *) NULL) {
-                    fprintf (stderr, "ERROR: A second DEMAND_SECTION?\n");
-                    BEL_FreeVRPData(data);
-                    return FALSE;
-                }
-                data->demand = CC_SAFE_MALLOC (ncount, int);
-                if (!data->demand) {
-                    BEL_FreeVRPData(data);
-                    return FALSE;
-                }
-                for (i = 0; i < ncount; i++) {
-                    fscanf (in, "%d %d", &j, &demand);
-                    if (i != j - 1)
-                    {
-                      fprintf (stderr, "ERROR: Malformed DEMAND_SECTION. Found %d, expecting %d.\n", j - 1, i);
-                      BEL_FreeVRPData(data);
-                      return FALSE;
-                    }
-                    if (demand == 0)
-                    {
-                      // This entry is a depot
-                      ndepot++;
-                    }
-                    data->demand[i] = demand;
-                }
-                data->ncustomers = data->dimension - ndepot;
-                data->ndepots = ndepot;
-			}
-			else if (!strcmp(key, "DEPOT_SECTION"))
-			{
-             	int dep;
-                if (ncount <= 0) {
-                    fprintf (stderr, "ERROR: Dimension not specified\n");
-                    return FALSE;
-                }
-                if (!data->demand) {
-                    fprintf (stderr, "ERROR: Missing DEMAND_SECTION?\n");
-                    BEL_FreeVRPData(data);
-                    return FALSE;
-                }
-                if (data->depots != (int *) NULL) {
-                    fprintf (stderr, "ERROR: A second DEPOT_SECTION?\n");
-                    BEL_FreeVRPData(data);
-                    return FALSE;
-                }
-                data->isadepot = CC_SAFE_MALLOC (ncount, int);
-                if (!data->isadepot) {
-                    BEL_FreeVRPData(data);
-                    return FALSE;
-                }
-								data->depots = CC_SAFE_MALLOC (ndepot, int);
-                if (!data->depots) {
-                    BEL_FreeVRPData(data);
-                    return FALSE;
-                }
-                int k = 0;
-                do {
-                    fscanf (in, "%d", &dep);
-                    if (dep != -1)
-                    {
-											// Assign 1 to identify this node as a depot
-											data->isadepot[dep - 1] = 1;
-											
-											// Put this node in the depots list
-											data->depots[k++] = dep - 1;
-                    }
-                } while (dep != -1);
-			}
+			fprintf(stderr, "Node %d is not a customer, or is visited twice\n", node);
+			rval = 1;
 		}
 	}
-	fclose(in);
-
-#ifdef DEBUG
-		for (i = 0; i < ncount; i++)
+	for (i = 0; i < data->dimension && !rval; i++)
+	{
+		if (!data->isadepot[i] && !seen[i])
 		{
-			printf("Coordinates: %.4lf, %.4lf, Demand: %d, Depot: %d\n", data->dat->x[i], data->dat->y[i], data->demand[i], data->isadepot[i]);
+			fprintf(stderr, "Customer %d is not visited\n", i);
+			rval = 1;
 		}
-#endif
-
-	return 0;
+	}
+	free(seen);
+	return rval;
 }
 
 /** Writes a VRP instance to a file in standard TSPLIB format.
@@ -566,116 +354,6 @@ int BEL_VRPWriteTSPLIB(char *datfile, BEL_VRPData *data)
   fclose(out);
 }
 
-/** Reads a VRP solution from file in standard tourfile format.
- *
- *  Reads VRP solution from file and returns a BEL_VRPSolution structure
- *  that holds the vehicle routes and the cost of the given solution.
- *
- *  @param datfile  The name of the input tourfile.
- *  @param solution The BEL_VRPSolution structure to be filled with tour data.
- *  @param nodes  The number of nodes in this VRP instance.
- *  @param verbose  Turns on lots of messages.
- *  @return 1 on failure, 0 otherwise.
- */
-
-int BEL_VRPReadSolution(char *datfile, BEL_VRPSolution *solution, int nodes, int verbose)
-{
-	FILE *in;
-	char buffer[256], key[256], field[256];
-	char *p;
-	int nvehicles = 0;
-	int cost = 0;
-  int routelist[nodes][nodes];
-
-	if ((in = fopen(datfile, "r")) == NULL)
-	{
-		fprintf(stderr, "Cannot open file %s for reading. Aborting\n", datfile);
-		exit(1);
-	}
-	// Read the file line by line
-	while (fgets(buffer, 256, in) != NULL)
-	{
-		p = buffer;
-		while (*p != '\0')
-		{
-			if (*p == ':')
-			{
-				*p = ' ';
-			}
-			p++;
-		}
-		p = buffer;
-		if (sscanf(p, "%s", key) != EOF)
-		{
-			p += strlen(key);
-			while (*p == ' ')
-			{
-				p++;
-			}
-			if (!strcmp(key, "cost"))
-			{
-                if (sscanf (p, "%s", field) == EOF) {
-                    fprintf (stderr, "ERROR in COST line\n");
-                    return 1;
-                }
-                cost = atoi (field);
-                solution->cost = cost;
-                if (verbose)
-                  printf ("Cost: %d\n", solution->cost);
-			}
-			else if (!strcmp(key, "Route"))
-			{
-        int i = 1;
-        if (sscanf (p, "#%s", field) != EOF)
-        {
-          fflush(stdout);
-          int r = atoi(field);
-          if (r != nvehicles + 1)
-          {
-            fprintf (stderr, "ERROR in Route line\n");
-            return 1;
-          }
-          p += strlen(field) + 1;
-			    while (*p == ' ')
-			    {
-				    p++;
-			    }
-        }
-        while(sscanf (p, "%s", field) != EOF)
-        {
-          routelist[nvehicles][i++] = atoi(field);
-#ifdef DEBUG
-          printf("routelist[%d][%d] = %d\n", nvehicles, i - 1, atoi(field));
-#endif
-          p += strlen(field);
-			    while (*p == ' ')
-			    {
-				    p++;
-			    }
-        }
-        routelist[nvehicles][0] = i - 1; // Hack to know how long it is
-        nvehicles++;
-			}
-		}
-	}
-	fclose(in);
-	int i, j, routelen;
-	solution->nvehicles = nvehicles;
-	solution->routes = (int **)calloc(nvehicles, sizeof(int *));
-	solution->routelen = (int *)calloc(nvehicles, sizeof(int *));
-	for (i = 0; i < nvehicles; i++)
-	{
-    routelen = routelist[i][0];
-    solution->routelen[i] = routelen;
-		solution->routes[i] = (int *)calloc(routelen, sizeof(int));
-		for (j = 0; j < routelen; j++)
-		{
-      solution->routes[i][j] = routelist[i][j + 1];
-    }
-	}
-  return 0;
-}
-
 /** Flushes a matrix of integers to standard output for debug.
  *
  *  A commodity function to debug integer matrices used throughout the program.
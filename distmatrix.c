@@ -0,0 +1,284 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  distmatrix.c
+ *
+ *  Precomputed distance matrix for Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <math.h>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* Concorde doesn't fuse multiply and add, neither must we */
+#pragma GCC optimize ("fp-contract=off")
+
+/**
+ *  Vector primitives. The kernels below are written once in terms of these,
+ *  and compiled for the widest instruction set available. All the arithmetic
+ *  is done in double precision with the same operations as the scalar code,
+ *  so both give exactly the lengths computed by Concorde.
+ */
+
+#if defined(__AVX512F__)
+
+#define VLEN 8
+typedef __m512d vdouble;
+#define vset1(a)		_mm512_set1_pd(a)
+#define vload(p)		_mm512_loadu_pd(p)
+#define vadd(a, b)	_mm512_add_pd(a, b)
+#define vsub(a, b)	_mm512_sub_pd(a, b)
+#define vmul(a, b)	_mm512_mul_pd(a, b)
+#define vdiv(a, b)	_mm512_div_pd(a, b)
+#define vmax(a, b)	_mm512_max_pd(a, b)
+#define vsqrt(a)		_mm512_sqrt_pd(a)
+#define vabs(a)			_mm512_abs_pd(a)
+#define vtrunc(a)		_mm512_roundscale_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define vceil(a)		_mm512_roundscale_pd(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC)
+#define vstore_int(p, a)	_mm256_storeu_si256((__m256i *) (p), _mm512_cvttpd_epi32(a))
+
+/* r + 1 where a - r > eps, r elsewhere */
+static inline vdouble vbump(vdouble a, vdouble r, double eps)
+{
+	return _mm512_mask_add_pd(r, _mm512_cmp_pd_mask(vsub(a, r), vset1(eps), _CMP_GT_OQ),
+		r, vset1(1.0));
+}
+
+#elif defined(__AVX2__)
+
+#define VLEN 4
+typedef __m256d vdouble;
+#define vset1(a)		_mm256_set1_pd(a)
+#define vload(p)		_mm256_loadu_pd(p)
+#define vadd(a, b)	_mm256_add_pd(a, b)
+#define vsub(a, b)	_mm256_sub_pd(a, b)
+#define vmul(a, b)	_mm256_mul_pd(a, b)
+#define vdiv(a, b)	_mm256_div_pd(a, b)
+#define vmax(a, b)	_mm256_max_pd(a, b)
+#define vsqrt(a)		_mm256_sqrt_pd(a)
+#define vabs(a)			_mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define vtrunc(a)		_mm256_round_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define vceil(a)		_mm256_round_pd(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC)
+#define vstore_int(p, a)	_mm_storeu_si128((__m128i *) (p), _mm256_cvttpd_epi32(a))
+
+/* r + 1 where a - r > eps, r elsewhere */
+static inline vdouble vbump(vdouble a, vdouble r, double eps)
+{
+	return vadd(r, _mm256_and_pd(_mm256_cmp_pd(vsub(a, r), vset1(eps), _CMP_GT_OQ),
+		vset1(1.0)));
+}
+
+#endif
+
+/**
+ *  Defines the function <code>name</code>, that fills row i of the lower
+ *  triangle, that is the lengths from node i to nodes 0...i. SLEN and VLENGTH
+ *  compute the length from the coordinate differences dx and dy, as a double
+ *  that is truncated to int. The vector loop is left out if no vector
+ *  instruction set is available.
+ */
+
+#ifdef VLEN
+#define ROW_KERNEL(name, SLEN, VLENGTH) \
+static void name(const double *x, const double *y, int i, int *row) \
+{ \
+	int j = 0; \
+	vdouble xi = vset1(x[i]), yi = vset1(y[i]); \
+	for (; j + VLEN <= i + 1; j += VLEN) \
+	{ \
+		vdouble dx = vsub(xi, vload(x + j)); \
+		vdouble dy = vsub(yi, vload(y + j)); \
+		vstore_int(row + j, VLENGTH); \
+	} \
+	for (; j <= i; j++) \
+	{ \
+		double dx = x[i] - x[j], dy = y[i] - y[j]; \
+		row[j] = (int) (SLEN); \
+	} \
+}
+#else
+#define ROW_KERNEL(name, SLEN, VLENGTH) \
+static void name(const double *x, const double *y, int i, int *row) \
+{ \
+	int j; \
+	for (j = 0; j <= i; j++) \
+	{ \
+		double dx = x[i] - x[j], dy = y[i] - y[j]; \
+		row[j] = (int) (SLEN); \
+	} \
+}
+#endif
+
+/* Scalar helpers for the norms with a rounding step */
+static inline double ceil_eps(double d)
+{
+	double r = (double) (int) d;
+	return ((d - r) > 0.000000001 ? r + 1.0 : r);
+}
+
+/* EUC_2D: nint(sqrt(dx^2 + dy^2)) */
+ROW_KERNEL(euclid_row,
+	sqrt(dx * dx + dy * dy) + 0.5,
+	vadd(vsqrt(vadd(vmul(dx, dx), vmul(dy, dy))), vset1(0.5)))
+
+/* CEIL_2D: sqrt(dx^2 + dy^2) rounded up, as Concorde does */
+ROW_KERNEL(euclid_ceil_row,
+	ceil_eps(sqrt(dx * dx + dy * dy)),
+	vbump(vsqrt(vadd(vmul(dx, dx), vmul(dy, dy))),
+		vtrunc(vsqrt(vadd(vmul(dx, dx), vmul(dy, dy)))), 0.000000001))
+
+/* ATT: pseudo-Euclidean distance, sqrt((dx^2 + dy^2) / 10) rounded up */
+ROW_KERNEL(att_row,
+	ceil(sqrt((dx * dx + dy * dy) / 10.0)),
+	vceil(vsqrt(vdiv(vadd(vmul(dx, dx), vmul(dy, dy)), vset1(10.0)))))
+
+/* MAN_2D: nint(|dx| + |dy|) */
+ROW_KERNEL(man_row,
+	fabs(dx) + fabs(dy) + 0.5,
+	vadd(vadd(vabs(dx), vabs(dy)), vset1(0.5)))
+
+/* MAX_2D: nint(max(|dx|, |dy|)) */
+ROW_KERNEL(max_row,
+	(fabs(dx) > fabs(dy) ? fabs(dx) : fabs(dy)) + 0.5,
+	vadd(vmax(vabs(dx), vabs(dy)), vset1(0.5)))
+
+/**
+ *  GEO: great circle distance on the idealized earth. Latitude and longitude
+ *  are converted to radians once per node, the row only needs the cosines.
+ *  The trigonometry has no vector counterpart in the instruction set, so
+ *  this one is scalar.
+ */
+
+static void geo_row(const double *lat, const double *lon, int i, int *row)
+{
+	int j;
+	double q1, q2, q3;
+
+	for (j = 0; j <= i; j++)
+	{
+		q1 = cos(lon[i] - lon[j]);
+		q2 = cos(lat[i] - lat[j]);
+		q3 = cos(lat[i] + lat[j]);
+		row[j] = (int) (6378.388 * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+	}
+}
+
+/**
+ *  Converts a TSPLIB GEO coordinate (DDD.MM, degrees and minutes) to radians.
+ */
+
+static double geo_radians(double x)
+{
+	double deg = (double) (int) x;
+	return M_PI * (deg + 5.0 * (x - deg) / 3.0) / 180.0;
+}
+
+/** Builds the distance matrix of a VRP instance
+ *
+ *  Computes the length of every edge once and stores it in
+ *  <code>data->dist</code>, a packed lower triangle of
+ *  <code>n(n+1)/2</code> integers (see BEL_Dist). The norms EUC_2D, CEIL_2D,
+ *  ATT, MAN_2D and MAX_2D are computed by vector kernels, GEO from per node
+ *  radians, every other norm through the edgelen function of Concorde.
+ *  Instances larger than BEL_DISTMATRIX_MAXNODES are left without a matrix,
+ *  and BEL_Dist falls back to edgelen. The same happens if there is not
+ *  enough memory, so the function never fails.
+ *
+ *  @param data The VRP instance
+ *  @param verbose Be verbose
+ *  @return 0
+ */
+
+int BEL_BuildDistMatrix(BEL_VRPData *data, int verbose)
+{
+	int n = data->dimension;
+	int i, j;
+	int *row;
+	double *lat = (double *) NULL;
+	double *lon = (double *) NULL;
+	double szeit = CCutil_zeit();
+	void (*kernel)(const double *, const double *, int, int *) = NULL;
+
+	CC_IFFREE(data->dist, int);
+	if (n > BEL_DISTMATRIX_MAXNODES)
+	{
+		if (verbose)
+			printf("Instance too large for a distance matrix, computing edges on demand\n");
+		return 0;
+	}
+
+	data->dist = CC_SAFE_MALLOC((size_t) n * (n + 1) / 2, int);
+	if (!data->dist)
+	{
+		fprintf(stderr, "Out of memory for the distance matrix, computing edges on demand\n");
+		return 0;
+	}
+
+	switch (data->dat->norm)
+	{
+		case CC_EUCLIDEAN:			kernel = euclid_row; break;
+		case CC_EUCLIDEAN_CEIL:	kernel = euclid_ceil_row; break;
+		case CC_ATT:						kernel = att_row; break;
+		case CC_MANNORM:				kernel = man_row; break;
+		case CC_MAXNORM:				kernel = max_row; break;
+		case CC_GEOGRAPHIC:
+			lat = CC_SAFE_MALLOC(n, double);
+			lon = CC_SAFE_MALLOC(n, double);
+			if (!lat || !lon)
+			{
+				// Not worth failing for, edgelen does the same
+				CC_IFFREE(lat, double);
+				CC_IFFREE(lon, double);
+				break;
+			}
+			for (i = 0; i < n; i++)
+			{
+				lat[i] = geo_radians(data->dat->x[i]);
+				lon[i] = geo_radians(data->dat->y[i]);
+			}
+			break;
+		default:
+			break;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		row = data->dist + (size_t) i * (i + 1) / 2;
+		if (kernel)
+			kernel(data->dat->x, data->dat->y, i, row);
+		else if (lat)
+			geo_row(lat, lon, i, row);
+		else
+		{
+			for (j = 0; j <= i; j++)
+				row[j] = (data->dat->edgelen)(i, j, data->dat);
+		}
+	}
+
+	CC_IFFREE(lat, double);
+	CC_IFFREE(lon, double);
+	if (verbose)
+		printf("Distance matrix of %d nodes built in %.2f seconds\n", n, CCutil_zeit() - szeit);
+	return 0;
+}
@@ -258,7 +258,7 @@ void BEL_PrintSVG(BEL_VRPData *data, BEL_VRPSolution *solution)
   float stroke_width = (float) STROKE_WIDTH,
       	node_radius = (float) NODE_RADIUS,
       	scale = 1;
-  int i, j, routes, dimension, routelen;
+  int i, j, routes, dimension, routelen, *route;
 
   dimension = data->dimension;
   for (i = 0; i < dimension; i++)
@@ -342,7 +342,8 @@ void BEL_PrintSVG(BEL_VRPData *data, BEL_VRPSolution *solution)
     printf("Found %d routes\n", routes);
   for (i = 0; i < routes; i++)
   {
-    routelen = solution->routelen[i];
+    routelen = BEL_RouteLen(solution, i);
+    route = BEL_Route(solution, i);
     if (verbose)
       printf("Route #%d has length %d\n", i, routelen);
   	int red = (rand() % 0xff);
@@ -352,7 +353,7 @@ void BEL_PrintSVG(BEL_VRPData *data, BEL_VRPSolution *solution)
   	fprintf(svgfile, "<!-- Route #%d:", i);
     for (j = 0; j < routelen; j++)
     {
-	    fprintf(svgfile, " %d", solution->routes[i][j]);
+	    fprintf(svgfile, " %d", route[j]);
 	   }
     fprintf(svgfile, " -->\n");
     fprintf(svgfile, "<path d=\"M%d %d\n",
@@ -361,8 +362,8 @@ void BEL_PrintSVG(BEL_VRPData *data, BEL_VRPSolution *solution)
     for (j = 0; j < routelen; j++)
     {
 	    fprintf(svgfile, "L%d %d\n",
-    	        (int)data->dat->x[solution->routes[i][j]],
-        	    (int)data->dat->y[solution->routes[i][j]]);
+    	        (int)data->dat->x[route[j]],
+        	    (int)data->dat->y[route[j]]);
 	}
 	fprintf(svgfile, "Z\" style=\"fill:none;stroke:#%0.2x%0.2x%0.2x;stroke-width:%f\"/>\n",
 			red,
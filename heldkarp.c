@@ -0,0 +1,224 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  heldkarp.c
+ *
+ *  Held-Karp dynamic programming TSP solver for the small routes of
+ *  Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#define HK_INFINITY 0x3fffffff //!< Cost of an unreachable state. Twice this still fits an int.
+
+/**
+ *  Computes <code>min<sub>k</sub> (a<sub>k</sub> + b<sub>k</sub>)</code> over
+ *  two rows of <code>len</code> integers. <code>len</code> must be a multiple
+ *  of 8. This is the innermost loop of the dynamic program.
+ */
+
+static int min_plus(const int *a, const int *b, int len)
+{
+	int k, best;
+#if defined(__AVX2__)
+	__m256i m = _mm256_set1_epi32(HK_INFINITY);
+	__m128i h;
+
+	for (k = 0; k < len; k += 8)
+	{
+		m = _mm256_min_epi32(m, _mm256_add_epi32(
+			_mm256_loadu_si256((const __m256i *) (a + k)),
+			_mm256_loadu_si256((const __m256i *) (b + k))));
+	}
+	h = _mm_min_epi32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+	h = _mm_min_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+	h = _mm_min_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+	best = _mm_cvtsi128_si32(h);
+#elif defined(__SSE4_1__)
+	__m128i m = _mm_set1_epi32(HK_INFINITY);
+
+	for (k = 0; k < len; k += 4)
+	{
+		m = _mm_min_epi32(m, _mm_add_epi32(
+			_mm_loadu_si128((const __m128i *) (a + k)),
+			_mm_loadu_si128((const __m128i *) (b + k))));
+	}
+	m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+	m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+	best = _mm_cvtsi128_si32(m);
+#else
+	best = HK_INFINITY;
+	for (k = 0; k < len; k++)
+	{
+		if (a[k] + b[k] < best)
+			best = a[k] + b[k];
+	}
+#endif
+	return best;
+}
+
+/** Solves a small TSP instance to optimality with the Held-Karp dynamic program
+ *
+ *  Node 0 is taken as the start of the tour. For every subset S of the other
+ *  nodes and every node j in S, the program computes the length of the
+ *  shortest path that leaves node 0, visits all of S and ends in j:
+ *
+ *  <code>f(S, j) = min<sub>k in S\{j}</sub> f(S\{j}, k) + d<sub>kj</sub></code>
+ *
+ *  The table is laid out with one row of predecessors per subset, padded to
+ *  a multiple of 8 entries, so the minimum over k is a vectorized reduction
+ *  over two contiguous rows (the table row and a row of the transposed
+ *  distance matrix). The tour is recovered by walking the table backwards,
+ *  therefore no predecessor table is stored. Time is O(2<sup>n</sup>n<sup>2</sup>)
+ *  and memory is O(2<sup>n</sup>n), so it is meant for n up to about 16.
+ *
+ *  @param ncount Number of nodes in the tour
+ *  @param dat  TSP instance data
+ *  @param tour The optimal tour, as a list of ncount nodes
+ *  @param val  If not NULL, the length of the optimal tour
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_HeldKarpSolve(int ncount, CCdatagroup *dat, int *tour, int *val)
+{
+	int m = ncount - 1;
+	int stride = (m + 7) & ~7;
+	int full, S, prev, i, j, k, cur, best, bestj, maxd;
+	int *dist = (int *) NULL;
+	int *f = (int *) NULL;
+
+	if (ncount < 1 || ncount > BEL_HK_MAXNODES)
+	{
+		fprintf(stderr, "BEL_HeldKarpSolve: can't handle %d nodes\n", ncount);
+		return 1;
+	}
+	if (ncount <= 3)
+	{
+		for (i = 0; i < ncount; i++)
+			tour[i] = i;
+		if (val)
+		{
+			*val = 0;
+			for (i = 0; i < ncount; i++)
+				*val += CCutil_dat_edgelen(i, (i + 1) % ncount, dat);
+		}
+		return 0;
+	}
+
+	/**
+	 *  dist[j * stride + k] is the length of edge (k, j) among the customers
+	 *  1...m, renumbered 0...m-1. Padding entries are 0 in dist and infinite
+	 *  in f, so they never win the minimum.
+	 */
+
+	full = (1 << m) - 1;
+	dist = CC_SAFE_MALLOC(m * stride, int);
+	f = CC_SAFE_MALLOC((full + 1) * stride, int);
+	if (!dist || !f)
+	{
+		fprintf(stderr, "BEL_HeldKarpSolve: out of memory\n");
+		CC_IFFREE(dist, int);
+		CC_IFFREE(f, int);
+		return 1;
+	}
+
+	maxd = 0;
+	for (j = 0; j < m; j++)
+	{
+		for (k = 0; k < stride; k++)
+		{
+			dist[j * stride + k] = (k < m ? CCutil_dat_edgelen(k + 1, j + 1, dat) : 0);
+			if (dist[j * stride + k] > maxd)
+				maxd = dist[j * stride + k];
+		}
+		if (CCutil_dat_edgelen(0, j + 1, dat) > maxd)
+			maxd = CCutil_dat_edgelen(0, j + 1, dat);
+	}
+	if (maxd >= HK_INFINITY / ncount)
+	{
+		fprintf(stderr, "BEL_HeldKarpSolve: edge lengths too large\n");
+		CC_FREE(dist, int);
+		CC_FREE(f, int);
+		return 1;
+	}
+
+	for (i = 0; i < (full + 1) * stride; i++)
+		f[i] = HK_INFINITY;
+	for (j = 0; j < m; j++)
+		f[(1 << j) * stride + j] = CCutil_dat_edgelen(0, j + 1, dat);
+
+	// Subsets in increasing order, so S\{j} is always done before S
+	for (S = 1; S <= full; S++)
+	{
+		if (!(S & (S - 1)))
+			continue;
+		for (j = 0; j < m; j++)
+		{
+			if (!(S & (1 << j)))
+				continue;
+			prev = S & ~(1 << j);
+			f[S * stride + j] = min_plus(f + prev * stride, dist + j * stride, stride);
+		}
+	}
+
+	// Close the tour back to node 0
+	best = HK_INFINITY;
+	bestj = 0;
+	for (j = 0; j < m; j++)
+	{
+		if (f[full * stride + j] + CCutil_dat_edgelen(j + 1, 0, dat) < best)
+		{
+			best = f[full * stride + j] + CCutil_dat_edgelen(j + 1, 0, dat);
+			bestj = j;
+		}
+	}
+	if (val)
+		*val = best;
+
+	// Walk the table backwards, from the last node to the first one
+	tour[0] = 0;
+	cur = bestj;
+	S = full;
+	for (i = m; i >= 1; i--)
+	{
+		tour[i] = cur + 1;
+		prev = S & ~(1 << cur);
+		if (!prev)
+			break;
+		for (k = 0; k < m; k++)
+		{
+			if ((prev & (1 << k)) &&
+				f[prev * stride + k] + dist[cur * stride + k] == f[S * stride + cur])
+				break;
+		}
+		S = prev;
+		cur = k;
+	}
+
+	CC_FREE(dist, int);
+	CC_FREE(f, int);
+	return 0;
+}
@@ -0,0 +1,504 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  lagrangian.c
+ *
+ *  Lagrangian relaxation heuristic for the Capacitated Concentrator Location
+ *  Problem of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <math.h>
+#include <string.h>
+
+#define LAGR_MAXIT 500						//!< Maximum number of subgradient iterations.
+#define LAGR_STALL 20							//!< Iterations without improvement before halving the step.
+#define LAGR_DPCELLS (1 << 24)		//!< Largest knapsack table solved exactly.
+
+/**
+ *  A (key, index) pair, to sort indexes by a double key.
+ */
+
+typedef struct lagr_key {
+	double key;
+	int idx;
+} lagr_key;
+
+/**
+ *  qsort comparator for lagr_key: ascending key, ties broken by index.
+ */
+
+static int key_cmp(const void *a, const void *b)
+{
+	const lagr_key *x = (const lagr_key *) a, *y = (const lagr_key *) b;
+
+	if (x->key != y->key)
+		return (x->key < y->key ? -1 : 1);
+	return x->idx - y->idx;
+}
+
+static int gcd(int a, int b)
+{
+	while (b)
+	{
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/**
+ *  Solves the 0-1 knapsack of a seed: picks the items with the largest total
+ *  profit that fit in cap. Items with no profit are never picked. If the
+ *  table is small enough the knapsack is solved exactly by dynamic
+ *  programming, otherwise items are picked greedily by profit per unit of
+ *  weight. Either way the returned value is an upper bound on the best
+ *  profit (the optimum, or the bound of the fractional knapsack), so that
+ *  the Lagrangian bound stays valid.
+ *
+ *  @param n Number of items
+ *  @param profit Profit of each item
+ *  @param w Weight of each item
+ *  @param cap Capacity
+ *  @param x Set to 1 for the items picked, 0 otherwise
+ *  @param dp Work array of cap + 1 doubles
+ *  @param keep Work array of n * (cap + 1) chars, NULL to solve greedily
+ *  @param keys Work array of n keys
+ *  @return An upper bound on the profit of the best packing
+ */
+
+static double knapsack(int n, double *profit, int *w, int cap, char *x, double *dp,
+	char *keep, lagr_key *keys)
+{
+	int t, c, k, left;
+	double bound;
+
+	memset(x, 0, n);
+	if (keep)
+	{
+		for (c = 0; c <= cap; c++)
+			dp[c] = 0.0;
+		for (t = 0; t < n; t++)
+		{
+			char *row = keep + (size_t) t * (cap + 1);
+
+			memset(row, 0, cap + 1);
+			if (profit[t] <= 0.0 || w[t] > cap)
+				continue;
+			for (c = cap; c >= w[t]; c--)
+			{
+				if (dp[c - w[t]] + profit[t] > dp[c])
+				{
+					dp[c] = dp[c - w[t]] + profit[t];
+					row[c] = 1;
+				}
+			}
+		}
+		for (t = n - 1, c = cap; t >= 0; t--)
+		{
+			if (keep[(size_t) t * (cap + 1) + c])
+			{
+				x[t] = 1;
+				c -= w[t];
+			}
+		}
+		return dp[cap];
+	}
+
+	// Greedy by profit per unit of weight, bounded by the fractional knapsack
+	for (t = 0, k = 0; t < n; t++)
+	{
+		if (profit[t] <= 0.0 || w[t] > cap)
+			continue;
+		keys[k].key = (w[t] ? -profit[t] / w[t] : -HUGE_VAL);
+		keys[k].idx = t;
+		k++;
+	}
+	qsort(keys, k, sizeof(lagr_key), key_cmp);
+	bound = 0.0;
+	for (t = 0, left = cap; t < k; t++)
+	{
+		int i = keys[t].idx;
+
+		if (w[i] <= left)
+		{
+			x[i] = 1;
+			left -= w[i];
+			bound += profit[i];
+		}
+		else if (left > 0)
+		{
+			// The fractional knapsack would fill the rest with this one
+			bound += profit[i] * left / w[i];
+			left = 0;
+		}
+	}
+	return bound;
+}
+
+/**
+ *  Builds a feasible assignment from the seeds chosen by the relaxation.
+ *  Every chosen seed serves itself, then the items are placed by decreasing
+ *  weight, each on the seed the relaxation picked it for if it fits, or on
+ *  the cheapest chosen candidate seed with room. A final pass moves items to
+ *  cheaper seeds with room.
+ *
+ *  @return The cost of the assignment, or -1 if some item didn't fit
+ */
+
+static double repair(int items, int start[], int cand[], int cost[], int weight[],
+	int seed_cost[], int capacity, char *chosen, int *lagr_pair, int *byweight,
+	int *load, int *assign)
+{
+	int i, j, p, q, best;
+	double total = 0.0;
+
+	for (j = 0; j < items; j++)
+	{
+		load[j] = 0;
+		assign[j] = -1;
+	}
+	for (j = 0; j < items; j++)
+	{
+		if (!chosen[j])
+			continue;
+		for (p = start[j]; p < start[j + 1] && cand[p] != j; p++)
+			;
+		if (p == start[j + 1] || weight[j] > capacity)
+			return -1;
+		assign[j] = p;
+		load[j] += weight[j];
+	}
+	for (q = 0; q < items; q++)
+	{
+		i = byweight[q];
+		if (assign[i] >= 0)
+			continue;
+		p = lagr_pair[i];
+		if (p >= 0 && load[cand[p]] + weight[i] <= capacity)
+		{
+			assign[i] = p;
+			load[cand[p]] += weight[i];
+			continue;
+		}
+		for (p = start[i], best = -1; p < start[i + 1]; p++)
+		{
+			if (chosen[cand[p]] && load[cand[p]] + weight[i] <= capacity &&
+				(best < 0 || cost[p] < cost[best]))
+				best = p;
+		}
+		if (best < 0)
+			return -1;
+		assign[i] = best;
+		load[cand[best]] += weight[i];
+	}
+
+	// Shift items to cheaper seeds, seeds stay with themselves
+	for (i = 0; i < items; i++)
+	{
+		if (chosen[i])
+			continue;
+		for (p = start[i]; p < start[i + 1]; p++)
+		{
+			if (chosen[cand[p]] && cost[p] < cost[assign[i]] &&
+				load[cand[p]] + weight[i] <= capacity)
+			{
+				load[cand[assign[i]]] -= weight[i];
+				load[cand[p]] += weight[i];
+				assign[i] = p;
+			}
+		}
+	}
+
+	for (i = 0; i < items; i++)
+	{
+		total += cost[assign[i]];
+		if (chosen[i])
+			total += seed_cost[i];
+	}
+	return total;
+}
+
+/** Lagrangian relaxation heuristic for the Capacitated Concentrator Location Problem
+ *
+ *  Solves the same model as BEL_CCLPSolveSparse, following Bramel and
+ *  Simchi-Levi. The assignment constraints (3) are relaxed with multipliers
+ *  <code>u<sub>i</sub></code>, and the relaxed problem splits by seed: the
+ *  value of seed j is its cost minus the best knapsack of items with profit
+ *  <code>u<sub>i</sub> - d<sub>ij</sub></code>, and the K seeds of lowest
+ *  value are opened. This gives the lower bound
+ *
+ *  <code>L(u) = Sum<sub>i</sub>(u<sub>i</sub>) + Sum<sub>K best j</sub>(v<sub>j</sub> - knapsack<sub>j</sub>(u))</code>
+ *
+ *  and the multipliers are updated with subgradient steps. At every step
+ *  the open seeds are repaired into a feasible assignment, and the best one
+ *  is returned. Each iteration costs one knapsack per seed plus a sort of
+ *  the seeds, that is about linear in the number of candidate pairs.
+ *
+ *  @param items Number of items (nodes) to allocate
+ *  @param start Array of items + 1 offsets into cand and cost
+ *  @param cand Candidate seeds of each item
+ *  @param cost Cost of assigning each item to each of its candidate seeds
+ *  @param weight Array of weights for the nodes
+ *  @param seeds  Number of nodes to be chosen as seeds for clusters
+ *  @param seed_cost  Array of cost for a node to become seed
+ *  @param capacity  Cluster capacity
+ *  @param assignments  Array of assignations. Indicates what seed the ith item is assigned to.
+ *  @param lowerbound  If not NULL, the best lower bound found
+ *  @param verbose  Turns on lots of messages
+ *  @return 0 on success, BEL_VRP_INFEASIBLE if no feasible assignment was
+ *  found, 1 on any other failure
+ */
+
+int BEL_CCLPSolveLagrangian(int items, int start[], int cand[], int cost[], int weight[items],
+	int seeds, int seed_cost[items], int capacity, int assignments[items],
+	double *lowerbound, int verbose)
+{
+	int npairs = start[items];
+	int K = MIN(seeds, items);
+	int nseeds, maxlen, g, cap, it, stall, i, j, p, q, rval = 0;
+	double lb = -HUGE_VAL, ub = HUGE_VAL, L, h, mu = 2.0, norm, step, target;
+	double szeit = CCutil_zeit();
+
+	int *sstart = (int *) NULL;			// pairs of each seed, as offsets into spair
+	int *spair = (int *) NULL;			// pairs grouped by seed
+	int *sitem = (int *) NULL;			// item of each pair in spair
+	int *seedlist = (int *) NULL;		// items that are candidate seeds
+	int *w = (int *) NULL;					// weights divided by their gcd
+	int *kw = (int *) NULL;					// knapsack weights of one seed
+	int *byweight = (int *) NULL;		// items by decreasing weight
+	int *lagr_pair = (int *) NULL;	// pair picked for each item by the relaxation
+	int *load = (int *) NULL;
+	int *assign = (int *) NULL;
+	double *u = (double *) NULL;		// multipliers
+	double *subg = (double *) NULL;	// subgradient
+	double *profit = (double *) NULL;
+	double *value = (double *) NULL;
+	double *dp = (double *) NULL;
+	char *x = (char *) NULL;				// knapsack solution of every pair, in spair order
+	char *keep = (char *) NULL;
+	char *chosen = (char *) NULL;
+	lagr_key *keys = (lagr_key *) NULL;
+
+	sstart = (int *) calloc(items + 2, sizeof(int));
+	spair = (int *) malloc((npairs + 1) * sizeof(int));
+	sitem = (int *) malloc((npairs + 1) * sizeof(int));
+	seedlist = (int *) malloc(items * sizeof(int));
+	w = (int *) malloc(items * sizeof(int));
+	kw = (int *) malloc((items + 1) * sizeof(int));
+	byweight = (int *) malloc(items * sizeof(int));
+	lagr_pair = (int *) malloc(items * sizeof(int));
+	load = (int *) malloc(items * sizeof(int));
+	assign = (int *) malloc(items * sizeof(int));
+	u = (double *) malloc(items * sizeof(double));
+	subg = (double *) malloc(items * sizeof(double));
+	profit = (double *) malloc((items + 1) * sizeof(double));
+	value = (double *) malloc(items * sizeof(double));
+	x = (char *) malloc(npairs + 1);
+	chosen = (char *) malloc(items);
+	keys = (lagr_key *) malloc((items + 1) * sizeof(lagr_key));
+	if (!sstart || !spair || !sitem || !seedlist || !w || !kw || !byweight || !lagr_pair ||
+		!load || !assign || !u || !subg || !profit || !value || !x || !chosen || !keys)
+	{
+		fprintf(stderr, "BEL_CCLPSolveLagrangian: out of memory\n");
+		rval = 1;
+		goto CLEANUP;
+	}
+
+	// Group the pairs by seed, as for the capacity rows of the MIP
+	for (p = 0; p < npairs; p++)
+		sstart[cand[p] + 2]++;
+	for (j = 0, nseeds = 0, maxlen = 0; j < items; j++)
+	{
+		if (sstart[j + 2])
+			seedlist[nseeds++] = j;
+		if (sstart[j + 2] > maxlen)
+			maxlen = sstart[j + 2];
+		sstart[j + 2] += sstart[j + 1];
+	}
+	for (i = 0; i < items; i++)
+	{
+		for (p = start[i]; p < start[i + 1]; p++)
+		{
+			sitem[sstart[cand[p] + 1]] = i;
+			spair[sstart[cand[p] + 1]++] = p;
+		}
+	}
+	if (nseeds < K)
+	{
+		rval = BEL_VRP_INFEASIBLE;
+		goto CLEANUP;
+	}
+
+	// Knapsacks are smaller with weights and capacity divided by their gcd
+	for (i = 0, g = capacity; i < items; i++)
+		g = gcd(g, weight[i]);
+	if (g <= 0)
+		g = 1;
+	for (i = 0; i < items; i++)
+		w[i] = weight[i] / g;
+	cap = capacity / g;
+	dp = (double *) malloc((cap + 1) * sizeof(double));
+	if (!dp)
+	{
+		fprintf(stderr, "BEL_CCLPSolveLagrangian: out of memory\n");
+		rval = 1;
+		goto CLEANUP;
+	}
+	if ((double) maxlen * (cap + 1) <= LAGR_DPCELLS)
+		keep = (char *) malloc((size_t) maxlen * (cap + 1));
+
+	for (i = 0; i < items; i++)
+	{
+		keys[i].key = -weight[i];
+		keys[i].idx = i;
+	}
+	qsort(keys, items, sizeof(lagr_key), key_cmp);
+	for (i = 0; i < items; i++)
+		byweight[i] = keys[i].idx;
+
+	// Start from the cheapest assignment of each item
+	for (i = 0; i < items; i++)
+	{
+		u[i] = (start[i] < start[i + 1] ? cost[start[i]] : 0.0);
+		for (p = start[i]; p < start[i + 1]; p++)
+			u[i] = MIN(u[i], cost[p]);
+	}
+
+	if (verbose)
+		printf("Lagrangian CCLP: %d items, %d candidate seeds, %d pairs, %s knapsacks\n",
+			items, nseeds, npairs, keep ? "exact" : "greedy");
+
+	for (it = 0, stall = 0; it < LAGR_MAXIT; it++)
+	{
+		// One knapsack per candidate seed
+		for (q = 0; q < nseeds; q++)
+		{
+			j = seedlist[q];
+			for (p = sstart[j]; p < sstart[j + 1]; p++)
+			{
+				profit[p - sstart[j]] = u[sitem[p]] - cost[spair[p]];
+				kw[p - sstart[j]] = w[sitem[p]];
+			}
+			h = knapsack(sstart[j + 1] - sstart[j], profit, kw, cap, x + sstart[j], dp, keep, keys);
+			value[q] = seed_cost[j] - h;
+		}
+
+		// Open the K seeds of lowest value
+		for (q = 0; q < nseeds; q++)
+		{
+			keys[q].key = value[q];
+			keys[q].idx = q;
+		}
+		qsort(keys, nseeds, sizeof(lagr_key), key_cmp);
+		memset(chosen, 0, items);
+		for (i = 0, L = 0.0; i < items; i++)
+			L += u[i];
+		for (q = 0; q < K; q++)
+		{
+			chosen[seedlist[keys[q].idx]] = 1;
+			L += keys[q].key;
+		}
+
+		if (L > lb + 1e-9)
+		{
+			lb = L;
+			stall = 0;
+		}
+		else if (++stall >= LAGR_STALL)
+		{
+			mu /= 2.0;
+			stall = 0;
+		}
+
+		// Subgradient of the relaxed constraints, and the relaxation's own picks
+		for (i = 0; i < items; i++)
+		{
+			subg[i] = 1.0;
+			lagr_pair[i] = -1;
+		}
+		for (q = 0; q < K; q++)
+		{
+			j = seedlist[keys[q].idx];
+			for (p = sstart[j]; p < sstart[j + 1]; p++)
+			{
+				if (!x[p])
+					continue;
+				i = sitem[p];
+				subg[i] -= 1.0;
+				if (lagr_pair[i] < 0 || cost[spair[p]] < cost[lagr_pair[i]])
+					lagr_pair[i] = spair[p];
+			}
+		}
+
+		h = repair(items, start, cand, cost, weight, seed_cost, capacity, chosen, lagr_pair,
+			byweight, load, assign);
+		if (h >= 0 && h < ub)
+		{
+			ub = h;
+			for (i = 0; i < items; i++)
+				assignments[i] = cand[assign[i]];
+		}
+
+		// Costs are integer, so a gap below 1 means the assignment is optimal
+		if (ub - lb < 1.0 - 1e-9 || mu < 1e-4)
+			break;
+		for (i = 0, norm = 0.0; i < items; i++)
+			norm += subg[i] * subg[i];
+		if (norm == 0.0)
+			break;
+		target = (ub < HUGE_VAL ? ub : L + 0.1 * fabs(L) + 1.0);
+		step = mu * (target - L) / norm;
+		for (i = 0; i < items; i++)
+			u[i] += step * subg[i];
+	}
+
+	if (verbose)
+		printf("Lagrangian CCLP: %d iterations, lower bound %.2f, best %.2f, %.2f seconds\n",
+			it, lb, ub, CCutil_zeit() - szeit);
+	if (lowerbound)
+		*lowerbound = lb;
+	if (ub == HUGE_VAL)
+		rval = BEL_VRP_INFEASIBLE;
+
+CLEANUP:
+	free(sstart);
+	free(spair);
+	free(sitem);
+	free(seedlist);
+	free(w);
+	free(kw);
+	free(byweight);
+	free(lagr_pair);
+	free(load);
+	free(assign);
+	free(u);
+	free(subg);
+	free(profit);
+	free(value);
+	free(dp);
+	free(x);
+	free(keep);
+	free(chosen);
+	free(keys);
+	return rval;
+}
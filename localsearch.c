@@ -0,0 +1,508 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  localsearch.c
+ *
+ *  Inter-route local search of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <string.h>
+
+#define LS_CROSSLEN 3		//!< Longest segment exchanged by CROSS
+
+/* Moves of the local search */
+#define LS_RELOCATE_BEFORE 0
+#define LS_RELOCATE_AFTER 1
+#define LS_SWAP_PREV 2
+#define LS_SWAP_NEXT 3
+#define LS_TWOOPT_TAILS 4
+#define LS_TWOOPT_HEADS 5
+#define LS_CROSS 6
+
+/**
+ *  A route during the local search. The customers are in
+ *  <code>nodes[1]</code> to <code>nodes[len]</code>, with the depot at both
+ *  ends, and the prefix arrays make the load and the length of any segment a
+ *  difference of two entries.
+ */
+
+typedef struct ls_route {
+	int *nodes;		//!< Depot, customers, depot.
+	int *load;		//!< load[p] is the demand of nodes[1] to nodes[p], follows nodes.
+	int *cost;		//!< cost[p] is the length of the path nodes[0] to nodes[p], follows load.
+	int len;			//!< Number of customers.
+	int size;			//!< Entries allocated in each array.
+} ls_route;
+
+/**
+ *  The state of the local search.
+ */
+
+typedef struct ls_state {
+	BEL_VRPData *data;
+	int depot;
+	ls_route *routes;
+	int nroutes;
+	int *route;		//!< Route of each node, -1 if not routed.
+	int *pos;			//!< Position of each node in its route.
+	int *buf[2];	//!< Scratch space for the two routes of a move.
+	BEL_Arena arena;	//!< All the memory of the search but the neighbor lists.
+} ls_state;
+
+/**
+ *  The best move found for a customer.
+ */
+
+typedef struct ls_move {
+	int type;
+	int delta;
+	int u, v;			//!< Customers of the new edge (u, v).
+	int s, t;			//!< Segment lengths of CROSS.
+} ls_move;
+
+/**
+ *  Computes the positions and the prefix arrays of route r.
+ */
+
+static void ls_update(ls_state *st, int r)
+{
+	ls_route *rt = &st->routes[r];
+	int p;
+
+	rt->nodes[0] = st->depot;
+	rt->nodes[rt->len + 1] = st->depot;
+	rt->load[0] = 0;
+	rt->cost[0] = 0;
+	for (p = 1; p <= rt->len + 1; p++)
+	{
+		rt->load[p] = rt->load[p - 1] + (p <= rt->len ? st->data->demand[rt->nodes[p]] : 0);
+		rt->cost[p] = rt->cost[p - 1] + BEL_Dist(st->data, rt->nodes[p - 1], rt->nodes[p]);
+		if (p <= rt->len)
+		{
+			st->route[rt->nodes[p]] = r;
+			st->pos[rt->nodes[p]] = p;
+		}
+	}
+}
+
+/**
+ *  Replaces the customers of route r.
+ */
+
+static int ls_set_route(ls_state *st, int r, int *seq, int len)
+{
+	ls_route *rt = &st->routes[r];
+
+	if (len + 2 > rt->size)
+	{
+		// The old arrays are left in the arena, seq never points into them
+		rt->size = 2 * len + 2;
+		rt->nodes = (int *) BEL_ArenaAlloc(&st->arena, (size_t) 3 * rt->size * sizeof(int));
+		if (!rt->nodes)
+			return 1;
+		rt->load = rt->nodes + rt->size;
+		rt->cost = rt->load + rt->size;
+	}
+	memmove(rt->nodes + 1, seq, len * sizeof(int));
+	rt->len = len;
+	ls_update(st, r);
+	return 0;
+}
+
+/**
+ *  Appends nodes[from] to nodes[to] of a route to seq, nothing if from is
+ *  after to, and returns the new length of seq.
+ */
+
+static int ls_append(int *seq, int n, ls_route *rt, int from, int to)
+{
+	int p;
+
+	for (p = from; p <= to; p++)
+		seq[n++] = rt->nodes[p];
+	return n;
+}
+
+/**
+ *  Appends nodes[from] down to nodes[to] of a route to seq, backwards.
+ */
+
+static int ls_append_reverse(int *seq, int n, ls_route *rt, int from, int to)
+{
+	int p;
+
+	for (p = from; p >= to; p--)
+		seq[n++] = rt->nodes[p];
+	return n;
+}
+
+/**
+ *  Records a move if it is better than the best one so far.
+ */
+
+static void ls_consider(ls_move *best, int type, int delta, int u, int v, int s, int t)
+{
+	if (delta < best->delta)
+	{
+		best->type = type;
+		best->delta = delta;
+		best->u = u;
+		best->v = v;
+		best->s = s;
+		best->t = t;
+	}
+}
+
+/**
+ *  Evaluates every move between the routes of u and v that adds the edge
+ *  (u, v). Each evaluation takes constant time: edges are read around u and
+ *  v, and segment loads and lengths come from the prefix arrays.
+ */
+
+static void ls_evaluate(ls_state *st, int u, int v, ls_move *best)
+{
+	BEL_VRPData *data = st->data;
+	int capacity = data->capacity;
+	ls_route *a = &st->routes[st->route[u]];
+	ls_route *b = &st->routes[st->route[v]];
+	int i = st->pos[u], j = st->pos[v];
+	int la = a->load[a->len], lb = b->load[b->len];
+	int ca = a->cost[a->len + 1], cb = b->cost[b->len + 1];
+	int du = data->demand[u];
+	int remove_u, s, t, w, dw, cost1, cost2;
+
+#define D(x, y) BEL_Dist(data, (x), (y))
+
+	// Relocate u next to v
+	if (lb + du <= capacity)
+	{
+		remove_u = D(a->nodes[i - 1], a->nodes[i + 1]) - D(a->nodes[i - 1], u) - D(u, a->nodes[i + 1]);
+		ls_consider(best, LS_RELOCATE_BEFORE,
+			remove_u + D(b->nodes[j - 1], u) + D(u, v) - D(b->nodes[j - 1], v), u, v, 0, 0);
+		ls_consider(best, LS_RELOCATE_AFTER,
+			remove_u + D(v, u) + D(u, b->nodes[j + 1]) - D(v, b->nodes[j + 1]), u, v, 0, 0);
+	}
+
+	// Swap u with a customer next to v
+	if (j > 1)
+	{
+		w = b->nodes[j - 1];
+		dw = data->demand[w];
+		if (la - du + dw <= capacity && lb - dw + du <= capacity)
+			ls_consider(best, LS_SWAP_PREV,
+				D(a->nodes[i - 1], w) + D(w, a->nodes[i + 1]) - D(a->nodes[i - 1], u) - D(u, a->nodes[i + 1]) +
+				D(b->nodes[j - 2], u) + D(u, v) - D(b->nodes[j - 2], w) - D(w, v), u, v, 0, 0);
+	}
+	if (j < b->len)
+	{
+		w = b->nodes[j + 1];
+		dw = data->demand[w];
+		if (la - du + dw <= capacity && lb - dw + du <= capacity)
+			ls_consider(best, LS_SWAP_NEXT,
+				D(a->nodes[i - 1], w) + D(w, a->nodes[i + 1]) - D(a->nodes[i - 1], u) - D(u, a->nodes[i + 1]) +
+				D(v, u) + D(u, b->nodes[j + 2]) - D(v, w) - D(w, b->nodes[j + 2]), u, v, 0, 0);
+	}
+
+	// 2-opt*: u followed by v and the tail of its route
+	if (a->load[i] + lb - b->load[j - 1] <= capacity && b->load[j - 1] + la - a->load[i] <= capacity)
+	{
+		cost1 = a->cost[i] + D(u, v) + cb - b->cost[j];
+		cost2 = b->cost[j - 1] + D(b->nodes[j - 1], a->nodes[i + 1]) + ca - a->cost[i + 1];
+		ls_consider(best, LS_TWOOPT_TAILS, cost1 + cost2 - ca - cb, u, v, 0, 0);
+	}
+	// 2-opt*: u followed by v and the head of its route, backwards
+	if (a->load[i] + b->load[j] <= capacity && la - a->load[i] + lb - b->load[j] <= capacity)
+	{
+		cost1 = a->cost[i] + D(u, v) + b->cost[j];
+		cost2 = ca - a->cost[i + 1] + D(a->nodes[i + 1], b->nodes[j + 1]) + cb - b->cost[j + 1];
+		ls_consider(best, LS_TWOOPT_HEADS, cost1 + cost2 - ca - cb, u, v, 0, 0);
+	}
+
+	// CROSS: the s customers after u go where the t customers from v are
+	for (s = 1; s <= LS_CROSSLEN && i + s <= a->len; s++)
+	{
+		int sload = a->load[i + s] - a->load[i];
+		for (t = 1; t <= LS_CROSSLEN && j + t - 1 <= b->len; t++)
+		{
+			int tload = b->load[j + t - 1] - b->load[j - 1];
+			if (la - sload + tload > capacity || lb - tload + sload > capacity)
+				continue;
+			cost1 = a->cost[i] + D(u, v) + b->cost[j + t - 1] - b->cost[j] +
+				D(b->nodes[j + t - 1], a->nodes[i + s + 1]) + ca - a->cost[i + s + 1];
+			cost2 = b->cost[j - 1] + D(b->nodes[j - 1], a->nodes[i + 1]) + a->cost[i + s] - a->cost[i + 1] +
+				D(a->nodes[i + s], b->nodes[j + t]) + cb - b->cost[j + t];
+			ls_consider(best, LS_CROSS, cost1 + cost2 - ca - cb, u, v, s, t);
+		}
+	}
+
+#undef D
+}
+
+/**
+ *  Applies a move, rebuilding the two routes it touches.
+ */
+
+static int ls_apply(ls_state *st, ls_move *m)
+{
+	int r1 = st->route[m->u], r2 = st->route[m->v];
+	ls_route *a = &st->routes[r1];
+	ls_route *b = &st->routes[r2];
+	int i = st->pos[m->u], j = st->pos[m->v];
+	int *seq1 = st->buf[0], *seq2 = st->buf[1];
+	int n1 = 0, n2 = 0;
+
+	switch (m->type)
+	{
+		case LS_RELOCATE_BEFORE:
+		case LS_RELOCATE_AFTER:
+			n1 = ls_append(seq1, 0, a, 1, i - 1);
+			n1 = ls_append(seq1, n1, a, i + 1, a->len);
+			if (m->type == LS_RELOCATE_AFTER)
+				j++;
+			n2 = ls_append(seq2, 0, b, 1, j - 1);
+			seq2[n2++] = m->u;
+			n2 = ls_append(seq2, n2, b, j, b->len);
+			break;
+		case LS_SWAP_PREV:
+		case LS_SWAP_NEXT:
+			j += (m->type == LS_SWAP_PREV ? -1 : 1);
+			n1 = ls_append(seq1, 0, a, 1, a->len);
+			n2 = ls_append(seq2, 0, b, 1, b->len);
+			seq1[i - 1] = b->nodes[j];
+			seq2[j - 1] = m->u;
+			break;
+		case LS_TWOOPT_TAILS:
+			n1 = ls_append(seq1, 0, a, 1, i);
+			n1 = ls_append(seq1, n1, b, j, b->len);
+			n2 = ls_append(seq2, 0, b, 1, j - 1);
+			n2 = ls_append(seq2, n2, a, i + 1, a->len);
+			break;
+		case LS_TWOOPT_HEADS:
+			n1 = ls_append(seq1, 0, a, 1, i);
+			n1 = ls_append_reverse(seq1, n1, b, j, 1);
+			n2 = ls_append_reverse(seq2, 0, a, a->len, i + 1);
+			n2 = ls_append(seq2, n2, b, j + 1, b->len);
+			break;
+		case LS_CROSS:
+			n1 = ls_append(seq1, 0, a, 1, i);
+			n1 = ls_append(seq1, n1, b, j, j + m->t - 1);
+			n1 = ls_append(seq1, n1, a, i + m->s + 1, a->len);
+			n2 = ls_append(seq2, 0, b, 1, j - 1);
+			n2 = ls_append(seq2, n2, a, i + 1, i + m->s);
+			n2 = ls_append(seq2, n2, b, j + m->t, b->len);
+			break;
+	}
+	return (ls_set_route(st, r1, seq1, n1) || ls_set_route(st, r2, seq2, n2));
+}
+
+/**
+ *  Inserts node j, at distance d, in the sorted list of the nearest nodes
+ *  of some node, that holds m of its k entries.
+ */
+
+static inline void neighbor_insert(int *row, int *rowd, int *m, int k, int j, int d)
+{
+	int q;
+
+	if (*m == k && d >= rowd[k - 1])
+		return;
+	if (*m < k)
+		(*m)++;
+	for (q = *m - 1; q > 0 && rowd[q - 1] > d; q--)
+	{
+		rowd[q] = rowd[q - 1];
+		row[q] = row[q - 1];
+	}
+	rowd[q] = d;
+	row[q] = j;
+}
+
+/** Builds the lists of the nearest customers of every node
+ *
+ *  Row i of the result holds the k customers nearest to node i, nearest
+ *  first, and -1 past the last one if there are fewer than k of them. Depots
+ *  never appear in the lists, nor does i itself. Every edge length is read
+ *  once, row by row of the lower triangle, so the distance matrix is
+ *  scanned in memory order, and offered to the lists of both its ends,
+ *  which are kept sorted by insertion.
+ *
+ *  @param data The problem instance
+ *  @param k  The length of the lists
+ *  @return The dimension * k lists, to be released by the caller, NULL on failure
+ */
+
+int *BEL_NearestNeighbors(BEL_VRPData *data, int k)
+{
+	int n = data->dimension;
+	int *neigh, *bestd, *count;
+	int i, j, m, d;
+
+	neigh = (int *) malloc((size_t) n * k * sizeof(int));
+	bestd = (int *) malloc((size_t) n * k * sizeof(int));
+	count = (int *) calloc(n, sizeof(int));
+	if (!neigh || !bestd || !count)
+	{
+		fprintf(stderr, "Out of memory for the neighbor lists\n");
+		free(neigh);
+		free(bestd);
+		free(count);
+		return (int *) NULL;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		size_t ri = (size_t) i * k;
+		for (j = 0; j < i; j++)
+		{
+			size_t rj = (size_t) j * k;
+			d = BEL_Dist(data, i, j);
+			if (!data->isadepot[j])
+				neighbor_insert(neigh + ri, bestd + ri, &count[i], k, j, d);
+			if (!data->isadepot[i])
+				neighbor_insert(neigh + rj, bestd + rj, &count[j], k, i, d);
+		}
+	}
+	for (i = 0; i < n; i++)
+	{
+		for (m = count[i]; m < k; m++)
+			neigh[(size_t) i * k + m] = -1;
+	}
+
+	free(bestd);
+	free(count);
+	return neigh;
+}
+
+/**	Improves a VRP solution by moving customers between routes
+ *
+ *  Runs a granular local search with four kinds of moves between two
+ *  routes: relocate a customer, swap two customers, 2-opt* (exchange the
+ *  tails of the routes, or join the head of one to the reversed head of the
+ *  other) and CROSS-exchange of segments of up to LS_CROSSLEN customers.
+ *  Only the moves that add an edge from a customer to one of its
+ *  <code>neighbors</code> nearest customers are evaluated, and each of them
+ *  in constant time from the loads and the lengths of the route prefixes,
+ *  which are recomputed only for the two routes of a move. For every
+ *  customer in turn the best improving move is applied, until a whole pass
+ *  finds none. Routes left empty are dropped from the solution.
+ *
+ *  @param data The problem instance
+ *  @param sol  The solution to be improved, with loads and route costs
+ *  @param depot  The depot of every route
+ *  @param neighbors  The length of the neighbor lists
+ *  @param verbose  Turns on lots of messages
+ *  @return 1 on failure, leaving the solution as it was, 0 otherwise
+ */
+
+int BEL_VRPLocalSearch(BEL_VRPData *data, BEL_VRPSolution *sol, int depot, int neighbors,
+	int verbose)
+{
+	ls_state st;
+	ls_move best;
+	int *neigh = (int *) NULL;
+	int i, r, u, improved, moves = 0, passes = 0, cost = sol->cost, rval = 1;
+
+	memset(&st, 0, sizeof(st));
+	st.data = data;
+	st.depot = depot;
+	st.nroutes = sol->nvehicles;
+	if (neighbors <= 0 || st.nroutes < 2)
+		return 0;
+
+	BEL_InitArena(&st.arena, 0);
+	st.routes = (ls_route *) BEL_ArenaAlloc(&st.arena, st.nroutes * sizeof(ls_route));
+	st.route = (int *) BEL_ArenaAlloc(&st.arena, data->dimension * sizeof(int));
+	st.pos = (int *) BEL_ArenaAlloc(&st.arena, data->dimension * sizeof(int));
+	st.buf[0] = (int *) BEL_ArenaAlloc(&st.arena, (sol->nstops + 1) * sizeof(int));
+	st.buf[1] = (int *) BEL_ArenaAlloc(&st.arena, (sol->nstops + 1) * sizeof(int));
+	if (!st.routes || !st.route || !st.pos || !st.buf[0] || !st.buf[1] ||
+		!(neigh = BEL_NearestNeighbors(data, neighbors)))
+	{
+		fprintf(stderr, "Out of memory for the local search\n");
+		goto CLEANUP;
+	}
+	memset(st.routes, 0, st.nroutes * sizeof(ls_route));
+	for (i = 0; i < data->dimension; i++)
+		st.route[i] = -1;
+	for (r = 0; r < st.nroutes; r++)
+	{
+		if (ls_set_route(&st, r, BEL_Route(sol, r), BEL_RouteLen(sol, r)))
+			goto CLEANUP;
+	}
+
+	do
+	{
+		improved = 0;
+		passes++;
+		for (u = 0; u < data->dimension; u++)
+		{
+			if (st.route[u] < 0)
+				continue;
+			memset(&best, 0, sizeof(best));
+			for (i = 0; i < neighbors; i++)
+			{
+				int v = neigh[(size_t) u * neighbors + i];
+				if (v < 0)
+					break;
+				if (st.route[v] >= 0 && st.route[v] != st.route[u])
+					ls_evaluate(&st, u, v, &best);
+			}
+			if (best.delta < 0)
+			{
+				if (ls_apply(&st, &best))
+					goto CLEANUP;
+				cost += best.delta;
+				improved = 1;
+				moves++;
+			}
+		}
+	} while (improved);
+
+	// Write the routes back, leaving out the empty ones
+	sol->nvehicles = 0;
+	sol->cost = 0;
+	for (r = 0; r < st.nroutes; r++)
+	{
+		ls_route *rt = &st.routes[r];
+		if (rt->len == 0)
+			continue;
+		i = sol->nvehicles++;
+		sol->start[i + 1] = sol->start[i] + rt->len;
+		memcpy(BEL_Route(sol, i), rt->nodes + 1, rt->len * sizeof(int));
+		sol->load[i] = rt->load[rt->len];
+		sol->routecost[i] = rt->cost[rt->len + 1];
+		sol->cost += sol->routecost[i];
+	}
+#ifdef DEBUG
+	if (sol->cost != cost)
+		printf("Local search: cost %d, expecting %d from the deltas\n", sol->cost, cost);
+#endif
+	if (verbose)
+		printf("Local search: %d moves in %d passes, cost %d, %d routes\n",
+			moves, passes, sol->cost, sol->nvehicles);
+	rval = 0;
+
+CLEANUP:
+	BEL_FreeArena(&st.arena);
+	free(neigh);
+	return rval;
+}
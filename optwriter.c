@@ -50,17 +50,18 @@ void BEL_PrintVRPSolution(BEL_VRPSolution *sol, char *optfname, int verbose)
   int routes = sol->nvehicles;
   if (verbose)
     printf("Found %d routes\n", routes);
-  int i, j, routelen;
+  int i, j, routelen, *route;
   for (i = 0; i < routes; i++)
   {
-    routelen = sol->routelen[i];
+    routelen = BEL_RouteLen(sol, i);
+    route = BEL_Route(sol, i);
     if (verbose)
       printf("Route #%d has length %d\n", i, routelen);
 
     fprintf(tourfile, "Route #%d:", i + 1);
     for (j = 0; j < routelen; j++)
     {
-	    fprintf(tourfile, " %d", sol->routes[i][j]);
+	    fprintf(tourfile, " %d", route[j]);
 	  }
     fprintf(tourfile, "\n");
   }
@@ -0,0 +1,182 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  perf.c
+ *
+ *  Hardware performance counters of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+static int perf_fd[BEL_NPERF] = { -1, -1, -1, -1, -1, -1, -1, -1 };	//!< One counter per event, -1 if closed
+
+#ifdef __linux__
+
+#define CACHE_EVENT(cache, op, result) \
+	((cache) | ((op) << 8) | ((result) << 16))
+
+/**
+ *  The events behind BEL_PERF_*, in the same order.
+ */
+
+static const struct {
+	unsigned int type;
+	unsigned long long config;
+} perf_events[BEL_NPERF] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+		PERF_COUNT_HW_CACHE_RESULT_ACCESS) },
+	{ PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+		PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+};
+
+#endif
+
+/** Opens the hardware counters read at the phase boundaries
+ *
+ *  Opens one perf_event_open counter per BEL_PERF_* event for the calling
+ *  process, user space only, inherited by the threads it creates from now
+ *  on, so the route TSPs solved by the workers are counted too. Counters
+ *  the machine doesn't have are left out; if none can be opened (no PMU,
+ *  a virtual machine, perf_event_paranoid too high, not Linux) the run goes
+ *  on without them. The profile must be initialized first.
+ *
+ *  @param verbose  Turns on lots of messages.
+ *  @return 1 if no counter could be opened, 0 otherwise
+ */
+
+int BEL_InitPerf(int verbose)
+{
+#ifdef __linux__
+	struct perf_event_attr attr;
+	int i, nopen = 0, err = 0;
+
+	for (i = 0; i < BEL_NPERF; i++)
+	{
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = perf_events[i].type;
+		attr.config = perf_events[i].config;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.inherit = 1;
+		perf_fd[i] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (perf_fd[i] < 0)
+		{
+			err = errno;
+			perf_fd[i] = -1;
+		}
+		else
+			nopen++;
+		BEL_profile.perfvalid[i] = (perf_fd[i] >= 0);
+	}
+	if (nopen == 0)
+	{
+		fprintf(stderr, "Warning: no hardware counters available (%s), going on without them.\n",
+			strerror(err));
+		return 1;
+	}
+	if (verbose && nopen < BEL_NPERF)
+		printf("Only %d of %d hardware counters available\n", nopen, BEL_NPERF);
+	BEL_profile.enabled = 1;
+	BEL_profile.perf = 1;
+	return 0;
+#else
+	fprintf(stderr, "Warning: hardware counters are only available on Linux.\n");
+	return 1;
+#endif
+}
+
+/**
+ *  Reads every open counter, scaled up when the kernel had to multiplex
+ *  them. Counters that are not open read 0.
+ */
+
+static void read_counters(long long values[BEL_NPERF])
+{
+	unsigned long long buf[3];
+	int i;
+
+	for (i = 0; i < BEL_NPERF; i++)
+	{
+		values[i] = 0;
+		if (perf_fd[i] < 0 || read(perf_fd[i], buf, sizeof(buf)) != sizeof(buf))
+			continue;
+		// buf holds the count, the time enabled and the time running
+		if (buf[2] > 0 && buf[2] < buf[1])
+			values[i] = (long long) ((double) buf[0] * buf[1] / buf[2]);
+		else
+			values[i] = (long long) buf[0];
+	}
+}
+
+/** Reads the hardware counters at the start of a phase
+ *
+ *  @param phase  The phase starting
+ */
+
+void BEL_PerfBegin(int phase)
+{
+	read_counters(BEL_profile.perfstart[phase]);
+}
+
+/** Accumulates the hardware counters at the end of a phase
+ *
+ *  @param phase  The phase ending
+ */
+
+void BEL_PerfEnd(int phase)
+{
+	long long now[BEL_NPERF];
+	int i;
+
+	read_counters(now);
+	for (i = 0; i < BEL_NPERF; i++)
+		BEL_profile.counters[phase][i] += now[i] - BEL_profile.perfstart[phase][i];
+}
+
+/** Closes the hardware counters */
+
+void BEL_FreePerf(void)
+{
+	int i;
+
+	BEL_profile.perf = 0;
+	for (i = 0; i < BEL_NPERF; i++)
+	{
+		if (perf_fd[i] >= 0)
+			close(perf_fd[i]);
+		perf_fd[i] = -1;
+	}
+}
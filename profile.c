@@ -0,0 +1,264 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  profile.c
+ *
+ *  Per-phase timers and counters of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <string.h>
+
+BEL_Profile BEL_profile;	//!< The profile of this process
+
+const char *BEL_phase_names[BEL_NPHASES] =
+	{ "read", "distances", "feasibility", "seeds", "cclp_build", "cclp_solve", "cluster", "routes", "tsp",
+		"merge", "local_search", "output" };
+
+static const char *perf_names[BEL_NPERF] =
+	{ "cycles", "instructions", "branches", "branch_misses", "l1d_loads", "l1d_misses",
+		"llc_references", "llc_misses" };
+
+//! Ratios derived from the counters: IPC and the branch, L1D and LLC miss rates
+static const int perf_ratios[4][2] = {
+	{ BEL_PERF_INSTRUCTIONS, BEL_PERF_CYCLES },
+	{ BEL_PERF_BRANCH_MISSES, BEL_PERF_BRANCHES },
+	{ BEL_PERF_L1D_MISSES, BEL_PERF_L1D_LOADS },
+	{ BEL_PERF_LLC_MISSES, BEL_PERF_LLC_REFERENCES } };
+
+static const char *perf_ratio_names[4] = { "ipc", "branch_miss_rate", "l1d_miss_rate", "llc_miss_rate" };
+
+/**
+ *  Returns the ratio of two counters of a phase, or -1 if either of them is
+ *  missing or the denominator is 0.
+ */
+
+static double perf_ratio(int phase, int num, int den)
+{
+	long long *c = BEL_profile.counters[phase];
+
+	if (!BEL_profile.perfvalid[num] || !BEL_profile.perfvalid[den] || c[den] <= 0)
+		return -1.0;
+	return (double) c[num] / c[den];
+}
+
+/**
+ *  Writes the hardware counters of a phase as a JSON object, with the IPC
+ *  and the miss rates derived from them; missing values are null.
+ */
+
+static void write_counters(FILE *out, int phase)
+{
+	double v;
+	int i;
+
+	fprintf(out, ",\"counters\":{");
+	for (i = 0; i < BEL_NPERF; i++)
+	{
+		if (BEL_profile.perfvalid[i])
+			fprintf(out, "%s\"%s\":%lld", (i ? "," : ""), perf_names[i], BEL_profile.counters[phase][i]);
+		else
+			fprintf(out, "%s\"%s\":null", (i ? "," : ""), perf_names[i]);
+	}
+	for (i = 0; i < 4; i++)
+	{
+		if ((v = perf_ratio(phase, perf_ratios[i][0], perf_ratios[i][1])) >= 0.0)
+			fprintf(out, ",\"%s\":%.4f", perf_ratio_names[i], v);
+		else
+			fprintf(out, ",\"%s\":null", perf_ratio_names[i]);
+	}
+	fprintf(out, "}");
+}
+
+/** Initializes the profile
+ *
+ *  Clears all the timers and counters. With the profile disabled,
+ *  BEL_PhaseBegin, BEL_PhaseEnd and BEL_ProfileRoute do nothing.
+ *
+ *  @param enabled  Whether the profile records anything
+ */
+
+void BEL_InitProfile(int enabled)
+{
+	BEL_FreeProfile();
+	memset(&BEL_profile, 0, sizeof(BEL_Profile));
+	BEL_profile.enabled = enabled;
+}
+
+/** Records a route TSP in the profile
+ *
+ *  Called once all the routes of a solution are solved, by the thread that
+ *  scheduled them.
+ *
+ *  @param route  The index of the route
+ *  @param nodes  The nodes of the TSP, depot included
+ *  @param stats  The outcome of the solve, not used for cached routes
+ *  @param cached TRUE if the tour came from the route cache
+ */
+
+void BEL_ProfileRoute(int route, int nodes, BEL_TSPStats *stats, int cached)
+{
+	BEL_RouteProfile *r;
+
+	if (!BEL_profile.enabled)
+		return;
+	if (BEL_profile.nroutes == BEL_profile.maxroutes)
+	{
+		int max = 2 * BEL_profile.maxroutes + 64;
+		BEL_RouteProfile *grown = (BEL_RouteProfile *) realloc(BEL_profile.routes,
+			max * sizeof(BEL_RouteProfile));
+		if (!grown)
+			return;
+		BEL_profile.routes = grown;
+		BEL_profile.maxroutes = max;
+	}
+	r = &BEL_profile.routes[BEL_profile.nroutes++];
+	memset(r, 0, sizeof(BEL_RouteProfile));
+	r->route = route;
+	r->nodes = nodes;
+	r->cached = cached;
+	if (!cached)
+	{
+		r->lprows = stats->lprows;
+		r->bbnodes = stats->bbnodes;
+		r->cutrounds = stats->cutrounds;
+		r->time = stats->time;
+	}
+}
+
+/** Writes the profile to a JSON file
+ *
+ *  The file holds the time and the number of intervals of every phase, the
+ *  totals over all the route TSPs and one entry per route TSP. With the
+ *  hardware counters on, every phase also has a "counters" object with the
+ *  raw counts, the IPC and the miss rates:
+ *
+ *  <code>{"phases": {"read": {"time": 0.01, "count": 1}, ...},
+ *  "tsp": {"routes": 5, "cached": 0, "nodes": 37, ...},
+ *  "routes": [{"route": 0, "nodes": 8, ...}, ...]}</code>
+ *
+ *  @param fname  The name of the output file
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_WriteProfile(char *fname)
+{
+	FILE *out;
+	BEL_RouteProfile *r;
+	long nodes = 0, lprows = 0, bbnodes = 0, cutrounds = 0;
+	double time = 0.0;
+	int i, cached = 0;
+
+	if (!(out = fopen(fname, "w")))
+	{
+		fprintf(stderr, "Cannot open file %s for writing\n", fname);
+		return 1;
+	}
+
+	fprintf(out, "{\"phases\":{");
+	for (i = 0; i < BEL_NPHASES; i++)
+	{
+		fprintf(out, "%s\"%s\":{\"time\":%.6f,\"count\":%ld", (i ? "," : ""), BEL_phase_names[i],
+			BEL_profile.time[i], BEL_profile.count[i]);
+		if (BEL_profile.perf)
+			write_counters(out, i);
+		fprintf(out, "}");
+	}
+
+	for (i = 0; i < BEL_profile.nroutes; i++)
+	{
+		r = &BEL_profile.routes[i];
+		nodes += r->nodes;
+		lprows += r->lprows;
+		bbnodes += r->bbnodes;
+		cutrounds += r->cutrounds;
+		cached += r->cached;
+		time += r->time;
+	}
+	fprintf(out, "},\n\"tsp\":{\"routes\":%d,\"cached\":%d,\"nodes\":%ld,\"lprows\":%ld,"
+		"\"bbnodes\":%ld,\"cutrounds\":%ld,\"time\":%.6f},\n\"routes\":[",
+		BEL_profile.nroutes, cached, nodes, lprows, bbnodes, cutrounds, time);
+
+	for (i = 0; i < BEL_profile.nroutes; i++)
+	{
+		r = &BEL_profile.routes[i];
+		fprintf(out, "%s\n{\"route\":%d,\"nodes\":%d,\"lprows\":%d,\"bbnodes\":%d,"
+			"\"cutrounds\":%d,\"cached\":%s,\"time\":%.6f}", (i ? "," : ""), r->route, r->nodes,
+			r->lprows, r->bbnodes, r->cutrounds, (r->cached ? "true" : "false"), r->time);
+	}
+	fprintf(out, "]}\n");
+
+	if (fclose(out))
+	{
+		fprintf(stderr, "Error writing %s\n", fname);
+		return 1;
+	}
+	return 0;
+}
+
+/** Prints the hardware counters of every phase
+ *
+ *  Prints a table with the time, the IPC and the branch, L1D and LLC miss
+ *  rates of every phase that ran; counters that are not available show as
+ *  a dash.
+ */
+
+void BEL_PrintPerf(void)
+{
+	double v;
+	int i, j;
+
+	if (!BEL_profile.perf)
+		return;
+	printf("%-12s %10s %14s %6s %8s %8s %8s\n", "phase", "time", "instructions", "IPC",
+		"branch%", "L1D%", "LLC%");
+	for (i = 0; i < BEL_NPHASES; i++)
+	{
+		if (!BEL_profile.count[i])
+			continue;
+		printf("%-12s %10.4f ", BEL_phase_names[i], BEL_profile.time[i]);
+		if (BEL_profile.perfvalid[BEL_PERF_INSTRUCTIONS])
+			printf("%14lld", BEL_profile.counters[i][BEL_PERF_INSTRUCTIONS]);
+		else
+			printf("%14s", "-");
+		for (j = 0; j < 4; j++)
+		{
+			v = perf_ratio(i, perf_ratios[j][0], perf_ratios[j][1]);
+			if (v < 0.0)
+				printf(" %*s", (j ? 8 : 6), "-");
+			else if (j == 0)
+				printf(" %6.2f", v);
+			else
+				printf(" %8.2f", 100.0 * v);
+		}
+		printf("\n");
+	}
+}
+
+/** Releases the memory of the profile */
+
+void BEL_FreeProfile(void)
+{
+	free(BEL_profile.routes);
+	BEL_profile.routes = (BEL_RouteProfile *) NULL;
+	BEL_profile.nroutes = 0;
+	BEL_profile.maxroutes = 0;
+}
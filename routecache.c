@@ -0,0 +1,532 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  routecache.c
+ *
+ *  Cache of the optimal tours of the routes solved by Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <string.h>
+
+#define ROUTECACHE_MAGIC "BELUGA-ROUTECACHE 1" //!< First line of a cache file.
+
+/**
+ *  A cached route. The key is the norm and the coordinates of the depot,
+ *  followed by the coordinates of the customers sorted lexicographically.
+ *  The tour is stored as positions in that canonical order, depot first.
+ */
+
+struct BEL_RouteCacheEntry {
+	unsigned int hash;					//!< Hash of the key.
+	int norm;										//!< Norm of the route.
+	int ncount;									//!< Number of nodes, depot included.
+	int dims;										//!< Number of coordinates of each node.
+	double *coords;							//!< ncount * dims coordinates, in canonical order.
+	int *tour;									//!< Optimal tour, in canonical order.
+	double time;								//!< Time it took to solve the route.
+	BEL_RouteCacheEntry *hnext;	//!< Next entry in the same bucket.
+	BEL_RouteCacheEntry *prev;	//!< Previous entry in LRU order.
+	BEL_RouteCacheEntry *next;	//!< Next entry in LRU order.
+};
+
+/**
+ *  Returns the number of coordinates of the nodes for a norm, or 0 if
+ *  the norm is not based on coordinates (and routes can't be cached).
+ */
+
+static int norm_dims(int norm)
+{
+	switch (norm & CC_NORM_SIZE_BITS)
+	{
+		case CC_D2_NORM_SIZE: return 2;
+		case CC_D3_NORM_SIZE: return 3;
+		default: return 0;
+	}
+}
+
+/**
+ *  Compares two nodes of dat lexicographically by their coordinates.
+ */
+
+static int coords_cmp(CCdatagroup *dat, int dims, int a, int b)
+{
+	if (dat->x[a] != dat->x[b])
+		return (dat->x[a] < dat->x[b] ? -1 : 1);
+	if (dat->y[a] != dat->y[b])
+		return (dat->y[a] < dat->y[b] ? -1 : 1);
+	if (dims > 2 && dat->z[a] != dat->z[b])
+		return (dat->z[a] < dat->z[b] ? -1 : 1);
+	return 0;
+}
+
+/**
+ *  Hashes a key with FNV-1a over the norm, the size and the coordinates.
+ */
+
+static unsigned int key_hash(int norm, int ncount, int dims, double *coords)
+{
+	unsigned int hash = 2166136261u;
+	unsigned char *p = (unsigned char *) coords;
+	int i;
+
+	hash = (hash ^ (unsigned int) norm) * 16777619u;
+	hash = (hash ^ (unsigned int) ncount) * 16777619u;
+	for (i = 0; i < (int) (ncount * dims * sizeof(double)); i++)
+		hash = (hash ^ p[i]) * 16777619u;
+	return hash;
+}
+
+/**
+ *  Builds the canonical order of a route: order[k] is the index into
+ *  <code>set</code> of the k-th node. The depot stays first, the customers
+ *  follow sorted by coordinates. Routes are short, insertion sort will do.
+ *  Also fills the canonical coordinates and returns the hash of the key.
+ */
+
+static unsigned int canonical_key(CCdatagroup *dat, int dims, int ncount, int *set,
+	int *order, double *coords)
+{
+	int i, j, tmp;
+
+	for (i = 0; i < ncount; i++)
+	{
+		order[i] = i;
+		if (i < 2)
+			continue;
+		tmp = order[i];
+		for (j = i; j > 1 && coords_cmp(dat, dims, set[order[j - 1]], set[tmp]) > 0; j--)
+			order[j] = order[j - 1];
+		order[j] = tmp;
+	}
+	for (i = 0; i < ncount; i++)
+	{
+		coords[i * dims] = dat->x[set[order[i]]];
+		coords[i * dims + 1] = dat->y[set[order[i]]];
+		if (dims > 2)
+			coords[i * dims + 2] = dat->z[set[order[i]]];
+	}
+	return key_hash(dat->norm, ncount, dims, coords);
+}
+
+/**
+ *  Finds the entry with the given key, or NULL.
+ */
+
+static BEL_RouteCacheEntry *find_entry(BEL_RouteCache *cache, unsigned int hash,
+	int norm, int ncount, int dims, double *coords)
+{
+	BEL_RouteCacheEntry *e;
+
+	for (e = cache->buckets[hash & (cache->nbuckets - 1)]; e; e = e->hnext)
+	{
+		if (e->hash == hash && e->norm == norm && e->ncount == ncount &&
+			!memcmp(e->coords, coords, ncount * dims * sizeof(double)))
+			return e;
+	}
+	return (BEL_RouteCacheEntry *) NULL;
+}
+
+/**
+ *  Unlinks an entry from the LRU list.
+ */
+
+static void lru_unlink(BEL_RouteCache *cache, BEL_RouteCacheEntry *e)
+{
+	if (e->prev)
+		e->prev->next = e->next;
+	else
+		cache->head = e->next;
+	if (e->next)
+		e->next->prev = e->prev;
+	else
+		cache->tail = e->prev;
+	e->prev = e->next = (BEL_RouteCacheEntry *) NULL;
+}
+
+/**
+ *  Links an entry at the most recently used end of the LRU list.
+ */
+
+static void lru_push(BEL_RouteCache *cache, BEL_RouteCacheEntry *e)
+{
+	e->prev = (BEL_RouteCacheEntry *) NULL;
+	e->next = cache->head;
+	if (cache->head)
+		cache->head->prev = e;
+	else
+		cache->tail = e;
+	cache->head = e;
+}
+
+/**
+ *  Releases the memory of an entry.
+ */
+
+static void free_entry(BEL_RouteCacheEntry *e)
+{
+	CC_IFFREE(e->coords, double);
+	CC_IFFREE(e->tour, int);
+	CC_FREE(e, BEL_RouteCacheEntry);
+}
+
+/**
+ *  Removes the least recently used entry.
+ */
+
+static void evict(BEL_RouteCache *cache)
+{
+	BEL_RouteCacheEntry *e = cache->tail;
+	BEL_RouteCacheEntry **p;
+
+	if (!e)
+		return;
+	lru_unlink(cache, e);
+	for (p = &(cache->buckets[e->hash & (cache->nbuckets - 1)]); *p != e; p = &((*p)->hnext))
+		;
+	*p = e->hnext;
+	free_entry(e);
+	cache->nentries--;
+}
+
+/**
+ *  Adds an entry with the given key and canonical tour, taking ownership
+ *  of coords and tour. If the key is already there, the entry is refreshed.
+ */
+
+static void add_entry(BEL_RouteCache *cache, unsigned int hash, int norm, int ncount,
+	int dims, double *coords, int *tour, double time)
+{
+	BEL_RouteCacheEntry *e = find_entry(cache, hash, norm, ncount, dims, coords);
+
+	if (e)
+	{
+		lru_unlink(cache, e);
+		lru_push(cache, e);
+		CC_FREE(coords, double);
+		CC_FREE(tour, int);
+		return;
+	}
+	e = CC_SAFE_MALLOC(1, BEL_RouteCacheEntry);
+	if (!e)
+	{
+		CC_FREE(coords, double);
+		CC_FREE(tour, int);
+		return;
+	}
+	e->hash = hash;
+	e->norm = norm;
+	e->ncount = ncount;
+	e->dims = dims;
+	e->coords = coords;
+	e->tour = tour;
+	e->time = time;
+	e->hnext = cache->buckets[hash & (cache->nbuckets - 1)];
+	cache->buckets[hash & (cache->nbuckets - 1)] = e;
+	lru_push(cache, e);
+	cache->nentries++;
+	while (cache->nentries > cache->maxentries)
+		evict(cache);
+}
+
+/** Initializes a BEL_RouteCache structure
+ *
+ *  Call this function to initialize a BEL_RouteCache structure before its use.
+ *
+ *  @param cache  The cache to initialize
+ *  @param maxentries  Maximum number of routes kept. With 0, the cache is disabled
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_InitRouteCache(BEL_RouteCache *cache, int maxentries)
+{
+	cache->buckets = (BEL_RouteCacheEntry **) NULL;
+	cache->nbuckets = 0;
+	cache->head = cache->tail = (BEL_RouteCacheEntry *) NULL;
+	cache->nentries = 0;
+	cache->maxentries = (maxentries > 0 ? maxentries : 0);
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->saved = 0.0;
+
+	if (!cache->maxentries)
+		return 0;
+
+	// A power of two, so that the bucket is just a mask of the hash
+	for (cache->nbuckets = 64; cache->nbuckets < cache->maxentries; cache->nbuckets <<= 1)
+		;
+	cache->buckets = CC_SAFE_MALLOC(cache->nbuckets, BEL_RouteCacheEntry *);
+	if (!cache->buckets)
+	{
+		fprintf(stderr, "Out of memory for the route cache\n");
+		cache->nbuckets = 0;
+		cache->maxentries = 0;
+		return 1;
+	}
+	memset(cache->buckets, 0, cache->nbuckets * sizeof(BEL_RouteCacheEntry *));
+	return 0;
+}
+
+/** Release the memory allocated by a BEL_RouteCache structure
+ *
+ *  @param cache  The cache to release
+ */
+
+void BEL_FreeRouteCache(BEL_RouteCache *cache)
+{
+	while (cache->tail)
+		evict(cache);
+	CC_IFFREE(cache->buckets, BEL_RouteCacheEntry *);
+	cache->nbuckets = 0;
+	cache->maxentries = 0;
+}
+
+/** Looks up the optimal tour of a route in the cache
+ *
+ *  The route is made of the nodes <code>set[0]...set[ncount-1]</code> of
+ *  <code>dat</code>, depot first. Routes of three nodes or less, and routes
+ *  whose norm is not based on coordinates, are never cached.
+ *
+ *  @param cache  The route cache
+ *  @param dat  The data of the whole instance
+ *  @param ncount  Number of nodes in the route, depot included
+ *  @param set  The nodes of the route
+ *  @return A newly allocated tour as indexes into <code>set</code>, depot first,
+ *  or NULL if the route is not in the cache
+ */
+
+int *BEL_RouteCacheLookup(BEL_RouteCache *cache, CCdatagroup *dat, int ncount, int *set)
+{
+	int dims = norm_dims(dat->norm);
+	int order[ncount];
+	double coords[ncount * (dims ? dims : 1)];
+	unsigned int hash;
+	BEL_RouteCacheEntry *e;
+	int *tour;
+	int i;
+
+	if (!cache->maxentries || !dims || ncount <= 3)
+		return (int *) NULL;
+
+	hash = canonical_key(dat, dims, ncount, set, order, coords);
+	e = find_entry(cache, hash, dat->norm, ncount, dims, coords);
+	if (!e)
+	{
+		cache->misses++;
+		return (int *) NULL;
+	}
+	tour = CC_SAFE_MALLOC(ncount, int);
+	if (!tour)
+		return (int *) NULL;
+	for (i = 0; i < ncount; i++)
+		tour[i] = order[e->tour[i]];
+
+	lru_unlink(cache, e);
+	lru_push(cache, e);
+	cache->hits++;
+	cache->saved += e->time;
+	return tour;
+}
+
+/** Stores the optimal tour of a route in the cache
+ *
+ *  @param cache  The route cache
+ *  @param dat  The data of the whole instance
+ *  @param ncount  Number of nodes in the route, depot included
+ *  @param set  The nodes of the route
+ *  @param tour  The optimal tour, as indexes into <code>set</code>
+ *  @param time  The time it took to find the tour
+ */
+
+void BEL_RouteCacheInsert(BEL_RouteCache *cache, CCdatagroup *dat, int ncount, int *set,
+	int *tour, double time)
+{
+	int dims = norm_dims(dat->norm);
+	int order[ncount], pos[ncount];
+	double *coords;
+	int *ctour;
+	unsigned int hash;
+	int i, start;
+
+	if (!cache->maxentries || !dims || ncount <= 3)
+		return;
+
+	coords = CC_SAFE_MALLOC(ncount * dims, double);
+	ctour = CC_SAFE_MALLOC(ncount, int);
+	if (!coords || !ctour)
+	{
+		CC_IFFREE(coords, double);
+		CC_IFFREE(ctour, int);
+		return;
+	}
+	hash = canonical_key(dat, dims, ncount, set, order, coords);
+
+	// Translate the tour to canonical positions, rotated to start at the depot
+	for (i = 0; i < ncount; i++)
+		pos[order[i]] = i;
+	for (start = 0; start < ncount && tour[start] != 0; start++)
+		;
+	for (i = 0; i < ncount; i++)
+		ctour[i] = pos[tour[(start + i) % ncount]];
+
+	add_entry(cache, hash, dat->norm, ncount, dims, coords, ctour, time);
+}
+
+/**
+ *  Checks that a tour read from a cache file visits every node once,
+ *  starting from the depot.
+ *
+ *  @return 1 if it does not, 0 otherwise
+ */
+
+static int bad_tour(int ncount, int *tour)
+{
+	char *seen;
+	int i, rval = (tour[0] != 0);
+
+	seen = CC_SAFE_MALLOC(ncount, char);
+	if (!seen)
+		return 1;
+	for (i = 0; i < ncount; i++)
+		seen[i] = 0;
+	for (i = 0; i < ncount && !rval; i++)
+	{
+		if (tour[i] < 0 || tour[i] >= ncount || seen[tour[i]]++)
+			rval = 1;
+	}
+	CC_FREE(seen, char);
+	return rval;
+}
+
+/** Loads the routes saved by BEL_RouteCacheSave into the cache
+ *
+ *  A missing file is not an error, since it is created by the first run.
+ *
+ *  @param cache  The route cache
+ *  @param fname  The cache file
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_RouteCacheLoad(BEL_RouteCache *cache, char *fname)
+{
+	FILE *in;
+	char buf[256];
+	int norm, ncount, dims, i, rval = 0;
+	double time;
+	double *coords;
+	int *tour;
+	unsigned int hash;
+
+	if (!cache->maxentries)
+		return 0;
+	in = fopen(fname, "r");
+	if (!in)
+		return 0;
+
+	if (!fgets(buf, sizeof(buf), in) || strncmp(buf, ROUTECACHE_MAGIC, strlen(ROUTECACHE_MAGIC)))
+	{
+		fprintf(stderr, "%s is not a route cache file\n", fname);
+		fclose(in);
+		return 1;
+	}
+	while (fscanf(in, "%d %d %d %lf", &norm, &ncount, &dims, &time) == 4)
+	{
+		if (ncount <= 3 || dims != norm_dims(norm))
+		{
+			fprintf(stderr, "Bad route in %s\n", fname);
+			rval = 1;
+			break;
+		}
+		coords = CC_SAFE_MALLOC(ncount * dims, double);
+		tour = CC_SAFE_MALLOC(ncount, int);
+		if (!coords || !tour)
+		{
+			CC_IFFREE(coords, double);
+			CC_IFFREE(tour, int);
+			rval = 1;
+			break;
+		}
+		for (i = 0; i < ncount * dims; i++)
+		{
+			if (fscanf(in, "%lf", &coords[i]) != 1)
+				rval = 1;
+		}
+		for (i = 0; i < ncount; i++)
+		{
+			if (fscanf(in, "%d", &tour[i]) != 1)
+				rval = 1;
+		}
+		if (rval || bad_tour(ncount, tour))
+		{
+			fprintf(stderr, "%s route in %s\n", (rval ? "Truncated" : "Bad"), fname);
+			rval = 1;
+			CC_FREE(coords, double);
+			CC_FREE(tour, int);
+			break;
+		}
+
+		hash = key_hash(norm, ncount, dims, coords);
+		add_entry(cache, hash, norm, ncount, dims, coords, tour, time);
+	}
+	fclose(in);
+	return rval;
+}
+
+/** Saves the routes in the cache to a file
+ *
+ *  Routes are written from the least to the most recently used, so that
+ *  loading them back restores the LRU order.
+ *
+ *  @param cache  The route cache
+ *  @param fname  The cache file
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_RouteCacheSave(BEL_RouteCache *cache, char *fname)
+{
+	FILE *out;
+	BEL_RouteCacheEntry *e;
+	int i;
+
+	if (!cache->maxentries)
+		return 0;
+	out = fopen(fname, "w");
+	if (!out)
+	{
+		fprintf(stderr, "Couldn't open %s for writing\n", fname);
+		return 1;
+	}
+	fprintf(out, "%s\n", ROUTECACHE_MAGIC);
+	for (e = cache->tail; e; e = e->prev)
+	{
+		fprintf(out, "%d %d %d %f\n", e->norm, e->ncount, e->dims, e->time);
+		for (i = 0; i < e->ncount * e->dims; i++)
+			fprintf(out, "%.17g%c", e->coords[i], ((i + 1) % e->dims) ? ' ' : '\n');
+		for (i = 0; i < e->ncount; i++)
+			fprintf(out, "%d%c", e->tour[i], (i < e->ncount - 1) ? ' ' : '\n');
+	}
+	if (fclose(out))
+	{
+		fprintf(stderr, "Couldn't write %s\n", fname);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,250 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  savings.c
+ *
+ *  Clarke and Wright savings construction, a phase 1 of Beluga VRP solver
+ *  for the instances too large for the CCLP
+ *
+ */
+
+#include "beluga.h"
+#include <string.h>
+
+#define SAVINGS_RADIX_BITS 11		//!< Bits of the savings sorted by each pass of the radix sort
+#define SAVINGS_RADIX (1 << SAVINGS_RADIX_BITS)
+
+/**
+ *  The saving of joining two customers in the same route.
+ */
+
+typedef struct savings_pair {
+	int saving;		//!< d(0, i) + d(0, j) - d(i, j)
+	int i, j;			//!< Customers, as indexes into customer2node.
+} savings_pair;
+
+/**
+ *  Sorts pairs by decreasing saving, keeping ties in the order they come,
+ *  by a least significant digit radix sort. Savings are positive, so
+ *  every pass is a counting sort on SAVINGS_RADIX_BITS of them.
+ *
+ *  @return 1 on failure, 0 otherwise
+ */
+
+static int savings_sort(savings_pair *pairs, int npairs)
+{
+	savings_pair *tmp, *t, *src = pairs, *dst;
+	int count[SAVINGS_RADIX];
+	int maxsaving = 0, shift, i, digit, sum, c;
+
+	tmp = (savings_pair *) malloc((size_t) npairs * sizeof(savings_pair));
+	if (!tmp)
+		return 1;
+	dst = tmp;
+	for (i = 0; i < npairs; i++)
+	{
+		if (pairs[i].saving > maxsaving)
+			maxsaving = pairs[i].saving;
+	}
+	for (shift = 0; shift < 31 && (maxsaving >> shift); shift += SAVINGS_RADIX_BITS)
+	{
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < npairs; i++)
+			count[(src[i].saving >> shift) & (SAVINGS_RADIX - 1)]++;
+		// Largest digits first
+		for (digit = SAVINGS_RADIX - 1, sum = 0; digit >= 0; digit--)
+		{
+			c = count[digit];
+			count[digit] = sum;
+			sum += c;
+		}
+		for (i = 0; i < npairs; i++)
+			dst[count[(src[i].saving >> shift) & (SAVINGS_RADIX - 1)]++] = src[i];
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != pairs)
+		memcpy(pairs, src, (size_t) npairs * sizeof(savings_pair));
+	free(tmp);
+	return 0;
+}
+
+/**
+ *  Finds the route of a customer, halving the paths of the union-find
+ *  forest along the way.
+ */
+
+static int savings_find(int *parent, int i)
+{
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+/** Clusters the customers of a VRP instance by the savings heuristic
+ *
+ *  Runs the parallel savings algorithm of Clarke and Wright. Every customer
+ *  starts in a route of its own; routes are then joined in order of
+ *  decreasing saving <code>d<sub>0i</sub> + d<sub>0j</sub> - d<sub>ij</sub></code>,
+ *  as long as i and j are at an end of two different routes and the joined
+ *  route fits the capacity. Only the pairs of a customer and one of its
+ *  <code>neighbors</code> nearest customers are considered, so there are
+ *  O(n k) of them; they are radix sorted, and the routes are kept in a
+ *  union-find forest holding their load, which makes the whole merge
+ *  about linear. The number of routes is whatever the merge leaves, and
+ *  may be more than <code>data->nvehicles</code>.
+ *
+ *  The routes come out in the format of BEL_CCLPCluster: each customer is
+ *  assigned to the first customer of its route, which is assigned to itself.
+ *  Phase 2 sequences them.
+ *
+ *  @param data The problem instance
+ *  @param depot The depot of the routes
+ *  @param items Number of customers
+ *  @param customer2node Node of each customer
+ *  @param neighbors Number of nearest customers paired with each customer, 0 for all
+ *  @param assignments Route of each customer
+ *  @param verbose Turns on lots of messages
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_SavingsCluster(BEL_VRPData *data, int depot, int items, int customer2node[],
+	int neighbors, int assignments[], int verbose)
+{
+	int dimension = data->dimension;
+	int *neigh = (int *) NULL, *node2customer = (int *) NULL;
+	int *parent = (int *) NULL, *load = (int *) NULL, *degree = (int *) NULL;
+	int *first = (int *) NULL;
+	savings_pair *pairs = (savings_pair *) NULL;
+	int npairs = 0, nroutes = items, rval = 1;
+	int i, j, k, q, ri, rj, s;
+
+	if (neighbors <= 0 || neighbors > items - 1)
+		neighbors = items - 1;
+	if (neighbors < 1)
+		neighbors = 1;
+	node2customer = (int *) malloc(dimension * sizeof(int));
+	parent = (int *) malloc(items * sizeof(int));
+	load = (int *) malloc(items * sizeof(int));
+	degree = (int *) calloc(items, sizeof(int));
+	first = (int *) malloc(items * sizeof(int));
+	pairs = (savings_pair *) malloc((size_t) items * neighbors * sizeof(savings_pair));
+	if (!node2customer || !parent || !load || !degree || !first || !pairs ||
+		!(neigh = BEL_NearestNeighbors(data, neighbors)))
+	{
+		fprintf(stderr, "Out of memory for the savings\n");
+		goto CLEANUP;
+	}
+
+	for (i = 0; i < dimension; i++)
+		node2customer[i] = -1;
+	for (i = 0; i < items; i++)
+	{
+		node2customer[customer2node[i]] = i;
+		parent[i] = i;
+		load[i] = data->demand[customer2node[i]];
+	}
+
+	// Each pair once: from the list of its lower customer, unless only the other one has it
+	for (i = 0; i < items; i++)
+	{
+		int *row = neigh + (size_t) customer2node[i] * neighbors;
+		for (k = 0; k < neighbors && row[k] >= 0; k++)
+		{
+			j = node2customer[row[k]];
+			if (j < 0)
+				continue;
+			if (j < i)
+			{
+				int *other = neigh + (size_t) row[k] * neighbors;
+				for (q = 0; q < neighbors && other[q] >= 0 && other[q] != customer2node[i]; q++)
+					;
+				if (q < neighbors && other[q] == customer2node[i])
+					continue;
+			}
+			s = BEL_Dist(data, depot, customer2node[i]) + BEL_Dist(data, depot, row[k]) -
+				BEL_Dist(data, customer2node[i], row[k]);
+			if (s <= 0)
+				continue;
+			pairs[npairs].saving = s;
+			pairs[npairs].i = i;
+			pairs[npairs].j = j;
+			npairs++;
+		}
+	}
+	if (savings_sort(pairs, npairs))
+	{
+		fprintf(stderr, "Out of memory for the savings\n");
+		goto CLEANUP;
+	}
+
+	for (k = 0; k < npairs; k++)
+	{
+		i = pairs[k].i;
+		j = pairs[k].j;
+		// Only the ends of a route can be joined, a customer inside has two neighbors
+		if (degree[i] > 1 || degree[j] > 1)
+			continue;
+		ri = savings_find(parent, i);
+		rj = savings_find(parent, j);
+		if (ri == rj || load[ri] + load[rj] > data->capacity)
+			continue;
+		if (ri > rj)
+		{
+			q = ri;
+			ri = rj;
+			rj = q;
+		}
+		parent[rj] = ri;
+		load[ri] += load[rj];
+		degree[i]++;
+		degree[j]++;
+		nroutes--;
+	}
+
+	// Each route is named after its first customer
+	for (i = 0; i < items; i++)
+		first[i] = -1;
+	for (i = 0; i < items; i++)
+	{
+		ri = savings_find(parent, i);
+		if (first[ri] < 0)
+			first[ri] = i;
+		assignments[i] = first[ri];
+	}
+
+	if (verbose)
+		printf("Savings: %d pairs, %d routes for %d vehicles\n", npairs, nroutes, data->nvehicles);
+	rval = 0;
+
+CLEANUP:
+	free(neigh);
+	free(node2customer);
+	free(parent);
+	free(load);
+	free(degree);
+	free(first);
+	free(pairs);
+	return rval;
+}
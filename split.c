@@ -0,0 +1,161 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  split.c
+ *
+ *  Optimal split of a giant tour into routes, the cluster second step of
+ *  the route first, cluster second mode of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+
+/**
+ *  Splits the customers order[1] to order[n] into routes, in this order,
+ *  at the least total cost. The route of customers i + 1 to j costs
+ *  <code>d<sub>0,i+1</sub> + D<sub>j</sub> - D<sub>i+1</sub> + d<sub>j0</sub></code>,
+ *  where D holds the lengths of the path prefixes, so the best split p of
+ *  the first j customers is the minimum over the feasible i of
+ *  <code>f(i) = p(i) + d<sub>0,i+1</sub> - D<sub>i+1</sub></code>, plus a term
+ *  of j alone. The feasible i form a window whose both ends only move
+ *  forward, so the minimum is kept by a monotone deque of candidates with
+ *  increasing f, and each customer enters and leaves it once.
+ *
+ *  @return The cost of the split, -1 if some customer fits no vehicle
+ */
+
+static long long split_order(BEL_VRPData *data, int depot, int n, int *order, long long *dist,
+	long long *load, long long *p, int *pred, int *deque)
+{
+	int head = 0, tail = 0, i, j;
+
+#define F(i) (p[i] + BEL_Dist(data, depot, order[(i) + 1]) - dist[(i) + 1])
+
+	dist[1] = 0;
+	load[0] = 0;
+	for (j = 1; j <= n; j++)
+	{
+		if (j > 1)
+			dist[j] = dist[j - 1] + BEL_Dist(data, order[j - 1], order[j]);
+		load[j] = load[j - 1] + data->demand[order[j]];
+	}
+
+	p[0] = 0;
+	for (j = 1; j <= n; j++)
+	{
+		// i = j - 1 becomes feasible, and beats every worse candidate before it
+		i = j - 1;
+		while (tail > head && F(deque[tail - 1]) >= F(i))
+			tail--;
+		deque[tail++] = i;
+		// Candidates whose route to j would not fit leave from the front
+		while (head < tail && load[j] - load[deque[head]] > data->capacity)
+			head++;
+		if (head == tail)
+			return -1;
+		i = deque[head];
+		p[j] = F(i) + dist[j] + BEL_Dist(data, order[j], depot);
+		pred[j] = i;
+	}
+
+#undef F
+
+	return p[n];
+}
+
+/** Splits a giant tour into the routes of a VRP solution
+ *
+ *  The cluster second step of the route first, cluster second heuristic
+ *  (Prins 2004): cuts the tour through all the customers into routes that
+ *  fit the capacity, keeping the order of the tour, at the least total cost.
+ *  The split runs in linear time with the monotone deque of Vidal (2016).
+ *  The number of routes is whatever the split needs.
+ *
+ *  @param data The problem instance
+ *  @param depot The depot of the routes
+ *  @param n Number of customers
+ *  @param tour The customers, in the order of the giant tour
+ *  @param sol  The solution found
+ *  @param verbose  Turns on lots of messages
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_SplitTour(BEL_VRPData *data, int depot, int n, int *tour, BEL_VRPSolution *sol,
+	int verbose)
+{
+	long long *dist, *load, *p;
+	int *order, *pred, *deque;
+	int i, j, r, nroutes, rval = 1;
+
+	dist = (long long *) malloc((n + 1) * sizeof(long long));
+	load = (long long *) malloc((n + 1) * sizeof(long long));
+	p = (long long *) malloc((n + 1) * sizeof(long long));
+	order = (int *) malloc((n + 1) * sizeof(int));
+	pred = (int *) malloc((n + 1) * sizeof(int));
+	deque = (int *) malloc((n + 1) * sizeof(int));
+	if (!dist || !load || !p || !order || !pred || !deque)
+	{
+		fprintf(stderr, "Out of memory for the split\n");
+		goto CLEANUP;
+	}
+
+	order[0] = depot;
+	for (i = 1; i <= n; i++)
+		order[i] = tour[i - 1];
+	if (split_order(data, depot, n, order, dist, load, p, pred, deque) < 0)
+	{
+		fprintf(stderr, "A customer has more demand than a vehicle holds\n");
+		goto CLEANUP;
+	}
+
+	nroutes = 0;
+	for (j = n; j > 0; j = pred[j])
+		nroutes++;
+	if (BEL_AllocVRPSolution(sol, nroutes, n, (BEL_Arena *) NULL))
+		goto CLEANUP;
+
+	// Routes come out last first, from the predecessors
+	r = nroutes;
+	for (j = n; j > 0; j = pred[j])
+	{
+		r--;
+		sol->start[r] = pred[j];
+		sol->start[r + 1] = j;
+	}
+	for (r = 0; r < nroutes; r++)
+	{
+		for (i = sol->start[r]; i < sol->start[r + 1]; i++)
+			sol->nodes[i] = order[i + 1];
+	}
+	BEL_EvaluateVRPSolution(sol, data, depot);
+
+	if (verbose)
+		printf("Split: %d routes, cost %d\n", nroutes, sol->cost);
+	rval = 0;
+
+CLEANUP:
+	free(dist);
+	free(load);
+	free(p);
+	free(order);
+	free(pred);
+	free(deque);
+	return rval;
+}
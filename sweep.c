@@ -0,0 +1,262 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  sweep.c
+ *
+ *  Sweep clustering, a phase 1 of Beluga VRP solver for instances with a
+ *  central depot
+ *
+ */
+
+#include "beluga.h"
+#include <math.h>
+#include <pthread.h>
+
+/**
+ *  A customer and its polar angle around the depot.
+ */
+
+typedef struct sweep_key {
+	double angle;
+	int idx;
+} sweep_key;
+
+/**
+ *  The sweep order, shared by all the threads, and the best start angle
+ *  of a range of them. Positions run over the order twice, so that a sweep
+ *  starting anywhere reads positions start to start + items - 1.
+ */
+
+typedef struct sweep_job {
+	int items;
+	int capacity;
+	const int *weight;			//!< Demand at each position of the first lap.
+	const int *depotlen;		//!< Distance from the depot at each position of the first lap.
+	const long long *prefix;	//!< Length of the path from position 0 to each position.
+	int first, last;				//!< Range of start positions of this job.
+	long long bestcost;			//!< Cost of the best start of the range.
+	int beststart;					//!< The best start of the range.
+} sweep_job;
+
+/**
+ *  qsort comparator for sweep_key: ascending angle, ties broken by index.
+ */
+
+static int angle_cmp(const void *a, const void *b)
+{
+	const sweep_key *x = (const sweep_key *) a, *y = (const sweep_key *) b;
+
+	if (x->angle != y->angle)
+		return (x->angle < y->angle ? -1 : 1);
+	return x->idx - y->idx;
+}
+
+/**
+ *  Cuts the sweep from start into clusters, each one as large as the
+ *  capacity allows, and returns the total length of the clusters visited
+ *  in sweep order. Each cluster is priced in constant time from the path
+ *  prefix lengths. If starts is not NULL, it receives the first position
+ *  of each cluster, and the number of clusters is returned in *nclusters.
+ */
+
+static long long sweep_cut(sweep_job *job, int start, int *starts, int *nclusters)
+{
+	int n = job->items;
+	int p = start, a, load, count = 0;
+	long long cost = 0;
+
+	while (p < start + n)
+	{
+		a = p;
+		load = 0;
+		// A customer heavier than a vehicle still gets a route of its own
+		do
+		{
+			load += job->weight[p % n];
+			p++;
+		} while (p < start + n && load + job->weight[p % n] <= job->capacity);
+		cost += job->depotlen[a % n] + job->prefix[p - 1] - job->prefix[a] + job->depotlen[(p - 1) % n];
+		if (starts)
+			starts[count] = a;
+		count++;
+	}
+	if (nclusters)
+		*nclusters = count;
+	return cost;
+}
+
+/**
+ *  Thread body: tries every start of the range of a job.
+ */
+
+static void *sweep_worker(void *arg)
+{
+	sweep_job *job = (sweep_job *) arg;
+	long long cost;
+	int s;
+
+	job->bestcost = -1;
+	for (s = job->first; s < job->last; s++)
+	{
+		cost = sweep_cut(job, s, (int *) NULL, (int *) NULL);
+		if (job->bestcost < 0 || cost < job->bestcost)
+		{
+			job->bestcost = cost;
+			job->beststart = s;
+		}
+	}
+	return NULL;
+}
+
+/** Clusters the customers of a VRP instance by the sweep heuristic
+ *
+ *  Sorts the customers by polar angle around the depot and cuts the sweep
+ *  into clusters, each one filled up to the capacity before the next one
+ *  starts. Every one of the <code>items</code> customers is tried as the
+ *  first one of the sweep, and the start giving the shortest routes wins,
+ *  a route being priced as the path through its customers in sweep order.
+ *  A route costs O(1) from the prefix lengths of that path, so each start
+ *  takes linear time; the starts are split among <code>workers</code>
+ *  threads. The number of clusters is whatever the cut leaves, and may be
+ *  more than <code>data->nvehicles</code>.
+ *
+ *  The clusters come out in the format of BEL_CCLPCluster: each customer is
+ *  assigned to the first customer of its cluster, which is assigned to
+ *  itself. Phase 2 sequences them. The instance must have coordinates.
+ *
+ *  @param data The problem instance
+ *  @param depot The depot of the routes
+ *  @param items Number of customers
+ *  @param customer2node Node of each customer
+ *  @param workers Number of threads trying the starts
+ *  @param assignments Cluster of each customer
+ *  @param verbose Turns on lots of messages
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_SweepCluster(BEL_VRPData *data, int depot, int items, int customer2node[],
+	int workers, int assignments[], int verbose)
+{
+	sweep_key *keys = (sweep_key *) NULL;
+	int *order = (int *) NULL, *weight = (int *) NULL, *depotlen = (int *) NULL;
+	int *starts = (int *) NULL;
+	long long *prefix = (long long *) NULL;
+	double *x = data->dat->x, *y = data->dat->y;
+	int nthreads, nclusters, i, p, q, rval = 1;
+
+	if (!x || !y)
+	{
+		fprintf(stderr, "Sweep clustering needs node coordinates\n");
+		return 1;
+	}
+	if (items < 1)
+		return 0;
+
+	keys = (sweep_key *) malloc(items * sizeof(sweep_key));
+	order = (int *) malloc(items * sizeof(int));
+	weight = (int *) malloc(items * sizeof(int));
+	depotlen = (int *) malloc(items * sizeof(int));
+	starts = (int *) malloc(items * sizeof(int));
+	prefix = (long long *) malloc(2 * (size_t) items * sizeof(long long));
+	if (!keys || !order || !weight || !depotlen || !starts || !prefix)
+	{
+		fprintf(stderr, "Out of memory for the sweep\n");
+		goto CLEANUP;
+	}
+
+	for (i = 0; i < items; i++)
+	{
+		keys[i].angle = atan2(y[customer2node[i]] - y[depot], x[customer2node[i]] - x[depot]);
+		keys[i].idx = i;
+	}
+	qsort(keys, items, sizeof(sweep_key), angle_cmp);
+	for (p = 0; p < items; p++)
+	{
+		order[p] = keys[p].idx;
+		weight[p] = data->demand[customer2node[order[p]]];
+		depotlen[p] = BEL_Dist(data, depot, customer2node[order[p]]);
+	}
+	prefix[0] = 0;
+	for (p = 1; p < 2 * items; p++)
+		prefix[p] = prefix[p - 1] + BEL_Dist(data, customer2node[order[(p - 1) % items]],
+			customer2node[order[p % items]]);
+
+	// Every start angle, split among the threads
+	nthreads = MIN(workers > 1 ? workers : 1, items);
+	{
+		sweep_job jobs[nthreads];
+		pthread_t threads[nthreads];
+		int started = 0, best = 0;
+
+		for (i = 0; i < nthreads; i++)
+		{
+			jobs[i].items = items;
+			jobs[i].capacity = data->capacity;
+			jobs[i].weight = weight;
+			jobs[i].depotlen = depotlen;
+			jobs[i].prefix = prefix;
+			jobs[i].first = (int) ((long long) items * i / nthreads);
+			jobs[i].last = (int) ((long long) items * (i + 1) / nthreads);
+		}
+		for (i = 1; i < nthreads; i++)
+		{
+			if (pthread_create(&threads[i], NULL, sweep_worker, &jobs[i]))
+				break;
+			started = i;
+		}
+		// This thread does the first range, and any range left without a thread
+		sweep_worker(&jobs[0]);
+		for (i = started + 1; i < nthreads; i++)
+			sweep_worker(&jobs[i]);
+		for (i = 1; i <= started; i++)
+			pthread_join(threads[i], NULL);
+
+		for (i = 1; i < nthreads; i++)
+		{
+			if (jobs[i].bestcost < jobs[best].bestcost)
+				best = i;
+		}
+		p = jobs[best].beststart;
+		if (verbose)
+			printf("Sweep: best start at customer %d of %d, %lld in sweep order\n",
+				p, items, jobs[best].bestcost);
+		sweep_cut(&jobs[best], p, starts, &nclusters);
+	}
+
+	for (i = 0; i < nclusters; i++)
+	{
+		int end = (i + 1 < nclusters ? starts[i + 1] : p + items);
+		int seed = order[starts[i] % items];
+		for (q = starts[i]; q < end; q++)
+			assignments[order[q % items]] = seed;
+	}
+	if (verbose)
+		printf("Sweep: %d routes for %d vehicles\n", nclusters, data->nvehicles);
+	rval = 0;
+
+CLEANUP:
+	free(keys);
+	free(order);
+	free(weight);
+	free(depotlen);
+	free(starts);
+	free(prefix);
+	return rval;
+}
@@ -0,0 +1,256 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  trace.c
+ *
+ *  Chrome trace event output of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <string.h>
+#include <unistd.h>
+
+#define TRACE_CHUNK 1024	//!< Events per chunk of a thread buffer
+
+/**
+ *  A complete ("X") trace event. Names and argument names must be string
+ *  constants, only the pointers are kept.
+ */
+
+typedef struct trace_event {
+	const char *name;				//!< Name of the event
+	const char *cat;				//!< Category of the event
+	double start;						//!< Start time, from BEL_ProfileClock
+	double end;							//!< End time, from BEL_ProfileClock
+	const char *argname[2];	//!< Names of the arguments, NULL if unused
+	int arg[2];							//!< Values of the arguments
+} trace_event;
+
+typedef struct trace_chunk {
+	struct trace_chunk *next;	//!< The chunk filled before this one
+	int nevents;							//!< Events used in this chunk
+	trace_event events[TRACE_CHUNK];
+} trace_chunk;
+
+/**
+ *  The events of one thread. Only the owning thread appends to its buffer,
+ *  so recording an event takes no lock; buffers are linked into a global
+ *  list with a compare and swap the first time a thread records an event.
+ */
+
+typedef struct trace_buffer {
+	struct trace_buffer *next;	//!< The buffer registered before this one
+	int tid;										//!< Thread number shown in the trace
+	const char *name;						//!< Thread name, NULL if not set
+	trace_chunk *chunks;				//!< Chunks of events, the newest first
+} trace_buffer;
+
+static trace_buffer *trace_buffers;			//!< All the thread buffers
+static int trace_nthreads;							//!< Threads seen so far
+static double trace_start;							//!< Time origin of the trace
+static __thread trace_buffer *trace_mine;	//!< Buffer of the calling thread
+
+/**
+ *  Returns the buffer of the calling thread, registering it on first use.
+ */
+
+static trace_buffer *thread_buffer(void)
+{
+	trace_buffer *b = trace_mine;
+
+	if (b)
+		return b;
+	if (!(b = (trace_buffer *) calloc(1, sizeof(trace_buffer))))
+		return (trace_buffer *) NULL;
+	b->tid = __sync_add_and_fetch(&trace_nthreads, 1);
+	do
+		b->next = __atomic_load_n(&trace_buffers, __ATOMIC_ACQUIRE);
+	while (!__sync_bool_compare_and_swap(&trace_buffers, b->next, b));
+	return (trace_mine = b);
+}
+
+/** Starts recording trace events
+ *
+ *  Turns the profile on, since phases are traced by BEL_PhaseEnd, and sets
+ *  the time origin of the trace. The calling thread is named "main".
+ */
+
+void BEL_InitTrace(void)
+{
+	BEL_profile.enabled = 1;
+	BEL_profile.trace = 1;
+	trace_start = BEL_ProfileClock();
+	BEL_TraceThreadName("main");
+}
+
+/** Names the calling thread in the trace
+ *
+ *  @param name The name, a string constant
+ */
+
+void BEL_TraceThreadName(const char *name)
+{
+	trace_buffer *b;
+
+	if (BEL_profile.trace && (b = thread_buffer()))
+		b->name = name;
+}
+
+/** Records a complete trace event
+ *
+ *  Appends an event that started at <code>start</code> and ends now to the
+ *  buffer of the calling thread. Does nothing if tracing is off. Up to two
+ *  integer arguments are shown with the event; pass NULL names to leave
+ *  them out.
+ *
+ *  @param name The name of the event, a string constant
+ *  @param cat  The category of the event, a string constant
+ *  @param start  The start time, from BEL_TraceClock
+ *  @param arg1 The name of the first argument, or NULL
+ *  @param val1 The value of the first argument
+ *  @param arg2 The name of the second argument, or NULL
+ *  @param val2 The value of the second argument
+ */
+
+void BEL_TraceComplete(const char *name, const char *cat, double start,
+	const char *arg1, int val1, const char *arg2, int val2)
+{
+	trace_buffer *b;
+	trace_chunk *c;
+	trace_event *e;
+
+	if (!BEL_profile.trace || !(b = thread_buffer()))
+		return;
+	c = b->chunks;
+	if (!c || c->nevents == TRACE_CHUNK)
+	{
+		if (!(c = (trace_chunk *) malloc(sizeof(trace_chunk))))
+			return;
+		c->nevents = 0;
+		c->next = b->chunks;
+		b->chunks = c;
+	}
+	e = &c->events[c->nevents++];
+	e->name = name;
+	e->cat = cat;
+	e->start = start;
+	e->end = BEL_ProfileClock();
+	e->argname[0] = arg1;
+	e->arg[0] = val1;
+	e->argname[1] = arg2;
+	e->arg[1] = val2;
+}
+
+/**
+ *  Writes the events of a chunk list oldest first.
+ */
+
+static void write_chunks(FILE *out, trace_chunk *c, int tid, int pid, int *first)
+{
+	trace_event *e;
+	int i, j;
+
+	if (!c)
+		return;
+	write_chunks(out, c->next, tid, pid, first);
+	for (i = 0; i < c->nevents; i++)
+	{
+		e = &c->events[i];
+		fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+			"\"ts\":%.3f,\"dur\":%.3f", (*first ? "" : ","), e->name, e->cat, pid, tid,
+			(e->start - trace_start) * 1e6, (e->end - e->start) * 1e6);
+		*first = 0;
+		if (e->argname[0] || e->argname[1])
+		{
+			fprintf(out, ",\"args\":{");
+			for (j = 0; j < 2; j++)
+				if (e->argname[j])
+					fprintf(out, "%s\"%s\":%d", (j && e->argname[0] ? "," : ""), e->argname[j], e->arg[j]);
+			fprintf(out, "}");
+		}
+		fprintf(out, "}");
+	}
+}
+
+/** Writes the trace events to a file
+ *
+ *  Writes every event recorded so far in the Chrome trace event format,
+ *  which chrome://tracing and Perfetto load directly, along with the name
+ *  of every thread. Must be called once the worker threads are done.
+ *
+ *  @param fname  The name of the output file
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_WriteTrace(char *fname)
+{
+	FILE *out;
+	trace_buffer *b;
+	int pid = (int) getpid();
+	int first = 1;
+
+	if (!(out = fopen(fname, "w")))
+	{
+		fprintf(stderr, "Cannot open file %s for writing\n", fname);
+		return 1;
+	}
+	fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (b = trace_buffers; b; b = b->next)
+	{
+		if (b->name)
+		{
+			fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s\"}}", (first ? "" : ","), pid, b->tid, b->name);
+			first = 0;
+		}
+		write_chunks(out, b->chunks, b->tid, pid, &first);
+	}
+	fprintf(out, "\n]}\n");
+
+	if (fclose(out))
+	{
+		fprintf(stderr, "Error writing %s\n", fname);
+		return 1;
+	}
+	return 0;
+}
+
+/** Releases the memory of the trace and stops tracing */
+
+void BEL_FreeTrace(void)
+{
+	trace_buffer *b, *nextb;
+	trace_chunk *c, *nextc;
+
+	BEL_profile.trace = 0;
+	for (b = trace_buffers; b; b = nextb)
+	{
+		nextb = b->next;
+		for (c = b->chunks; c; c = nextc)
+		{
+			nextc = c->next;
+			free(c);
+		}
+		free(b);
+	}
+	trace_buffers = (trace_buffer *) NULL;
+	trace_mine = (trace_buffer *) NULL;
+}
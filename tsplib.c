@@ -0,0 +1,831 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  tsplib.c
+ *
+ *  Memory mapped readers of TSPLIB instances and tour files for Beluga VRP
+ *  solver
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MATRIX_LOWER_DIAG_ROW  0
+#define MATRIX_UPPER_ROW       1
+#define MATRIX_UPPER_DIAG_ROW  2
+#define MATRIX_FULL_MATRIX     3
+#define MATRIX_LOWER_ROW       4
+
+#define TSPLIB_FIELD 256	//!< Longest key or value kept from a header line
+
+/**
+ *  A cursor over the text of a TSPLIB file. The text is not null
+ *  terminated, every read stops at end.
+ */
+
+typedef struct tsplib_buf {
+	const char *p;		//!< Current position
+	const char *end;	//!< End of the text
+} tsplib_buf;
+
+/**
+ *  Norms of the EDGE_WEIGHT_TYPE keyword.
+ */
+
+static const struct {
+	const char *name;
+	int norm;
+	const char *description;
+} tsplib_norms[] = {
+	{ "EXPLICIT", CC_MATRIXNORM, "Explicit Lengths (CC_MATRIXNORM)" },
+	{ "EUC_2D", CC_EUCLIDEAN, "Rounded Euclidean Norm (CC_EUCLIDEAN)" },
+	{ "EUC_3D", CC_EUCLIDEAN_3D, "Rounded Euclidean 3D Norm (CC_EUCLIDEAN_3D)" },
+	{ "MAX_2D", CC_MAXNORM, "Max Norm (CC_MAXNORM)" },
+	{ "MAN_2D", CC_MANNORM, "Manhattan Norm (CC_MANNORM)" },
+	{ "GEO", CC_GEOGRAPHIC, "Geographical Norm (CC_GEOGRAPHIC)" },
+	{ "GEOM", CC_GEOM, "Geographical Norm in Meters (CC_GEOM)" },
+	{ "ATT", CC_ATT, "ATT Norm (CC_ATT)" },
+	{ "CEIL_2D", CC_EUCLIDEAN_CEIL, "Rounded Up Euclidean Norm (CC_EUCLIDEAN_CEIL)" },
+	{ "DSJRAND", CC_DSJRANDNORM, "David Johnson Random Norm (CC_DSJRANDNORM)" },
+	{ NULL, 0, NULL }
+};
+
+/* Powers of ten that are exact in a double */
+static const double tsplib_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int is_space(int c)
+{
+	return (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+}
+
+static inline int is_digit(int c)
+{
+	return (c >= '0' && c <= '9');
+}
+
+static void skip_space(tsplib_buf *b)
+{
+	while (b->p < b->end && is_space(*b->p))
+		b->p++;
+}
+
+static void skip_line(tsplib_buf *b)
+{
+	while (b->p < b->end && *b->p != '\n')
+		b->p++;
+	if (b->p < b->end)
+		b->p++;
+}
+
+/**
+ *  Skips blanks up to the end of the line.
+ *
+ *  @return 1 if the line is over, 0 otherwise
+ */
+
+static int at_eol(tsplib_buf *b)
+{
+	while (b->p < b->end && (*b->p == ' ' || *b->p == '\t' || *b->p == '\r'))
+		b->p++;
+	return (b->p == b->end || *b->p == '\n');
+}
+
+/**
+ *  Reads an integer.
+ *
+ *  @return 1 if there is no integer at the cursor, 0 otherwise
+ */
+
+static int read_int(tsplib_buf *b, int *v)
+{
+	const char *p;
+	long n = 0;
+	int neg = 0;
+
+	skip_space(b);
+	p = b->p;
+	if (p < b->end && (*p == '-' || *p == '+'))
+		neg = (*p++ == '-');
+	if (p == b->end || !is_digit(*p))
+		return 1;
+	while (p < b->end && is_digit(*p))
+	{
+		n = n * 10 + (*p++ - '0');
+		if (n > INT_MAX)
+			return 1;
+	}
+	b->p = p;
+	*v = (int) (neg ? -n : n);
+	return 0;
+}
+
+/**
+ *  Reads a floating point number. Numbers with at most 15 significant
+ *  digits and a small exponent, that is all the coordinates one finds in
+ *  practice, are one multiplication or division of two exact doubles, hence
+ *  correctly rounded. Anything else goes through strtod.
+ *
+ *  @return 1 if there is no number at the cursor, 0 otherwise
+ */
+
+static int read_double(tsplib_buf *b, double *v)
+{
+	const char *p, *start;
+	unsigned long long m = 0;
+	int neg = 0, digits = 0, scale = 0, e = 0, eneg = 0, any = 0, exact = 1;
+	char token[64];
+
+	skip_space(b);
+	p = start = b->p;
+	if (p < b->end && (*p == '-' || *p == '+'))
+		neg = (*p++ == '-');
+	for (; p < b->end && is_digit(*p); p++, any = 1)
+	{
+		if (m || *p != '0')
+		{
+			if (++digits > 15)
+				exact = 0;
+			else
+				m = m * 10 + (*p - '0');
+		}
+	}
+	if (p < b->end && *p == '.')
+	{
+		for (p++; p < b->end && is_digit(*p); p++, any = 1)
+		{
+			if (m || *p != '0')
+			{
+				if (++digits > 15)
+					exact = 0;
+				else
+				{
+					m = m * 10 + (*p - '0');
+					scale--;
+				}
+			}
+			else
+				scale--;
+		}
+	}
+	if (!any)
+		return 1;
+	if (p < b->end && (*p == 'e' || *p == 'E'))
+	{
+		const char *q = p + 1;
+
+		if (q < b->end && (*q == '-' || *q == '+'))
+			eneg = (*q++ == '-');
+		if (q < b->end && is_digit(*q))
+		{
+			for (; q < b->end && is_digit(*q); q++)
+			{
+				if (e < 10000)
+					e = e * 10 + (*q - '0');
+			}
+			p = q;
+		}
+	}
+	b->p = p;
+
+	scale += (eneg ? -e : e);
+	if (exact && scale >= -22 && scale <= 22)
+	{
+		*v = (scale < 0 ? (double) m / tsplib_pow10[-scale] : (double) m * tsplib_pow10[scale]);
+		if (neg)
+			*v = -*v;
+		return 0;
+	}
+	if (p - start >= (long) sizeof(token))
+		return 1;
+	memcpy(token, start, p - start);
+	token[p - start] = '\0';
+	*v = strtod(token, NULL);
+	return 0;
+}
+
+/**
+ *  Reads the keyword at the start of a header line, up to a colon or a
+ *  space, as in <code>KEY: value</code>, <code>KEY : value</code> or
+ *  <code>KEY:value</code>.
+ */
+
+static void read_key(tsplib_buf *b, char *key)
+{
+	int n = 0;
+
+	skip_space(b);
+	while (b->p < b->end && !is_space(*b->p) && *b->p != ':' && *b->p != '#')
+	{
+		if (n < TSPLIB_FIELD - 1)
+			key[n++] = *b->p;
+		b->p++;
+	}
+	key[n] = '\0';
+}
+
+/**
+ *  Reads the value of a header line, without the colon and the surrounding
+ *  blanks, and moves to the next line.
+ */
+
+static void read_value(tsplib_buf *b, char *value)
+{
+	int n = 0;
+
+	while (b->p < b->end && (*b->p == ' ' || *b->p == '\t' || *b->p == ':'))
+		b->p++;
+	while (b->p < b->end && *b->p != '\n')
+	{
+		if (n < TSPLIB_FIELD - 1)
+			value[n++] = *b->p;
+		b->p++;
+	}
+	while (n > 0 && is_space(value[n - 1]))
+		n--;
+	value[n] = '\0';
+	skip_line(b);
+}
+
+/**
+ *  Maps a file in memory. If the file can't be mapped (it is empty, or it is
+ *  not a regular file) it is read in a buffer instead.
+ *
+ *  @param fname The file name
+ *  @param size The size of the file
+ *  @param mapped Set to 1 if the file was mapped, 0 if it was read
+ *  @return The contents of the file, NULL on failure
+ */
+
+static char *map_file(char *fname, size_t *size, int *mapped)
+{
+	struct stat st;
+	char *text = (char *) NULL;
+	size_t len = 0, cap = 0;
+	ssize_t got;
+	int fd;
+
+	if ((fd = open(fname, O_RDONLY)) < 0)
+		return (char *) NULL;
+	*mapped = 0;
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		text = (char *) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (text != (char *) MAP_FAILED)
+		{
+#ifdef MADV_SEQUENTIAL
+			madvise(text, st.st_size, MADV_SEQUENTIAL);
+#endif
+			close(fd);
+			*size = st.st_size;
+			*mapped = 1;
+			return text;
+		}
+		text = (char *) NULL;
+	}
+
+	for (;;)
+	{
+		if (len == cap)
+		{
+			char *grown = (char *) realloc(text, (cap = (cap ? 2 * cap : 65536)));
+			if (!grown)
+			{
+				free(text);
+				close(fd);
+				return (char *) NULL;
+			}
+			text = grown;
+		}
+		if ((got = read(fd, text + len, cap - len)) <= 0)
+			break;
+		len += got;
+	}
+	close(fd);
+	if (got < 0)
+	{
+		free(text);
+		return (char *) NULL;
+	}
+	*size = len;
+	return text;
+}
+
+static void unmap_file(char *text, size_t size, int mapped)
+{
+	if (mapped)
+		munmap(text, size);
+	else
+		free(text);
+}
+
+/**
+ *  Reads the EDGE_WEIGHT_SECTION in a single pass, straight into the packed
+ *  lower triangle of dat->adj, so the only memory used is the final matrix.
+ *  Lengths given above the diagonal are stored transposed. A FULL_MATRIX
+ *  must be symmetric: its upper triangle is kept, as Concorde only has
+ *  symmetric matrix norms, and the entries below the diagonal that don't
+ *  match it are counted in asymmetric.
+ */
+
+static int read_matrix(tsplib_buf *b, CCdatagroup *dat, int ncount, int matrixform,
+	long *asymmetric)
+{
+	int i, j, v, bad = 0;
+	size_t off;
+
+	*asymmetric = 0;
+	dat->adj = CC_SAFE_MALLOC (ncount, int *);
+	dat->adjspace = CC_SAFE_MALLOC ((size_t) ncount * (ncount + 1) / 2, int);
+	if (dat->adj == (int **) NULL || dat->adjspace == (int *) NULL)
+		return 1;
+	for (i = 0, off = 0; i < ncount; i++)
+	{
+		dat->adj[i] = dat->adjspace + off;
+		off += (i + 1);
+	}
+
+	for (i = 0; i < ncount && !bad; i++)
+	{
+		switch (matrixform)
+		{
+			case MATRIX_LOWER_DIAG_ROW:
+				for (j = 0; j <= i; j++)
+					bad |= read_int(b, &(dat->adj[i][j]));
+				break;
+			case MATRIX_LOWER_ROW:
+				for (j = 0; j < i; j++)
+					bad |= read_int(b, &(dat->adj[i][j]));
+				dat->adj[i][i] = 0;
+				break;
+			case MATRIX_UPPER_ROW:
+				dat->adj[i][i] = 0;
+				for (j = i + 1; j < ncount; j++)
+					bad |= read_int(b, &(dat->adj[j][i]));
+				break;
+			case MATRIX_UPPER_DIAG_ROW:
+				for (j = i; j < ncount; j++)
+					bad |= read_int(b, &(dat->adj[j][i]));
+				break;
+			default:
+				// Row i below the diagonal was stored by the rows before it
+				for (j = 0; j < i; j++)
+				{
+					bad |= read_int(b, &v);
+					if (v != dat->adj[i][j])
+						(*asymmetric)++;
+				}
+				for (j = i; j < ncount; j++)
+					bad |= read_int(b, &(dat->adj[j][i]));
+				break;
+		}
+	}
+	return bad;
+}
+
+/** Reads a TSPLIB file to a BEL_VRPData structure
+ *
+ *  This function reads a TSPLIB file and creates a BEL_VRPData structure
+ *	representing the given problem instance. The file is mapped in memory
+ *  and tokenized in place, and the numbers are parsed straight into the
+ *  coordinate, demand and depot arrays, so there is no per-line copy and no
+ *  stdio call per number. Keys may be followed by <code>:</code>,
+ *  <code> :</code> or nothing, lines may end with CR LF, and sections
+ *  that are not used (like DISPLAY_DATA_SECTION) are skipped.
+ *
+ *  @param datfile  The name of the TSPLIB file
+ *  @param data     The target BEL_VRPData structure to load data into.
+ *  @param verbose  Turns on lots of messages.
+ *  @return 1 on failure, 0 otherwise.
+ */
+
+int BEL_VRPReadTSPLIB(char *datfile, BEL_VRPData *data, int verbose)
+{
+	tsplib_buf b;
+	char key[TSPLIB_FIELD], value[TSPLIB_FIELD];
+	char *text;
+	size_t size;
+	int mapped;
+	int norm = -1;
+	int matrixform = MATRIX_LOWER_DIAG_ROW;
+	int ncount = -1;
+	int rval = 1;
+	int i, j, k;
+
+	if ((text = map_file(datfile, &size, &mapped)) == NULL)
+	{
+		fprintf(stderr, "Cannot open file %s for reading. Aborting\n", datfile);
+		return 1;
+	}
+	b.p = text;
+	b.end = text + size;
+
+	while (b.p < b.end)
+	{
+		read_key(&b, key);
+
+		// Numbers of a section we don't read, or a blank line
+		if (!key[0] || is_digit(key[0]) || key[0] == '-' || key[0] == '+' || key[0] == '.')
+		{
+			skip_line(&b);
+			continue;
+		}
+
+		if (!strcmp(key, "EOF"))
+			break;
+		else if (!strcmp(key, "NAME"))
+		{
+			read_value(&b, value);
+			free(data->name);
+			data->name = strdup(value);
+		}
+		else if (!strcmp(key, "TYPE"))
+		{
+			read_value(&b, value);
+			if (verbose)
+				printf("Problem type: %s\n", value);
+		}
+		else if (!strcmp(key, "COMMENT"))
+		{
+			read_value(&b, value);
+			free(data->comment);
+			data->comment = strdup(value);
+			if (verbose)
+				printf("%s\n", value);
+		}
+		else if (!strcmp(key, "DIMENSION"))
+		{
+			read_value(&b, value);
+			ncount = atoi(value);
+			if (ncount <= 0)
+			{
+				fprintf(stderr, "ERROR in DIMENSION line\n");
+				goto CLEANUP;
+			}
+			data->dimension = ncount;
+			if (verbose)
+				printf("Number of Nodes: %d\n", data->dimension);
+		}
+		else if (!strcmp(key, "CAPACITY"))
+		{
+			read_value(&b, value);
+			data->capacity = atoi(value);
+			if (verbose)
+				printf("Vehicle capacity: %d\n", data->capacity);
+		}
+		else if (!strcmp(key, "EDGE_WEIGHT_TYPE"))
+		{
+			read_value(&b, value);
+			for (i = 0; tsplib_norms[i].name && strcmp(tsplib_norms[i].name, value); i++)
+				;
+			if (!tsplib_norms[i].name)
+			{
+				fprintf(stderr, "ERROR: Not set up for norm %s\n", value);
+				goto CLEANUP;
+			}
+			norm = tsplib_norms[i].norm;
+			if (verbose)
+				printf("%s\n", tsplib_norms[i].description);
+			if (CCutil_dat_setnorm(data->dat, norm))
+			{
+				fprintf(stderr, "ERROR: Couldn't set norm %d\n", norm);
+				goto CLEANUP;
+			}
+		}
+		else if (!strcmp(key, "EDGE_WEIGHT_FORMAT"))
+		{
+			read_value(&b, value);
+			// A column of the lower triangle is a row of the upper one
+			if (!strcmp(value, "LOWER_DIAG_ROW") || !strcmp(value, "UPPER_DIAG_COL"))
+				matrixform = MATRIX_LOWER_DIAG_ROW;
+			else if (!strcmp(value, "LOWER_ROW") || !strcmp(value, "UPPER_COL"))
+				matrixform = MATRIX_LOWER_ROW;
+			else if (!strcmp(value, "UPPER_ROW") || !strcmp(value, "LOWER_COL"))
+				matrixform = MATRIX_UPPER_ROW;
+			else if (!strcmp(value, "UPPER_DIAG_ROW") || !strcmp(value, "LOWER_DIAG_COL"))
+				matrixform = MATRIX_UPPER_DIAG_ROW;
+			else if (!strcmp(value, "FULL_MATRIX"))
+				matrixform = MATRIX_FULL_MATRIX;
+			else if (strcmp(value, "FUNCTION"))
+			{
+				fprintf(stderr, "Cannot handle format: %s\n", value);
+				goto CLEANUP;
+			}
+		}
+		else if (!strcmp(key, "NODE_COORD_SECTION"))
+		{
+			int dim = norm & CC_NORM_SIZE_BITS;
+
+			skip_line(&b);
+			if (ncount <= 0)
+			{
+				fprintf(stderr, "ERROR: Dimension not specified\n");
+				goto CLEANUP;
+			}
+			if (data->dat->x != (double *) NULL)
+			{
+				fprintf(stderr, "ERROR: A second NODE_COORD_SECTION?\n");
+				goto CLEANUP;
+			}
+			if (dim != CC_D2_NORM_SIZE && dim != CC_D3_NORM_SIZE)
+			{
+				fprintf(stderr, "ERROR: Node coordinates with norm %d?\n", norm);
+				goto CLEANUP;
+			}
+			data->dat->x = CC_SAFE_MALLOC(ncount, double);
+			data->dat->y = CC_SAFE_MALLOC(ncount, double);
+			if (dim == CC_D3_NORM_SIZE)
+				data->dat->z = CC_SAFE_MALLOC(ncount, double);
+			if (!data->dat->x || !data->dat->y || (dim == CC_D3_NORM_SIZE && !data->dat->z))
+				goto CLEANUP;
+			for (i = 0; i < ncount; i++)
+			{
+				if (read_int(&b, &j) || read_double(&b, &(data->dat->x[i])) ||
+					read_double(&b, &(data->dat->y[i])) ||
+					(dim == CC_D3_NORM_SIZE && read_double(&b, &(data->dat->z[i]))))
+				{
+					fprintf(stderr, "ERROR: Malformed NODE_COORD_SECTION at node %d\n", i + 1);
+					goto CLEANUP;
+				}
+			}
+		}
+		else if (!strcmp(key, "EDGE_WEIGHT_SECTION"))
+		{
+			long asymmetric;
+
+			skip_line(&b);
+			if (ncount <= 0)
+			{
+				fprintf(stderr, "ERROR: Dimension not specified\n");
+				goto CLEANUP;
+			}
+			if (data->dat->adj != (int **) NULL)
+			{
+				fprintf(stderr, "ERROR: A second EDGE_WEIGHT_SECTION?\n");
+				goto CLEANUP;
+			}
+			if ((norm & CC_NORM_SIZE_BITS) != CC_MATRIX_NORM_SIZE)
+			{
+				fprintf(stderr, "ERROR: Matrix with norm %d?\n", norm);
+				goto CLEANUP;
+			}
+			if (read_matrix(&b, data->dat, ncount, matrixform, &asymmetric))
+			{
+				fprintf(stderr, "ERROR: Malformed EDGE_WEIGHT_SECTION\n");
+				goto CLEANUP;
+			}
+			if (asymmetric)
+				fprintf(stderr, "Warning: asymmetric FULL_MATRIX, %ld lengths below the diagonal ignored\n",
+					asymmetric);
+		}
+		else if (!strcmp(key, "FIXED_EDGES_SECTION"))
+		{
+			fprintf(stderr, "ERROR: Not set up for fixed edges\n");
+			goto CLEANUP;
+		}
+		else if (!strcmp(key, "DEMAND_SECTION"))
+		{
+			int demand;
+
+			skip_line(&b);
+			if (ncount <= 0)
+			{
+				fprintf(stderr, "ERROR: Dimension not specified\n");
+				goto CLEANUP;
+			}
+			if (data->demand != (int *) NULL)
+			{
+				fprintf(stderr, "ERROR: A second DEMAND_SECTION?\n");
+				goto CLEANUP;
+			}
+			data->demand = CC_SAFE_MALLOC(ncount, int);
+			if (!data->demand)
+				goto CLEANUP;
+			for (i = 0; i < ncount; i++)
+			{
+				if (read_int(&b, &j) || read_int(&b, &demand) || i != j - 1)
+				{
+					fprintf(stderr, "ERROR: Malformed DEMAND_SECTION. Found %d, expecting %d.\n", j - 1, i);
+					goto CLEANUP;
+				}
+				data->demand[i] = demand;
+			}
+		}
+		else if (!strcmp(key, "DEPOT_SECTION"))
+		{
+			int dep;
+
+			skip_line(&b);
+			if (!data->demand)
+			{
+				fprintf(stderr, "ERROR: Missing DEMAND_SECTION?\n");
+				goto CLEANUP;
+			}
+			if (data->depots != (int *) NULL)
+			{
+				fprintf(stderr, "ERROR: A second DEPOT_SECTION?\n");
+				goto CLEANUP;
+			}
+			data->isadepot = (int *) calloc(ncount, sizeof(int));
+			data->depots = CC_SAFE_MALLOC(ncount, int);
+			if (!data->isadepot || !data->depots)
+				goto CLEANUP;
+			k = 0;
+			for (;;)
+			{
+				if (read_int(&b, &dep))
+				{
+					fprintf(stderr, "ERROR: Malformed DEPOT_SECTION\n");
+					goto CLEANUP;
+				}
+				if (dep == -1)
+					break;
+				if (dep < 1 || dep > ncount || data->isadepot[dep - 1])
+				{
+					fprintf(stderr, "ERROR: Unexpected depot %d\n", dep);
+					goto CLEANUP;
+				}
+				// Assign 1 to identify this node as a depot
+				data->isadepot[dep - 1] = 1;
+
+				// Put this node in the depots list
+				data->depots[k++] = dep - 1;
+			}
+
+			// Customers may have no demand, the depots are the ones listed here
+			data->ndepots = k;
+			data->ncustomers = data->dimension - k;
+		}
+		else
+		{
+			// A keyword we don't need
+			skip_line(&b);
+		}
+	}
+	rval = 0;
+
+#ifdef DEBUG
+	for (i = 0; i < ncount && data->dat->x; i++)
+	{
+		printf("Coordinates: %.4lf, %.4lf, Demand: %d, Depot: %d\n", data->dat->x[i], data->dat->y[i], data->demand[i], data->isadepot[i]);
+	}
+#endif
+
+CLEANUP:
+	unmap_file(text, size, mapped);
+	return rval;
+}
+
+/** Reads a VRP solution from file in standard tourfile format.
+ *
+ *  Reads VRP solution from file and returns a BEL_VRPSolution structure
+ *  that holds the vehicle routes and the cost of the given solution. The
+ *  file is mapped and read in a single pass into two growing arrays, the
+ *  start of each route and the list of all its stops, so memory is linear in
+ *  the size of the solution whatever the number of nodes. Files that list
+ *  several solutions (<code>Solution 1:</code>, <code>Solution 2:</code>)
+ *  yield the first one. The load and the cost of each route are left to
+ *  BEL_EvaluateVRPSolution, which needs the instance.
+ *
+ *  @param datfile  The name of the input tourfile.
+ *  @param solution The BEL_VRPSolution structure to be filled with tour data.
+ *  @param nodes  The number of nodes in this VRP instance, 0 not to check the stops.
+ *  @param verbose  Turns on lots of messages.
+ *  @return 1 on failure, 0 otherwise.
+ */
+
+int BEL_VRPReadSolution(char *datfile, BEL_VRPSolution *solution, int nodes, int verbose)
+{
+	tsplib_buf b;
+	char key[TSPLIB_FIELD], value[TSPLIB_FIELD];
+	char *text;
+	size_t size, nstops = 0, maxstops = 0;
+	int mapped, nroutes = 0, maxroutes = 0, solutions = 0;
+	int r, v, rval = 1;
+	int *start = (int *) NULL;
+	int *stops = (int *) NULL;
+
+	if ((text = map_file(datfile, &size, &mapped)) == NULL)
+	{
+		fprintf(stderr, "Cannot open file %s for reading. Aborting\n", datfile);
+		return 1;
+	}
+	b.p = text;
+	b.end = text + size;
+	solution->cost = 0;
+
+	while (b.p < b.end)
+	{
+		read_key(&b, key);
+		if (!strcasecmp(key, "cost"))
+		{
+			read_value(&b, value);
+			solution->cost = atoi(value);
+			if (verbose)
+				printf("Cost: %d\n", solution->cost);
+		}
+		else if (!strcmp(key, "Solution"))
+		{
+			solutions++;
+			skip_line(&b);
+		}
+		else if (!strcmp(key, "Route") && solutions <= 1)
+		{
+			at_eol(&b);
+			if (b.p < b.end && *b.p == '#')
+			{
+				b.p++;
+				if (read_int(&b, &r))
+				{
+					fprintf(stderr, "ERROR in Route line\n");
+					goto CLEANUP;
+				}
+				// Routes are taken in the order they come, numbered or not
+				if (r != nroutes + 1 && verbose)
+					printf("Warning: Route #%d found, expecting #%d\n", r, nroutes + 1);
+			}
+			if (b.p < b.end && *b.p == ':')
+				b.p++;
+
+			if (nroutes + 1 >= maxroutes)
+			{
+				int *grown = (int *) realloc(start, (maxroutes = 2 * maxroutes + 16) * sizeof(int));
+				if (!grown)
+					goto NOMEM;
+				start = grown;
+			}
+			start[nroutes] = nstops;
+			while (!at_eol(&b))
+			{
+				if (read_int(&b, &v) || (nodes > 0 && (v < 0 || v >= nodes)))
+				{
+					fprintf(stderr, "ERROR in Route line %d\n", nroutes + 1);
+					goto CLEANUP;
+				}
+				if (nstops == maxstops)
+				{
+					int *grown = (int *) realloc(stops, (maxstops = 2 * maxstops + 1024) * sizeof(int));
+					if (!grown)
+						goto NOMEM;
+					stops = grown;
+				}
+				stops[nstops++] = v;
+			}
+			nroutes++;
+			skip_line(&b);
+		}
+		else
+			skip_line(&b);
+	}
+
+	/**
+	 *  The offsets and the stops are copied into the flat layout of the
+	 *  solution, the cost read above is kept.
+	 */
+
+	v = solution->cost;
+	if (BEL_AllocVRPSolution(solution, nroutes, nstops, (BEL_Arena *) NULL))
+		goto CLEANUP;
+	solution->cost = v;
+	if (nroutes)
+		memcpy(solution->start, start, nroutes * sizeof(int));
+	solution->start[nroutes] = nstops;
+	if (nstops)
+		memcpy(solution->nodes, stops, nstops * sizeof(int));
+	rval = 0;
+	goto CLEANUP;
+
+NOMEM:
+	fprintf(stderr, "Out of memory reading %s\n", datfile);
+CLEANUP:
+	free(start);
+	free(stops);
+	unmap_file(text, size, mapped);
+	return rval;
+}
@@ -0,0 +1,1122 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  tspsolve.c
+ *
+ *  Traveling Salesman Problem utilities for Beluga VRP solver, built on top
+ *  of Concorde TSP solver
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+
+#define CC_JUST_SUBTOUR (1) //!< See Concorde.
+#define CC_JUST_BLOSSOM (2) //!< See Concorde.
+#define CC_JUST_SUBTOUR_AND_BLOSSOM (3) //!< See Concorde.
+#define CC_JUST_FAST_CUTS (4) //!< See Concorde.
+
+/**
+ *  Function prototypes
+ */
+
+static int
+    handle_just_cuts (CCtsp_lp *lp, int the_cuts, CCrandstate *rstate,
+       int silent),
+    build_edges (int *p_ecount, int **p_elist, int **p_elen,
+        int ncount, int *ptour, CCdatagroup *dat, char *in_edgefname,
+        char *in_edgegenfname, int in_just_cuts, int silent,
+        CCrandstate *rstate),
+    build_fulledges (int *p_excount, int **p_exlist, int **p_exlen,
+        int ncount, int *ptour, char *in_fullfname),
+    find_tour (int ncount, CCdatagroup *dat, int *perm, double *ub,
+            int trials, int silent, CCrandstate *rstate),
+    getedges (CCdatagroup *dat, CCedgegengroup *plan, int ncount, int *ecount,
+            int **elist, int **elen, int silent, CCrandstate *rstate),
+    dump_rc (CCtsp_lp *lp, int count, char *pname, int usesparse);
+static void
+    adjust_upbound (double *bound, int ncount, CCdatagroup *dat, int silent);
+
+/** Initializes a BEL_TSPContext structure
+ *
+ *  Call this function to initialize a BEL_TSPContext structure before its use.
+ *  Sets every option to the defaults used by Beluga. Options can be changed
+ *  until the context is warmed up by BEL_WarmTSPContext or by the first call
+ *  to BEL_TSPSolve.
+ *
+ *  @param ctx  The BEL_TSPContext structure to be initialized
+ */
+
+void BEL_InitTSPContext(BEL_TSPContext *ctx)
+{
+    ctx->edgegenfname         = (char *) NULL;
+    ctx->problname            = (char *) NULL;
+    ctx->probfname            = (char *) NULL;
+    ctx->edgefname            = (char *) NULL;
+    ctx->fullfname            = (char *) NULL;
+    ctx->tourfname            = (char *) NULL;
+    ctx->poolfname            = (char *) NULL;
+    ctx->restartfname         = (char *) NULL;
+    ctx->xfname               = (char *) NULL;
+    ctx->outfname             = (char *) NULL;
+    ctx->filecutname          = (char *) NULL;
+    ctx->seed                 = 0;
+    ctx->just_cuts            = 0;
+    ctx->dontcutroot          = 0;
+    ctx->usetighten           = 0;
+    ctx->usedominos           = 0;
+    ctx->maxchunksize         = 16;
+    ctx->multiple_chunker     = 0;
+    ctx->valid_edges          = 0;
+    ctx->dfs_branching        = 0;
+    ctx->bfs_branching        = 1;
+    ctx->simple_branching     = 0;
+    ctx->usebranchcliques     = 1;
+    ctx->tentative_branch_num = 0;
+    ctx->complete_price       = 0;
+    ctx->want_rcnearest       = 0;
+    ctx->output_tour_as_edges = 0;
+    ctx->silent               = 1;
+    ctx->be_nethost           = 0;
+    ctx->unlink_files         = 0;
+    ctx->initial_ub           = CCtsp_LP_MAXDOUBLE;
+    ctx->hostport             = CCtsp_HOST_PORT;
+    ctx->eliminate_edges      = -1;
+    ctx->eliminate_sparse     = 0;
+    ctx->longedge_branching   = 1;
+    ctx->save_proof           = 0;
+    ctx->standalone_branch    = 0;
+    ctx->in_memory            = 0;
+    ctx->method               = BEL_TSP_EXACT;
+    ctx->warm                 = 0;
+}
+
+/** Warms up a BEL_TSPContext structure
+ *
+ *  Does the setup that the Concorde solver needs only once, no matter how
+ *  many instances are solved: prints the Concorde label, installs the signal
+ *  handlers and prepares the cut selection from the context options.
+ *  Call this before sharing the context among several threads.
+ *
+ *  @param ctx  The BEL_TSPContext structure to be warmed up
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_WarmTSPContext(BEL_TSPContext *ctx)
+{
+    if (ctx->warm) {
+        return 0;
+    }
+
+    CCutil_printlabel ();
+    CCutil_signal_init ();
+
+    CCtsp_init_cutselect (&ctx->sel);
+    CCtsp_init_tentative_cutselect (&ctx->tentativesel);
+    CCtsp_cutselect_tighten (&ctx->sel, ctx->usetighten);
+    CCtsp_cutselect_tighten (&ctx->tentativesel, ctx->usetighten);
+    CCtsp_cutselect_chunksize (&ctx->sel, ctx->maxchunksize);
+    CCtsp_cutselect_dominos (&ctx->sel, ctx->usedominos);
+    if (ctx->filecutname) CCtsp_cutselect_filecuts (&ctx->sel, ctx->filecutname);
+
+    ctx->warm = 1;
+    return 0;
+}
+
+/** Solves a TSP instance calling Concorde TSP solver.
+ *
+ *	This function accepts a CCdatagroup as input, the number of nodes in the tour 
+ *	and the name to identify the TSP instance. Returns the optimal tour to the caller
+ *	as a sequence of node indexes stored in an integer array.
+ *
+ *	Solver options are read from <code>ctx</code>, which is warmed up on first
+ *	use and never modified afterwards: a warm context can be shared by several
+ *	threads solving independent instances at the same time.
+ *
+ *	If <code>ctx->in_memory</code> is set, the master, tour, cut pool and
+ *	problem files are skipped and the branching is done depth first, keeping
+ *	the subproblems in memory. Only the optimal tour file is written, and only
+ *	if <code>ctx->outfname</code> asks for it. Bounds and statistics of
+ *	the solve are returned in <code>stats</code> rather than read back from
+ *	the files.
+ *
+ *  @param ctx  The TSP solver context
+ *  @param ncount Number of nodes in the tour
+ *  @param dat  TSP instance data
+ *  @param probname A name describing this TSP instance
+ *  @param stats  If not NULL, filled with bounds and statistics of the solve
+ *  @return	The optimal tour as a list of nodes, NULL on failure
+ */
+
+int *BEL_TSPSolve(BEL_TSPContext *ctx, int ncount, CCdatagroup *dat, char *probname,
+    BEL_TSPStats *stats)
+{
+    int i, rval = 0;
+    int status;
+    int ecount = 0;
+    int excount = 0;
+    int bbcount = 0;
+    int silent;
+    int dfs_branching, bfs_branching;
+    int small = 0;
+    int lprows = 0, lpcols = 0, lpnonzeros = 0;
+    int cutrounds = 0;
+    int *elist = (int *) NULL;
+    int *elen = (int *) NULL;
+    int *ptour = (int *) NULL;
+    int *exlist = (int *) NULL;
+    int *exlen = (int *) NULL;
+    int *besttour = (int *) NULL;
+
+    int is_infeasible = 0;
+    double szeit;
+    double upbound = 0.0;
+    double branchzeit = 0.0;
+    double ub;
+    double lowbound = 0.0;
+    char *pname;
+    char buf[1024];
+    unsigned short hostport;
+    CCtsp_cutselect sel, tentativesel;
+    CCrandstate rstate;
+    CCtsp_lp *lp = (CCtsp_lp *) NULL;
+    CCtsp_lpcuts *pool = (CCtsp_lpcuts *) NULL;
+    CCtsp_lpcuts *dominopool = (CCtsp_lpcuts *) NULL;
+
+    if (!ctx->warm && BEL_WarmTSPContext(ctx)) {
+        fprintf (stderr, "BEL_WarmTSPContext failed\n");
+        return (int *) NULL;
+    }
+
+    szeit = CCutil_zeit ();
+    silent = ctx->silent;
+
+    CCutil_sprand (ctx->seed, &rstate);
+    hostport = (ctx->be_nethost ? ctx->hostport : 0);
+
+    /**
+     *  Everything the solve changes is a local copy: the cut selection is
+     *  tuned on the LP by CCtsp_cutselect_set_tols, and the upper bound is
+     *  lowered by the starting tour.
+     */
+    sel = ctx->sel;
+    tentativesel = ctx->tentativesel;
+    ub = ctx->initial_ub;
+    pname = (ctx->problname ? ctx->problname : probname);
+
+    /* Best first branching keeps its subproblems on disk */
+    dfs_branching = ctx->dfs_branching;
+    bfs_branching = ctx->bfs_branching;
+    if (ctx->in_memory && bfs_branching) {
+        dfs_branching = 1;
+        bfs_branching = 0;
+    }
+
+        /* Handle small instances */
+
+        small = (ncount <= BEL_HK_MAXNODES);
+
+        if (ncount < 3) {
+            besttour = CC_SAFE_MALLOC (ncount, int);
+            CCcheck_NULL (besttour, "out of memory for besttour");
+            ptour = CC_SAFE_MALLOC (ncount, int);
+            CCcheck_NULL (ptour, "out of memory for ptour");
+            if (!silent)
+                printf("I wish everything was that easy!!\n");
+            for (i = 0; i < ncount; i++)
+            {
+              besttour[i] = i;
+              ptour[i] = i;
+            }
+            goto CLEANUP;
+        } else if (ncount <= BEL_HK_MAXNODES) {
+            besttour = CC_SAFE_MALLOC (ncount, int);
+            CCcheck_NULL (besttour, "out of memory for besttour");
+            ptour = CC_SAFE_MALLOC (ncount, int);
+            CCcheck_NULL (ptour, "out of memory for ptour");
+            for (i = 0; i < ncount; i++) ptour[i] = i;
+            if (ncount == 3) {
+                if (!silent)
+                    printf("This one is easy, baby!\n");
+                for (i = 0; i < ncount; i++) besttour[i] = i;
+            } else {
+                int hk_val;
+
+                rval = BEL_HeldKarpSolve (ncount, dat, besttour, &hk_val);
+                CCcheck_rval (rval, "BEL_HeldKarpSolve failed");
+                if (!silent) {
+                    printf ("Optimal Solution: %d\n", hk_val); fflush (stdout);
+                }
+            }
+            if (!ctx->in_memory || ctx->outfname) {
+                rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
+                                       ctx->outfname, ctx->output_tour_as_edges, silent);
+                CCcheck_rval (rval, "CCtsp_dumptour failed");
+            }
+            if (!silent) {
+                printf ("Total Running Time: %.2f (seconds)\n",
+                         CCutil_zeit () - szeit);
+                fflush (stdout);
+            }
+#ifdef DEBUG
+    print_array(ncount, besttour, "besttour");
+    print_array(ncount, ptour, "ptour");
+#endif
+
+            goto CLEANUP;
+        } else if (ctx->method != BEL_TSP_EXACT) {
+            double bnd;
+
+            /* The fast path: no LP, a starting tour improved by 2-opt and Or-opt */
+            besttour = CC_SAFE_MALLOC (ncount, int);
+            CCcheck_NULL (besttour, "out of memory for besttour");
+            ptour = CC_SAFE_MALLOC (ncount, int);
+            CCcheck_NULL (ptour, "out of memory for ptour");
+            for (i = 0; i < ncount; i++) ptour[i] = i;
+            if (ctx->method == BEL_TSP_LINKERN) {
+                rval = find_tour (ncount, dat, besttour, &bnd, 0, silent,
+                                  &rstate);
+                CCcheck_rval (rval, "find_tour failed");
+            } else {
+                rval = BEL_NearestNeighborTour (ncount, dat, besttour);
+                CCcheck_rval (rval, "BEL_NearestNeighborTour failed");
+            }
+            rval = BEL_TwoOptTour (ncount, dat, besttour, BEL_TWOOPT_NEIGHBORS);
+            CCcheck_rval (rval, "BEL_TwoOptTour failed");
+            if (!ctx->in_memory || ctx->outfname) {
+                rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
+                                       ctx->outfname, ctx->output_tour_as_edges, silent);
+                CCcheck_rval (rval, "CCtsp_dumptour failed");
+            }
+            goto CLEANUP;
+        }
+        /***** Get the permutation tour and permute the data  *****/
+
+        ptour = CC_SAFE_MALLOC (ncount, int);
+        CCcheck_NULL (ptour, "out of memory for ptour");
+
+        if (ctx->tourfname) {
+            rval = CCutil_getcycle (ncount, ctx->tourfname, ptour, 0);
+            CCcheck_rval (rval, "CCutil_getcycle failed");
+        } else {
+            double bnd;
+            if (ctx->just_cuts > 0) {
+                rval = find_tour (ncount, dat, ptour, &bnd, -1, silent,
+                                  &rstate);
+            } else if (ub == CCtsp_LP_MAXDOUBLE) {
+                rval = find_tour (ncount, dat, ptour, &bnd, 1, silent,
+                                  &rstate);
+            } else {
+                if (!silent) {
+                    printf ("Initial bnd %f - use short LK\n", ub);
+                    fflush (stdout);
+                }
+                rval = find_tour (ncount, dat, ptour, &bnd, 0, silent,
+                                 &rstate);
+            }
+            CCcheck_rval (rval, "find_tour failed");
+        }
+        rval = CCutil_datagroup_perm (ncount, dat, ptour);
+        CCcheck_rval (rval, "CCutil_datagroup_perm failed");
+
+        if (!ctx->in_memory) {
+            sprintf (buf, "%s.mas", probname);
+            rval = CCutil_putmaster (buf, ncount, dat, ptour);
+            CCcheck_rval (rval, "CCutil_putmaster failed");
+        }
+    adjust_upbound (&ub, ncount, dat, silent);
+    if (!ctx->probfname && !ctx->restartfname) {
+        rval = build_edges (&ecount, &elist, &elen, ncount, ptour,
+                            dat, ctx->edgefname, ctx->edgegenfname, ctx->just_cuts,
+                            silent, &rstate);
+        CCcheck_rval (rval, "build_edges failed");
+    }
+
+    rval = build_fulledges (&excount, &exlist, &exlen, ncount, ptour,
+                            ctx->fullfname);
+    CCcheck_rval (rval, "build_fulledges failed");
+    rval = CCtsp_init_cutpool (&ncount, ctx->poolfname, &pool);
+    CCcheck_rval (rval, "CCtsp_init_cutpool failed");
+#ifdef CCtsp_USE_DOMINO_CUTS
+    rval = CCtsp_init_cutpool (&ncount, dominopoolfname, &dominopool);
+    CCcheck_rval (rval, "CCtsp_init_cutpool failed for dominos");
+#endif
+
+    /***** Initialize besttour to be the permutation tour  ****/
+
+    besttour = CC_SAFE_MALLOC (ncount, int);
+#ifdef DEBUG
+    print_array(ncount, besttour, "besttour");
+    print_array(ncount, ptour, "ptour");
+#endif
+    CCcheck_NULL (besttour, "out of memory for besttour");
+    for (i = 0; i < ncount; i++) {
+        besttour[i] = i;
+    }
+    if (ctx->restartfname) {
+        upbound  = ub;
+        bbcount = 0;
+
+        rval = CCtsp_bfs_restart (pname, ctx->restartfname, &sel,
+                &tentativesel, &upbound, &bbcount, ctx->usebranchcliques, dat,
+                ptour, pool, ncount, besttour, hostport, &branchzeit,
+                ctx->save_proof, ctx->tentative_branch_num, ctx->longedge_branching,
+                (double *) NULL, (int *) NULL, silent, &rstate);
+        CCcheck_rval (rval, "CCtsp_bfs_restart failed");
+        goto DONE;
+    }
+    if (!ctx->in_memory) {
+        rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
+                               (char *) NULL, 0, silent);
+        CCcheck_rval (rval, "CCtsp_dumptour failed");
+    }
+    rval = CCtsp_init_lp (&lp, pname, -1, ctx->probfname, ncount, dat,
+                    ecount, elist, elen, excount, exlist, exlen, ctx->valid_edges,
+                    ptour, ub, pool, dominopool, silent, &rstate);
+    if (rval == 2) {
+        if (!silent)
+            printf ("CCtsp_init_lp reports an infeasible LP\n");
+        rval = CCtsp_verify_infeasible_lp (lp, &is_infeasible, silent);
+        CCcheck_rval (rval, "CCtsp_verify_infeasible_lp failed");
+        if (!is_infeasible) {
+            fprintf (stderr, "Couldn't verify infeasible LP\n");
+            rval = 1; goto CLEANUP;
+        }
+        upbound = CCtsp_LP_MAXDOUBLE;
+        bbcount = 1;
+        goto DONE;
+    } else if (rval) {
+        fprintf (stderr, "CCtsp_init_lp failed\n"); goto CLEANUP;
+    }
+    CCutil_start_timer (&lp->stats.total);
+
+    ecount = 0;
+    CC_IFFREE (elist, int);
+    CC_IFFREE (elen, int);
+    excount = 0;
+    CC_IFFREE (exlist, int);
+    CC_IFFREE (exlen, int);
+    if (0 && lp->full_edges_valid) {
+        if (CCtsp_inspect_full_edges (lp)) {
+            fprintf (stderr, "full edge set does not contain all LP edges\n");
+            rval = 1; goto CLEANUP;
+        }
+    }
+    if (ctx->standalone_branch) {
+        rval = CCtsp_do_interactive_branch (lp, silent, &rstate);
+        CCcheck_rval (rval, "CCtsp_do_interactive_branch failed");
+        if (!silent)
+            printf ("Total Running Time: %.2f (seconds)\n", CCutil_zeit () - szeit);
+        goto CLEANUP;
+    }
+
+    if (ctx->just_cuts > 0) {
+        rval = handle_just_cuts (lp, ctx->just_cuts, &rstate, silent);
+        CCcheck_rval (rval, "handle_just_cuts failed");
+        if (ctx->want_rcnearest) {
+            rval = dump_rc (lp, ctx->want_rcnearest, probname, 0);
+            CCcheck_rval (rval, "dump_rc failed");
+        }
+        if (ctx->xfname) {
+            rval = CCtsp_dump_x (lp, ctx->xfname);
+            CCcheck_rval (rval, "CCtsp_dump_x failed");
+        }
+        goto DONE;
+    }
+
+    rval = CCtsp_cutselect_set_tols (&sel, lp, 1, silent);
+    CCcheck_rval (rval, "CCtsp_cutselect_set_tols failed");
+
+    if (ctx->dontcutroot == 0) {
+        if (ctx->multiple_chunker) {
+            rval = CCtsp_cutting_multiple_loop (lp, &sel, 1, ctx->maxchunksize,
+                                    1, silent, &rstate);
+        } else {
+            rval = CCtsp_cutting_loop (lp, &sel, 1, silent, &rstate);
+        }
+        if (rval == 2) {
+            if (!silent)
+                printf ("CCtsp_cutting_loop reports an infeasible LP\n");
+            rval = CCtsp_verify_infeasible_lp (lp, &is_infeasible, silent);
+            CCcheck_rval (rval, "CCtsp_verify_infeasible_lp failed");
+            if (!is_infeasible) {
+                fprintf (stderr, "Couldn't verify infeasibile LP\n");
+                rval = 1; goto CLEANUP;
+            }
+            upbound = CCtsp_LP_MAXDOUBLE;
+            bbcount = 1;
+            CCutil_stop_timer (&lp->stats.total, !silent);
+            if (!silent)
+                printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
+                        CClp_nrows (lp->lp), CClp_ncols (lp->lp),
+                        CClp_nnonzeros (lp->lp));
+
+            goto DONE;
+        } else if (rval) {
+            fprintf (stderr, "cutting_loop failed\n");
+            goto CLEANUP;
+        }
+    }
+
+        double tourval;
+        CCutil_start_timer (&lp->stats.linkern);
+        rval = CCtsp_call_x_heuristic (lp, &tourval, besttour, silent, &rstate);
+        CCcheck_rval (rval, "CCtsp_call_x_heuristic failed");
+
+        if (!silent) CCutil_stop_timer (&lp->stats.linkern, 1);
+        else         CCutil_stop_timer (&lp->stats.linkern, 0);
+
+        if (tourval < lp->upperbound) {
+            if (!silent)
+                printf ("New upperbound from x-heuristic: %.2f\n", tourval);
+            lp->upperbound = tourval;
+            if (!ctx->in_memory) {
+                rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
+                                       (char *) NULL, 0, silent);
+                CCcheck_rval (rval, "CCtsp_dumptour failed");
+            }
+        }
+        if (!silent) {
+            printf ("Final lower bound %f, upper bound %f\n", lp->lowerbound,
+                                                              lp->upperbound);
+            fflush (stdout);
+        }
+
+    if (ctx->xfname) {
+        rval = CCtsp_dump_x (lp, ctx->xfname);
+        CCcheck_rval (rval, "CCtsp_dump_x failed");
+    }
+    if (ctx->want_rcnearest) {
+        rval = dump_rc (lp, ctx->want_rcnearest, probname, 0);
+        CCcheck_rval (rval, "dump_rc failed");
+    }
+
+    if (lp->graph.ncount < 100000 || ctx->complete_price) {
+        CCbigguy bound;
+        CCbigguy bupper;
+        rval = CCtsp_exact_price (lp, &bound, ctx->complete_price, 0, silent);
+        if (rval) {
+            fprintf (stderr, "CCtsp_exact_price failed\n");
+            goto CLEANUP;
+        }
+        lp->exact_lowerbound = bound;
+        if (!silent) {
+            printf ("Exact lower bound: %.6f\n", CCbigguy_bigguytod (bound));
+            printf ("DIFF: %f\n", lp->lowerbound - CCbigguy_bigguytod (bound));
+            fflush (stdout);
+        }
+
+        bupper = CCbigguy_dtobigguy (lp->upperbound);
+        CCbigguy_sub (&bupper, CCbigguy_ONE);
+
+        if (CCbigguy_cmp (lp->exact_lowerbound, bupper) > 0) {
+            upbound = lp->upperbound;
+            bbcount = 1;
+            if (!dfs_branching && !bfs_branching && !silent) {
+                printf ("Optimal Solution: %.2f\n", upbound);
+                printf ("Number of bbnodes: %d\n", bbcount);
+                fflush (stdout);
+            }
+            if (!silent) {
+                CCutil_stop_timer (&lp->stats.total, 1);
+            } else {
+                CCutil_stop_timer (&lp->stats.total, 0);
+            }
+            if (!silent)
+                printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
+                        CClp_nrows (lp->lp), CClp_ncols (lp->lp),
+                        CClp_nnonzeros (lp->lp));
+
+            if (dat->ndepot > 0) {
+                rval = CCtsp_depot_valid (lp, dat->ndepot, (int *) NULL);
+                CCcheck_rval (rval, "CCtsp_depot_valid failed");
+            }
+            goto DONE;
+        }
+
+        if (dat->ndepot == 0 && ctx->eliminate_edges) {
+            rval = CCtsp_eliminate_variables (lp, ctx->eliminate_sparse, silent);
+            CCcheck_rval (rval, "CCtsp_eliminate_variables failed");
+        }
+    } else {
+        CCutil_stop_timer (&lp->stats.total, !silent);
+        if (!silent) {
+            printf ("During testing, do not exact price large problems\n");
+            printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
+                    CClp_nrows (lp->lp), CClp_ncols (lp->lp),
+                    CClp_nnonzeros (lp->lp));
+            fflush (stdout);
+        }
+
+        goto DONE;
+    }
+#ifdef DEBUG
+  	print_array(ncount, besttour, "besttour");
+    print_array(ncount, ptour, "ptour");
+#endif
+    CCutil_stop_timer (&lp->stats.total, !silent);
+    if (!silent) {
+        printf ("Final LP has %d rows, %d columns, %d nonzeros\n",
+                CClp_nrows (lp->lp), CClp_ncols (lp->lp),
+                CClp_nnonzeros (lp->lp));
+        fflush (stdout);
+    }
+
+    if (dat->ndepot > 0) {
+        rval = CCtsp_depot_valid (lp, dat->ndepot, (int *) NULL);
+        CCcheck_rval (rval, "CCtsp_depot_valid failed");
+        goto DONE;
+    }
+
+    if (dfs_branching) {
+        upbound = lp->upperbound;
+        bbcount = 0;
+
+        if (ctx->simple_branching) CCtsp_init_simple_cutselect (&sel);
+        rval = CCtsp_easy_dfs_brancher (lp, &sel, 0, &upbound, &bbcount,
+                     ctx->usebranchcliques, besttour, ctx->longedge_branching,
+                     ctx->simple_branching, silent, &rstate);
+        CCcheck_rval (rval, "CCtsp_easy_dfs_brancher failed");
+    } else if (bfs_branching) {
+        int id          = lp->id;
+
+        lowbound = lp->lowerbound;
+        upbound  = lp->upperbound;
+        bbcount = 0;
+
+        lprows = CClp_nrows (lp->lp);
+        lpcols = CClp_ncols (lp->lp);
+        lpnonzeros = CClp_nnonzeros (lp->lp);
+        rval = CCtsp_write_probroot_id (pname, lp);
+        CCcheck_rval (rval, "CCtsp_write_probroot_id failed");
+        CCtsp_free_tsp_lp_struct (&lp);
+
+        rval = CCtsp_bfs_brancher (pname, id, lowbound, &sel,
+                &tentativesel, &upbound, &bbcount, ctx->usebranchcliques, dat,
+                ptour, pool, ncount, besttour, hostport, &branchzeit,
+                ctx->save_proof, ctx->tentative_branch_num, ctx->longedge_branching,
+                (double *) NULL, (int *) NULL, silent, &rstate);
+        CCcheck_rval (rval, "CCtsp_bfs_brancher failed");
+    }
+
+DONE:
+#ifdef DEBUG
+    print_array(ncount, besttour, "besttour");
+    print_array(ncount, ptour, "ptour");
+#endif
+    if (lp) {
+        lowbound = lp->lowerbound;
+        lprows = CClp_nrows (lp->lp);
+        lpcols = CClp_ncols (lp->lp);
+        lpnonzeros = CClp_nnonzeros (lp->lp);
+    }
+    if (dfs_branching || bfs_branching || ctx->restartfname) {
+        if (!silent) {
+            printf ("Optimal Solution: %.2f\n", upbound);
+            printf ("Number of bbnodes: %d\n", bbcount);
+            fflush (stdout);
+        }
+        lowbound = upbound;
+        if (!ctx->in_memory || ctx->outfname) {
+            rval = CCtsp_dumptour (ncount, dat, ptour, probname, besttour,
+                                   ctx->outfname, ctx->output_tour_as_edges, silent);
+            CCcheck_rval (rval, "CCtsp_dumptour failed");
+        }
+    } else if (!ctx->in_memory) {
+        rval = CCtsp_write_probfile_sav (lp);
+        CCcheck_rval (rval, "CCtsp_write_probfile_sav failed");
+    }
+
+    if (!silent) {
+        printf ("Total Running Time: %.2f (seconds)", CCutil_zeit () - szeit);
+        if (branchzeit != 0.0) {
+            printf ("  Branching Time: %.2f (seconds)", branchzeit);
+        }
+        printf ("\n"); fflush (stdout);
+    }
+
+    /*  CCtsp_output_statistics (&lp->stats);  */
+
+    if (pool && pool->cutcount && !ctx->in_memory) {
+        if (!silent) {
+            printf ("Final Pool: %d cuts\n", pool->cutcount); fflush (stdout);
+        }
+        sprintf (buf, "%s.pul", probname);
+        rval = CCtsp_write_cutpool (ncount, buf, pool);
+        CCcheck_rval (rval, "CCtsp_write_cutpool failed");
+    }
+
+#ifdef CCtsp_USE_DOMINO_CUTS
+    if (dominopool && dominopool->cutcount && !ctx->in_memory) {
+        if (!silent) {
+            printf ("Final Domino Pool: %d cuts\n", dominopool->cutcount);
+            fflush (stdout);
+        }
+        sprintf (buf, "%s.dominopul", probname);
+        rval = CCtsp_write_cutpool (ncount, buf, dominopool);
+        CCcheck_rval (rval, "CCtsp_write_cutpool failed");
+    }
+#endif
+
+    if (sel.remotepool && pool && pool->cutcount > pool->savecount) {
+        rval = CCtsp_send_newcuts (ncount, pool, sel.remotehost,
+                sel.remoteport);
+        if (rval) {
+            fprintf (stderr, "CCtsp_send_newcuts failed\n");
+            rval = 0;
+        }
+    }
+
+    rval = 0;
+
+CLEANUP:
+
+    /* The unlinks below reuse rval */
+    status = rval;
+
+    if (ctx->unlink_files && !ctx->in_memory) {
+        if (!ctx->silent) {
+            printf ("Delete the temporary files: pul sav mas\n");
+            fflush (stdout);
+        }
+
+        sprintf (buf, "%s.pul", probname);
+        rval = unlink (buf);
+        if (rval && !ctx->silent) {
+            printf ("CCutil_sdelete_file failed for %s\n", buf);
+        }
+
+        sprintf (buf, "O%s.pul", probname);
+        rval = unlink (buf);
+        if (rval && !ctx->silent) {
+            printf ("CCutil_sdelete_file failed for %s\n", buf);
+        }
+
+        sprintf (buf, "%s.sav", probname);
+        rval = unlink (buf);
+        if (rval && !ctx->silent) {
+            printf ("CCutil_sdelete_file failed for %s\n", buf);
+        }
+
+        sprintf (buf, "O%s.sav", probname);
+        rval = unlink (buf);
+        if (rval && !ctx->silent) {
+            printf ("CCutil_sdelete_file failed for %s\n", buf);
+        }
+
+        sprintf (buf, "%s.mas", probname);
+        rval = unlink (buf);
+        if (rval && !ctx->silent) {
+            printf ("CCutil_sdelete_file failed for %s\n", buf);
+        }
+
+        sprintf (buf, "O%s.mas", probname);
+        rval = unlink (buf);
+        if (rval && !ctx->silent) {
+            printf ("CCutil_sdelete_file failed for %s\n", buf);
+        }
+    }
+
+    if (lp) {
+        cutrounds = lp->stats.cutting_inner_loop.count;
+        CCtsp_free_tsp_lp_struct (&lp);
+    }
+    if (pool) { CCtsp_free_cutpool (&pool); }
+    if (dominopool) { CCtsp_free_cutpool (&dominopool); }
+
+	int k, *tour = (int *) NULL;
+	if (!status && ptour && besttour)
+		tour = (int *)calloc(ncount, sizeof(int));
+	
+    if (tour)
+    {
+        int r = 0;
+
+        // Callers take tour[0] as the depot, whatever the tour started from
+        while (r < ncount - 1 && ptour[besttour[r]] != 0)
+            r++;
+        for (k = 0; k < ncount; k++)
+        {
+		tour[k] = ptour[besttour[(r + k) % ncount]];
+        }
+#ifdef DEBUG
+	print_array(ncount, tour, "tour");
+#endif
+    }
+
+    if (tour && stats) {
+        stats->upperbound = 0.0;
+        for (k = 0; k < ncount; k++) {
+            stats->upperbound += CCutil_dat_edgelen (besttour[k],
+                                    besttour[(k + 1) % ncount], dat);
+        }
+        // Small instances are solved to optimality without an LP
+        stats->lowerbound = (small ? stats->upperbound : lowbound);
+        stats->bbnodes = bbcount;
+        stats->lprows = lprows;
+        stats->lpcols = lpcols;
+        stats->lpnonzeros = lpnonzeros;
+        stats->cutrounds = cutrounds;
+        stats->time = CCutil_zeit () - szeit;
+    }
+
+    CC_IFFREE (elist, int);
+    CC_IFFREE (elen, int);
+    CC_IFFREE (exlist, int);
+    CC_IFFREE (exlen, int);
+    CC_IFFREE (ptour, int);
+    CC_IFFREE (besttour, int);
+
+    return tour;
+}
+
+/**
+ *  See Concorde for details.
+ *
+ *  @see Concorde source
+ */
+
+static int handle_just_cuts (CCtsp_lp *lp, int the_cuts, CCrandstate *rstate,
+       int silent)
+{
+    int rval = 0;
+    CCtsp_cutselect sel;
+
+    if (the_cuts == CC_JUST_FAST_CUTS) {
+        CCtsp_init_fast_cutselect (&sel);
+        rval = CCtsp_cutselect_set_tols (&sel, lp, -1, silent);
+        CCcheck_rval (rval, "CCtsp_cutselect_set_tols failed");
+        rval = CCtsp_cutting_loop (lp, &sel, 1, silent, rstate);
+        CCcheck_rval (rval, "CCtsp_cutting_loop failed");
+    } else if (the_cuts == CC_JUST_SUBTOUR) {
+        rval = CCtsp_subtour_loop (lp, silent, rstate);
+        CCcheck_rval (rval, "CCtsp_subtour_loop failed");
+    } else if (the_cuts == CC_JUST_BLOSSOM) {
+        rval = CCtsp_blossom_loop (lp, silent, rstate);
+        CCcheck_rval (rval, "CCtsp_blossom_loop failed");
+    } else if (the_cuts == CC_JUST_SUBTOUR_AND_BLOSSOM) {
+        rval = CCtsp_subtour_and_blossom_loop (lp, silent, rstate);
+        CCcheck_rval (rval, "CCtsp_subtour_and_blossom_loop failed");
+    }
+
+    printf ("Bound: %f\n", lp->lowerbound); fflush (stdout);
+    CCutil_stop_timer (&lp->stats.total, 1);
+    printf ("Final Root LP has %d rows, %d columns, %d nonzeros\n",
+            CClp_nrows (lp->lp), CClp_ncols (lp->lp), CClp_nnonzeros (lp->lp));
+
+CLEANUP:
+
+    return rval;
+}
+
+/**
+ *  See Concorde for details.
+ *
+ *  @see Concorde source
+ */
+
+static void adjust_upbound (double *bound, int ncount, CCdatagroup *dat, int silent)
+{
+    double bnd;
+    int i;
+
+    bnd = CCutil_dat_edgelen (ncount - 1, 0, dat);
+    for (i = 1; i < ncount; i++) {
+        bnd += CCutil_dat_edgelen (i-1, i, dat);
+    }
+    if (bnd < *bound) {
+        if (!silent)
+            printf ("Set initial upperbound to %.0f (from tour)\n", bnd);
+        fflush (stdout);
+        *bound = bnd;
+    }
+}
+
+/**
+ *  See Concorde for details.
+ *
+ *  @see Concorde source
+ */
+
+static int build_edges (int *p_ecount, int **p_elist, int **p_elen,
+        int ncount, int *ptour, CCdatagroup *dat, char *in_edgefname,
+        char *in_edgegenfname, int in_just_cuts, int silent,
+        CCrandstate *rstate)
+{
+    int rval = 0;
+    int *elist = (int *) NULL;
+    int ecount;
+    int i;
+
+    if (in_edgefname) {
+        int *invperm = (int *) NULL;
+
+        printf ("Read initial edge set\n"); fflush (stdout);
+
+        rval = CCutil_getedgelist (ncount, in_edgefname, p_ecount, p_elist,
+                                   p_elen, 0);
+        CCcheck_rval (rval, "CCutil_getedgelist failed");
+        ecount = *p_ecount;
+        elist = *p_elist;
+        printf ("Initial edgeset: %d edges (%d nodes)\n", ecount, ncount);
+        printf ("Rearrange the edges to match the tour order\n");
+        fflush (stdout);
+
+        invperm = CC_SAFE_MALLOC (ncount, int);
+        CCcheck_NULL (invperm, "out of memory for invperm");
+        for (i = 0; i < ncount; i++) invperm[ptour[i]] = i;
+        for (i = 0; i < 2*ecount; i++) elist[i] = invperm[elist[i]];
+        CC_FREE (invperm, int);
+    } else if (dat) {
+        CCedgegengroup plan;
+
+        if (in_edgegenfname) {
+            rval = CCedgegen_read (in_edgegenfname, &plan);
+            CCcheck_rval (rval, "CCedgegen_read failed");
+        } else {
+            CCedgegen_init_edgegengroup (&plan);
+            if (in_just_cuts == CC_JUST_SUBTOUR ||
+                in_just_cuts == CC_JUST_BLOSSOM ||
+                in_just_cuts == CC_JUST_SUBTOUR_AND_BLOSSOM) {
+                plan.tour.greedy = 1;
+                plan.f2match_nearest.number = 4;
+            } else {
+                plan.linkern.count = 10;
+                plan.linkern.quadnearest = 2;
+                plan.linkern.greedy_start = 0;
+                plan.linkern.nkicks = (ncount / 100) + 1;
+            }
+        }
+
+        rval = getedges (dat, &plan, ncount, p_ecount, p_elist, p_elen,
+                         silent, rstate);
+        CCcheck_rval (rval, "getedges failed");
+    }
+
+CLEANUP:
+
+    return rval;
+}
+
+/**
+ *  See Concorde for details.
+ *
+ *  @see Concorde source
+ */
+
+static int build_fulledges (int *p_excount, int **p_exlist, int **p_exlen,
+        int ncount, int *ptour, char *in_fullfname)
+{
+    int i;
+    int rval = 0;
+    int *exlist;
+    int excount;
+
+    if (in_fullfname) {
+        int *invperm = (int *) NULL;
+
+        rval = CCutil_getedgelist (ncount, in_fullfname, p_excount, p_exlist,
+                                   p_exlen, 0);
+        CCcheck_rval (rval, "CCutil_getedgelist failed");
+
+        invperm = CC_SAFE_MALLOC (ncount, int);
+        CCcheck_NULL (invperm, "out of memory for invperm");
+        for (i = 0; i < ncount; i++) invperm[ptour[i]] = i;
+        excount = *p_excount;
+        exlist = *p_exlist;
+        for (i = 0; i < 2*excount; i++) exlist[i] = invperm[exlist[i]];
+        CC_FREE (invperm, int);
+    } else {
+        *p_excount = 0;
+    }
+
+CLEANUP:
+
+    return rval;
+}
+
+/**
+ *  See Concorde for details.
+ *
+ *  @see Concorde source
+ */
+
+static int find_tour (int ncount, CCdatagroup *dat, int *perm, double *ub,
+        int trials, int silent, CCrandstate *rstate)
+{
+    int rval = 0;
+    CCedgegengroup plan;
+    int ecount;
+    int *elist = (int *) NULL;
+    int tcount;
+    int *tlist = (int *) NULL;
+    int *bestcyc = (int *) NULL;
+    int *cyc     = (int *) NULL;
+    int *tmp;
+    double val, bestval, szeit;
+    int kicks, i, istour;
+
+    szeit = CCutil_zeit ();
+    bestval = CCtsp_LP_MAXDOUBLE;
+
+    if (trials == -1) {
+        kicks = (ncount > 400 ? 100 : ncount/4);
+    } else {
+        kicks = (ncount > 1000 ? 500 : ncount/2);
+    }
+
+    if (!silent) {
+        printf ("Finding a good tour for compression: %d\n", trials);
+        fflush (stdout);
+    }
+
+    cyc = CC_SAFE_MALLOC (ncount, int);
+    CCcheck_NULL (cyc, "out of memory for cyc");
+    bestcyc = CC_SAFE_MALLOC (ncount, int);
+    CCcheck_NULL (bestcyc, "out of memory for bestcyc");
+
+    CCedgegen_init_edgegengroup (&plan);
+    plan.quadnearest = 2;
+    rval = CCedgegen_edges (&plan, ncount, dat, (double *) NULL, &ecount,
+                            &elist, silent, rstate);
+    CCcheck_rval (rval, "CCedgegen_edges failed");
+    plan.quadnearest = 0;
+
+    plan.tour.greedy = 1;
+    rval = CCedgegen_edges (&plan, ncount, dat, (double *) NULL, &tcount,
+                            &tlist, silent, rstate);
+    CCcheck_rval (rval, "CCedgegen_edges failed");
+
+    if (tcount != ncount) {
+        fprintf (stderr, "wrong edgeset from CCedgegen_edges\n");
+        rval = 1; goto CLEANUP;
+    }
+
+    rval = CCutil_edge_to_cycle (ncount, tlist, &istour, cyc);
+    CCcheck_rval (rval, "CCutil_edge_to_cycle failed");
+    if (istour == 0) {
+        fprintf (stderr, "Starting tour has an error\n");
+        rval = 1; goto CLEANUP;
+    }
+    CC_FREE (tlist, int);
+
+    rval = CClinkern_tour (ncount, dat, ecount, elist, ncount, kicks,
+                    cyc, bestcyc, &bestval, silent, 0.0, 0.0,
+                    (char *) NULL,
+                    CC_LK_GEOMETRIC_KICK, rstate);
+    CCcheck_rval (rval, "CClinkern_tour failed");
+
+    for (i = 0; i < trials; i++) {
+        rval = CClinkern_tour (ncount, dat, ecount, elist, ncount, kicks,
+                        (int *) NULL, cyc, &val, silent, 0.0, 0.0,
+                        (char *) NULL, CC_LK_GEOMETRIC_KICK, rstate);
+        CCcheck_rval (rval, "CClinkern_tour failed");
+        if (val < bestval) {
+            CC_SWAP (cyc, bestcyc, tmp);
+            bestval = val;
+        }
+    }
+
+    if (trials > 0) {
+        rval = CClinkern_tour (ncount, dat, ecount, elist, ncount, 2 * kicks,
+                        bestcyc, perm, ub, silent, 0.0, 0.0,
+                        (char *) NULL, CC_LK_GEOMETRIC_KICK, rstate);
+        CCcheck_rval (rval, "CClinkern_tour failed");
+    } else {
+        for (i = 0; i < ncount; i++) {
+            perm[i] = bestcyc[i];
+        }
+    }
+
+    if (!silent) {
+        printf ("Time to find compression tour: %.2f (seconds)\n",
+                CCutil_zeit() - szeit);
+        fflush (stdout);
+    }
+
+CLEANUP:
+
+    CC_IFFREE (cyc, int);
+    CC_IFFREE (bestcyc, int);
+    CC_IFFREE (elist, int);
+    CC_IFFREE (tlist, int);
+    return rval;
+}
+
+/**
+ *  See Concorde for details.
+ *
+ *  @see Concorde source
+ */
+
+static int getedges (CCdatagroup *dat, CCedgegengroup *plan, int ncount,
+        int *ecount, int **elist, int **elen, int silent,
+        CCrandstate *rstate)
+{
+    int i;
+    int rval = 0;
+
+    *elist = (int *) NULL;
+    *elen = (int *) NULL;
+
+    if (dat == (CCdatagroup *) NULL || plan == (CCedgegengroup *) NULL) {
+        fprintf (stderr, "getedges needs CCdatagroup and CCedgegengroup\n");
+        rval = 1;  goto CLEANUP;
+    }
+
+    rval = CCedgegen_edges (plan, ncount, dat, (double *) NULL, ecount, elist,
+                            silent, rstate);
+    CCcheck_rval (rval, "CCedgegen_edges failed");
+
+    *elen = CC_SAFE_MALLOC(*ecount, int);
+    CCcheck_NULL (*elen, "out of memory for elen");
+
+    for (i = 0; i < *ecount; i++) {
+        (*elen)[i] = CCutil_dat_edgelen ((*elist)[2*i], (*elist)[(2*i)+1], dat);
+    }
+
+CLEANUP:
+
+    if (rval) {
+        CC_IFFREE (*elist, int);
+        CC_IFFREE (*elen, int);
+    }
+    return rval;
+}
+
+/**
+ *  See Concorde for details.
+ *
+ *  @see Concorde source
+ */
+
+static int dump_rc (CCtsp_lp *lp, int count, char *pname, int usesparse)
+{
+    int rval = 0;
+    char rcnname[1024];
+
+    sprintf (rcnname, "%s.rcn", pname);
+    rval = CCtsp_dump_rc_nearest (lp, count, rcnname, usesparse);
+    CCcheck_rval (rval, "CCtsp_dump_rc failed");
+
+CLEANUP:
+
+    return rval;
+}
@@ -0,0 +1,369 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  twoopt.c
+ *
+ *  2-opt and Or-opt tour improvement, the fast path of the route TSPs of
+ *  Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+#include <string.h>
+
+#define TWOOPT_SEGMENT 3	//!< Longest segment moved by Or-opt
+
+/**
+ *  The state of the tour improvement. Nodes whose don't-look bit is off
+ *  wait in a circular queue; a node leaves it when no move starting from it
+ *  improves the tour, and is queued again when one of its tour edges changes.
+ */
+
+typedef struct twoopt_state {
+	int n;
+	CCdatagroup *dat;
+	int *tour;			//!< Node at each position.
+	int *pos;				//!< Position of each node.
+	int *neigh;			//!< The k nearest nodes of each node, nearest first.
+	int k;
+	int *queue;			//!< Nodes to be processed.
+	char *queued;		//!< Whether each node is in the queue, the negated don't-look bit.
+	int head;				//!< First node of the queue.
+	int count;			//!< Number of nodes in the queue.
+	int *buf;				//!< Scratch space for Or-opt.
+} twoopt_state;
+
+#define D(st, a, b) CCutil_dat_edgelen((a), (b), (st)->dat)
+#define SUCC(st, a) ((st)->tour[((st)->pos[a] + 1) % (st)->n])
+#define PRED(st, a) ((st)->tour[((st)->pos[a] + (st)->n - 1) % (st)->n])
+#define AT(st, p) ((st)->tour[(((p) % (st)->n) + (st)->n) % (st)->n])
+
+/**
+ *  Turns off the don't-look bit of a node.
+ */
+
+static void twoopt_push(twoopt_state *st, int a)
+{
+	if (!st->queued[a])
+	{
+		st->queue[(st->head + st->count) % st->n] = a;
+		st->queued[a] = 1;
+		st->count++;
+	}
+}
+
+/**
+ *  Reverses the tour from position i to position j, going forward, or the
+ *  rest of the tour if it is shorter: the cycle is the same.
+ */
+
+static void twoopt_reverse(twoopt_state *st, int i, int j)
+{
+	int n = st->n;
+	int len = (j - i + n) % n + 1;
+	int s, a, b;
+
+	if (2 * len > n)
+	{
+		s = i;
+		i = (j + 1) % n;
+		j = (s + n - 1) % n;
+		len = n - len;
+	}
+	for (s = 0; s < len / 2; s++)
+	{
+		a = st->tour[(i + s) % n];
+		b = st->tour[(j - s + n) % n];
+		st->tour[(i + s) % n] = b;
+		st->pos[b] = (i + s) % n;
+		st->tour[(j - s + n) % n] = a;
+		st->pos[a] = (j - s + n) % n;
+	}
+}
+
+/**
+ *  Looks for a 2-opt move replacing a tour edge of a with an edge to one of
+ *  its nearest nodes, and applies the first improving one.
+ *
+ *  @return 1 if the tour was improved, 0 otherwise
+ */
+
+static int twoopt_move(twoopt_state *st, int a)
+{
+	int dir, i, b, c, d, dab, dac;
+
+	for (dir = 0; dir < 2; dir++)
+	{
+		b = (dir ? PRED(st, a) : SUCC(st, a));
+		dab = D(st, a, b);
+		for (i = 0; i < st->k; i++)
+		{
+			c = st->neigh[(size_t) a * st->k + i];
+			dac = D(st, a, c);
+			if (dac >= dab)
+				break;
+			d = (dir ? PRED(st, c) : SUCC(st, c));
+			if (c == b || d == a)
+				continue;
+			if (dac + D(st, b, d) - dab - D(st, c, d) < 0)
+			{
+				// a b ... c d becomes a c ... b d, backwards with dir
+				if (dir)
+					twoopt_reverse(st, st->pos[a], st->pos[d]);
+				else
+					twoopt_reverse(st, st->pos[b], st->pos[c]);
+				twoopt_push(st, a);
+				twoopt_push(st, b);
+				twoopt_push(st, c);
+				twoopt_push(st, d);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ *  Moves the segment of len nodes starting at first between x and the node
+ *  after it, backwards if reversed.
+ */
+
+static void oropt_apply(twoopt_state *st, int first, int len, int x, int reversed)
+{
+	int n = st->n;
+	int p = st->pos[first];
+	int i, m = 0, v;
+
+	for (i = len; i < n; i++)
+	{
+		v = st->tour[(p + i) % n];
+		st->buf[m++] = v;
+		if (v == x)
+		{
+			int s;
+			for (s = 0; s < len; s++)
+				st->buf[m++] = st->tour[(p + (reversed ? len - 1 - s : s)) % n];
+		}
+	}
+	memcpy(st->tour, st->buf, n * sizeof(int));
+	for (i = 0; i < n; i++)
+		st->pos[st->tour[i]] = i;
+}
+
+/**
+ *  Looks for an Or-opt move taking a segment of up to TWOOPT_SEGMENT nodes
+ *  that starts or ends at a, and putting it next to one of the nearest
+ *  nodes of a, either way round. Applies the first improving one.
+ *
+ *  @return 1 if the tour was improved, 0 otherwise
+ */
+
+static int oropt_move(twoopt_state *st, int a)
+{
+	int n = st->n;
+	int len, end, i, side, first, last, p, nx, c, x, y, gain, add, dfirst, dlast;
+
+	for (len = 1; len <= TWOOPT_SEGMENT && len <= n - 3; len++)
+	{
+		for (end = 0; end < (len == 1 ? 1 : 2); end++)
+		{
+			// a is the first node of the segment, or the last one
+			first = (end ? AT(st, st->pos[a] - len + 1) : a);
+			last = (end ? a : AT(st, st->pos[a] + len - 1));
+			p = PRED(st, first);
+			nx = SUCC(st, last);
+			gain = D(st, p, first) + D(st, last, nx) - D(st, p, nx);
+			if (gain <= 0)
+				continue;
+			for (i = 0; i < st->k; i++)
+			{
+				c = st->neigh[(size_t) a * st->k + i];
+				if (D(st, a, c) >= gain)
+					break;
+				if ((st->pos[c] - st->pos[first] + n) % n < len)
+					continue;
+				for (side = 0; side < 2; side++)
+				{
+					// Either c comes before a, or after it
+					x = (side ? PRED(st, c) : c);
+					y = (side ? c : SUCC(st, c));
+					if ((st->pos[x] - st->pos[first] + n) % n < len ||
+						(st->pos[y] - st->pos[first] + n) % n < len)
+						continue;
+					dfirst = D(st, x, first) + D(st, last, y);
+					dlast = D(st, x, last) + D(st, first, y);
+					// a must end up next to c
+					add = ((a == first) == (side == 0) ? dfirst : dlast) - D(st, x, y);
+					if (add - gain < 0)
+					{
+						oropt_apply(st, first, len, x, (a == first) != (side == 0));
+						twoopt_push(st, a);
+						twoopt_push(st, p);
+						twoopt_push(st, nx);
+						twoopt_push(st, first);
+						twoopt_push(st, last);
+						twoopt_push(st, x);
+						twoopt_push(st, y);
+						return 1;
+					}
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/** Builds a tour by the nearest neighbor heuristic
+ *
+ *  Starts from node 0, the depot of a route, and always goes to the
+ *  nearest node not visited yet. Takes O(n<sup>2</sup>) edge lengths; meant
+ *  as a cheap starting point for BEL_TwoOptTour.
+ *
+ *  @param ncount Number of nodes
+ *  @param dat  TSP instance data
+ *  @param tour The tour found, ncount nodes
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_NearestNeighborTour(int ncount, CCdatagroup *dat, int *tour)
+{
+	char *visited;
+	int i, j, d, best, bestd;
+
+	visited = (char *) calloc(ncount, 1);
+	if (!visited)
+	{
+		fprintf(stderr, "Out of memory for the nearest neighbor tour\n");
+		return 1;
+	}
+	tour[0] = 0;
+	visited[0] = 1;
+	for (i = 1; i < ncount; i++)
+	{
+		best = -1;
+		bestd = 0;
+		for (j = 0; j < ncount; j++)
+		{
+			if (visited[j])
+				continue;
+			d = CCutil_dat_edgelen(tour[i - 1], j, dat);
+			if (best < 0 || d < bestd)
+			{
+				best = j;
+				bestd = d;
+			}
+		}
+		tour[i] = best;
+		visited[best] = 1;
+	}
+	free(visited);
+	return 0;
+}
+
+/** Improves a tour by 2-opt and Or-opt moves
+ *
+ *  A local search for the latency sensitive runs, where an exact solve of
+ *  every route costs more than it gains. Only the moves adding an edge from
+ *  a node to one of its <code>neighbors</code> nearest nodes are tried, and
+ *  each node has a don't-look bit: it is skipped until one of its tour
+ *  edges changes. The search stops when no node can be improved, that is at
+ *  a local optimum of both neighborhoods.
+ *
+ *  @param ncount Number of nodes
+ *  @param dat  TSP instance data
+ *  @param tour The tour to be improved, in place
+ *  @param neighbors  Length of the neighbor lists
+ *  @return 1 on failure, leaving the tour as it was, 0 otherwise
+ */
+
+int BEL_TwoOptTour(int ncount, CCdatagroup *dat, int *tour, int neighbors)
+{
+	twoopt_state st;
+	int *bestd = (int *) NULL;
+	int i, j, m, q, d, a, rval = 1;
+
+	if (ncount < 5)
+		return 0;
+	memset(&st, 0, sizeof(st));
+	st.n = ncount;
+	st.dat = dat;
+	st.tour = tour;
+	st.k = MIN(neighbors, ncount - 1);
+	st.pos = (int *) malloc(ncount * sizeof(int));
+	st.neigh = (int *) malloc((size_t) ncount * st.k * sizeof(int));
+	st.queue = (int *) malloc(ncount * sizeof(int));
+	st.queued = (char *) calloc(ncount, 1);
+	st.buf = (int *) malloc(ncount * sizeof(int));
+	bestd = (int *) malloc(st.k * sizeof(int));
+	if (!st.pos || !st.neigh || !st.queue || !st.queued || !st.buf || !bestd)
+	{
+		fprintf(stderr, "Out of memory for 2-opt\n");
+		goto CLEANUP;
+	}
+
+	// The k nearest nodes, kept sorted by insertion
+	for (i = 0; i < ncount; i++)
+	{
+		int *row = st.neigh + (size_t) i * st.k;
+		for (j = 0, m = 0; j < ncount; j++)
+		{
+			if (j == i)
+				continue;
+			d = CCutil_dat_edgelen(i, j, dat);
+			if (m == st.k && d >= bestd[m - 1])
+				continue;
+			if (m < st.k)
+				m++;
+			for (q = m - 1; q > 0 && bestd[q - 1] > d; q--)
+			{
+				bestd[q] = bestd[q - 1];
+				row[q] = row[q - 1];
+			}
+			bestd[q] = d;
+			row[q] = j;
+		}
+	}
+
+	for (i = 0; i < ncount; i++)
+	{
+		st.pos[tour[i]] = i;
+		twoopt_push(&st, tour[i]);
+	}
+	while (st.count > 0)
+	{
+		a = st.queue[st.head];
+		st.head = (st.head + 1) % ncount;
+		st.count--;
+		st.queued[a] = 0;
+		if (!twoopt_move(&st, a))
+			oropt_move(&st, a);
+	}
+	rval = 0;
+
+CLEANUP:
+	free(st.pos);
+	free(st.neigh);
+	free(st.queue);
+	free(st.queued);
+	free(st.buf);
+	free(bestd);
+	return rval;
+}
@@ -0,0 +1,306 @@
+/**
+ *  Beluga VRP Solver
+ *	Copyright (c) 2005-2006 Claudio Procida. All rights reserved.
+ *	http://www.emeraldion.it/
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	Bug fixes, suggestions and comments should be sent to:
+ *	claudio@emeraldion.it
+ */
+
+/**
+ *  vrpbinary.c
+ *
+ *  Binary instance format (.vrpb) of Beluga VRP solver
+ *
+ */
+
+#include "beluga.h"
+#include <concorde.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define VRPB_MAGIC "BELVRPB"	//!< First bytes of a .vrpb file, with the terminator
+#define VRPB_VERSION 1				//!< Version of the layout below
+#define VRPB_BYTEORDER 0x01020304	//!< Reads differently on a machine of the other endianness
+#define VRPB_ALIGN 64					//!< Alignment of every section
+
+/**
+ *  Header of a .vrpb file. Every array of the instance is a section of the
+ *  file, starting at a multiple of VRPB_ALIGN bytes, in the native byte
+ *  order. An offset of 0 means the section is missing.
+ */
+
+typedef struct vrpb_header {
+	char magic[8];					//!< VRPB_MAGIC
+	uint32_t byteorder;			//!< VRPB_BYTEORDER
+	uint32_t version;				//!< VRPB_VERSION
+	int32_t dimension;			//!< Number of nodes
+	int32_t capacity;				//!< Vehicle capacity
+	int32_t ndepots;				//!< Number of depots
+	int32_t nvehicles;			//!< Number of vehicles, 0 if not set
+	int32_t norm;						//!< Concorde norm
+	int32_t namelen;				//!< Length of the name, without the terminator
+	uint64_t size;					//!< Size of the file
+	uint64_t name;					//!< Name of the instance, null terminated
+	uint64_t x;							//!< dimension doubles
+	uint64_t y;							//!< dimension doubles
+	uint64_t z;							//!< dimension doubles, 3D norms only
+	uint64_t demand;				//!< dimension ints
+	uint64_t depots;				//!< ndepots ints
+	uint64_t adj;						//!< Packed lower triangle of explicit lengths, matrix norms only
+	uint64_t dist;					//!< Packed lower triangle of the distance matrix (see BEL_Dist), optional
+} vrpb_header;
+
+/**
+ *  Appends a section to the file, padded to VRPB_ALIGN bytes.
+ *
+ *  @return The offset of the section, 0 on failure
+ */
+
+static uint64_t put_section(FILE *out, uint64_t *pos, const void *buf, size_t len)
+{
+	static const char zeroes[VRPB_ALIGN];
+	uint64_t start = *pos;
+	size_t pad = (VRPB_ALIGN - len % VRPB_ALIGN) % VRPB_ALIGN;
+
+	if (fwrite(buf, 1, len, out) != len || fwrite(zeroes, 1, pad, out) != pad)
+		return 0;
+	*pos += len + pad;
+	return start;
+}
+
+/**
+ *  Checks that a section lies within the file and is aligned.
+ */
+
+static int bad_section(vrpb_header *h, uint64_t off, uint64_t len)
+{
+	return (off % VRPB_ALIGN || off > h->size || len > h->size - off);
+}
+
+/** Writes a VRP instance to a binary .vrpb file
+ *
+ *  Writes the instance as it is in memory: a fixed header followed by the
+ *  coordinate arrays, the demands, the depots, the explicit lengths for
+ *  matrix norms and, if it was built, the distance matrix. Every section
+ *  is 64 byte aligned, so BEL_VRPReadBinary maps the file and uses the
+ *  arrays in place. The file is only meant to be read on a machine of the
+ *  same byte order.
+ *
+ *  @param datfile  The name of the output file
+ *  @param data The instance to be written
+ *  @return 1 on failure, 0 otherwise
+ */
+
+int BEL_VRPWriteBinary(char *datfile, BEL_VRPData *data)
+{
+	FILE *out;
+	vrpb_header h;
+	uint64_t pos;
+	size_t n = data->dimension;
+	size_t tri = n * (n + 1) / 2;
+	int dim = data->dat->norm & CC_NORM_SIZE_BITS;
+	int rval = 1;
+
+	if (!data->demand || !data->depots ||
+		(dim == CC_MATRIX_NORM_SIZE ? !data->dat->adjspace : !data->dat->x))
+	{
+		fprintf(stderr, "BEL_VRPWriteBinary: incomplete instance\n");
+		return 1;
+	}
+	if (!(out = fopen(datfile, "wb")))
+	{
+		fprintf(stderr, "Cannot open file %s for writing\n", datfile);
+		return 1;
+	}
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, VRPB_MAGIC, sizeof(h.magic));
+	h.byteorder = VRPB_BYTEORDER;
+	h.version = VRPB_VERSION;
+	h.dimension = data->dimension;
+	h.capacity = data->capacity;
+	h.ndepots = data->ndepots;
+	h.nvehicles = data->nvehicles;
+	h.norm = data->dat->norm;
+	h.namelen = (data->name ? strlen(data->name) : 0);
+
+	// The header is written twice, the second time with the offsets
+	pos = 0;
+	put_section(out, &pos, &h, sizeof(h));
+	if (pos == 0)
+		goto CLEANUP;
+	if (data->name && !(h.name = put_section(out, &pos, data->name, h.namelen + 1)))
+		goto CLEANUP;
+	if (dim == CC_D2_NORM_SIZE || dim == CC_D3_NORM_SIZE)
+	{
+		if (!(h.x = put_section(out, &pos, data->dat->x, n * sizeof(double))) ||
+			!(h.y = put_section(out, &pos, data->dat->y, n * sizeof(double))))
+			goto CLEANUP;
+		if (dim == CC_D3_NORM_SIZE && !(h.z = put_section(out, &pos, data->dat->z, n * sizeof(double))))
+			goto CLEANUP;
+	}
+	if (!(h.demand = put_section(out, &pos, data->demand, n * sizeof(int))) ||
+		!(h.depots = put_section(out, &pos, data->depots, data->ndepots * sizeof(int))))
+		goto CLEANUP;
+	if (dim == CC_MATRIX_NORM_SIZE && !(h.adj = put_section(out, &pos, data->dat->adjspace, tri * sizeof(int))))
+		goto CLEANUP;
+	if (data->dist && !(h.dist = put_section(out, &pos, data->dist, tri * sizeof(int))))
+		goto CLEANUP;
+	h.size = pos;
+
+	if (fseek(out, 0, SEEK_SET) || fwrite(&h, sizeof(h), 1, out) != 1)
+		goto CLEANUP;
+	rval = 0;
+
+CLEANUP:
+	if (fclose(out))
+		rval = 1;
+	if (rval)
+		fprintf(stderr, "Error writing %s\n", datfile);
+	return rval;
+}
+
+/** Loads a VRP instance from a binary .vrpb file
+ *
+ *  Maps the file in memory with a single mmap, checks the header and points
+ *  the arrays of <code>data</code> into the mapping, so nothing is parsed
+ *  or copied. The mapping is private, pages are copied only if they are
+ *  written to. If the file holds a distance matrix, <code>data->dist</code>
+ *  is set too and there is no need to call BEL_BuildDistMatrix.
+ *  BEL_FreeVRPData releases the mapping.
+ *
+ *  @param datfile  The name of the .vrpb file
+ *  @param data     The target BEL_VRPData structure to load data into.
+ *  @param verbose  Turns on lots of messages.
+ *  @return 1 on failure, 0 otherwise.
+ */
+
+int BEL_VRPReadBinary(char *datfile, BEL_VRPData *data, int verbose)
+{
+	struct stat st;
+	vrpb_header *h;
+	char *base;
+	size_t n, tri;
+	int fd, dim, i;
+
+	if ((fd = open(datfile, O_RDONLY)) < 0)
+	{
+		fprintf(stderr, "Cannot open file %s for reading\n", datfile);
+		return 1;
+	}
+	if (fstat(fd, &st) || (size_t) st.st_size < sizeof(vrpb_header))
+	{
+		fprintf(stderr, "%s is not a .vrpb file\n", datfile);
+		close(fd);
+		return 1;
+	}
+	base = (char *) mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == (char *) MAP_FAILED)
+	{
+		fprintf(stderr, "Cannot map file %s\n", datfile);
+		return 1;
+	}
+	data->map = base;
+	data->mapsize = st.st_size;
+
+	h = (vrpb_header *) base;
+	if (memcmp(h->magic, VRPB_MAGIC, sizeof(h->magic)) || h->byteorder != VRPB_BYTEORDER)
+	{
+		fprintf(stderr, "%s is not a .vrpb file of this machine\n", datfile);
+		return 1;
+	}
+	if (h->version != VRPB_VERSION)
+	{
+		fprintf(stderr, "%s has version %u, expecting %d\n", datfile, h->version, VRPB_VERSION);
+		return 1;
+	}
+
+	n = h->dimension;
+	tri = n * (n + 1) / 2;
+	dim = h->norm & CC_NORM_SIZE_BITS;
+	if (h->dimension <= 0 || h->ndepots < 0 || h->ndepots > h->dimension ||
+		h->size != (uint64_t) st.st_size ||
+		h->namelen < 0 || (h->name && (bad_section(h, h->name, (uint64_t) h->namelen + 1) ||
+			base[h->name + h->namelen] != '\0')) ||
+		((dim == CC_D2_NORM_SIZE || dim == CC_D3_NORM_SIZE) &&
+			(!h->x || !h->y || bad_section(h, h->x, n * sizeof(double)) ||
+			bad_section(h, h->y, n * sizeof(double)))) ||
+		(dim == CC_D3_NORM_SIZE && (!h->z || bad_section(h, h->z, n * sizeof(double)))) ||
+		(dim == CC_MATRIX_NORM_SIZE && (!h->adj || bad_section(h, h->adj, tri * sizeof(int)))) ||
+		!h->demand || bad_section(h, h->demand, n * sizeof(int)) ||
+		!h->depots || bad_section(h, h->depots, h->ndepots * sizeof(int)) ||
+		(h->dist && bad_section(h, h->dist, tri * sizeof(int))))
+	{
+		fprintf(stderr, "%s is corrupted\n", datfile);
+		return 1;
+	}
+
+	if (CCutil_dat_setnorm(data->dat, h->norm))
+	{
+		fprintf(stderr, "ERROR: Couldn't set norm %d\n", h->norm);
+		return 1;
+	}
+	data->dimension = h->dimension;
+	data->capacity = h->capacity;
+	data->ndepots = h->ndepots;
+	data->ncustomers = h->dimension - h->ndepots;
+	data->nvehicles = h->nvehicles;
+	free(data->name);
+	data->name = (h->name ? strdup(base + h->name) : (char *) NULL);
+
+	if (h->x)
+	{
+		data->dat->x = (double *) (base + h->x);
+		data->dat->y = (double *) (base + h->y);
+	}
+	if (h->z)
+		data->dat->z = (double *) (base + h->z);
+	if (dim == CC_MATRIX_NORM_SIZE)
+	{
+		// Row pointers into the packed triangle, the only array we allocate
+		data->dat->adjspace = (int *) (base + h->adj);
+		data->dat->adj = CC_SAFE_MALLOC(n, int *);
+		if (!data->dat->adj)
+			return 1;
+		for (i = 0; i < h->dimension; i++)
+			data->dat->adj[i] = data->dat->adjspace + (size_t) i * (i + 1) / 2;
+	}
+	data->demand = (int *) (base + h->demand);
+	data->depots = (int *) (base + h->depots);
+	if (h->dist)
+		data->dist = (int *) (base + h->dist);
+
+	data->isadepot = (int *) calloc(n, sizeof(int));
+	if (!data->isadepot)
+		return 1;
+	for (i = 0; i < h->ndepots; i++)
+	{
+		if (data->depots[i] < 0 || data->depots[i] >= h->dimension)
+		{
+			fprintf(stderr, "%s is corrupted\n", datfile);
+			return 1;
+		}
+		data->isadepot[data->depots[i]] = 1;
+	}
+
+	if (verbose)
+		printf("Loaded %s: %d nodes, capacity %d%s\n", datfile, data->dimension,
+			data->capacity, data->dist ? ", with distance matrix" : "");
+	return 0;
+}